@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include "domain.hpp"
+#include "generic.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Hash index from packed addresses to their owner, recording every collision on insertion
+template <class Owner> class AddressIndex {
+  public:
+    struct Conflict {
+        PackedAddress address;
+        Owner first;
+        Owner second;
+    };
+
+  private:
+    std::unordered_map<PackedAddress, Owner, PackedAddress::Hash> owners;
+    std::vector<Conflict> conflicts_;
+
+  public:
+    inline void reserve(std::size_t count) { owners.reserve(count); }
+
+    /// Returns false, and records a conflict, if the address is already owned
+    inline bool insert(const PackedAddress& address, const Owner& owner) {
+        const auto [it, inserted] = owners.try_emplace(address, owner);
+        if (!inserted)
+            conflicts_.push_back(Conflict{address, it->second, owner});
+        return inserted;
+    }
+
+    [[nodiscard]] inline std::optional<Owner> find(const PackedAddress& address) const noexcept {
+        const auto it = owners.find(address);
+        return it != owners.end() ? std::optional{it->second} : std::nullopt;
+    }
+    [[nodiscard]] inline std::size_t size() const noexcept { return owners.size(); }
+    [[nodiscard]] inline const std::vector<Conflict>& conflicts() const noexcept { return conflicts_; }
+};
+
+// Addresses that do not pin a slot (virtio-mmio, or pci without a bus and slot, left for libvirt to assign) cannot collide
+// A pci address spelling out 0000:00:00.0 does pin that slot, even though it packs to 0
+[[nodiscard]] inline bool is_slot_address(const PackedAddress& address) noexcept {
+    switch (address.type) {
+    case Address::Type::virtio_mmio:
+        return false;
+    case Address::Type::pci:
+        return address.pinned;
+    default:
+        return true;
+    }
+}
+
+/// Guest-side addresses of all the devices of a single domain
+using GuestAddressIndex = AddressIndex<Domain::Devices::Any>;
+
+[[nodiscard]] inline GuestAddressIndex index_guest_addresses(Domain dom) {
+    GuestAddressIndex index;
+    const auto devices = dom.devices();
+    if (!devices)
+        return index;
+    for (const auto dev : devices.all()) {
+        const auto packed = dev.address().packed();
+        if (packed && is_slot_address(*packed))
+            index.insert(*packed, dev);
+    }
+    return index;
+}
+
+/// Host PCI devices handed to guests, either as <hostdev> or as <interface type='hostdev'>, across all domains of a host
+struct HostAddressOwner {
+    std::size_t domain;
+    std::variant<Domain::Devices::HostDev, Domain::Devices::Interface> device;
+};
+using HostAddressIndex = AddressIndex<HostAddressOwner>;
+
+/// Calls `fn(PackedAddress, device)` for every host PCI device assigned to `dom`
+template <class F> void for_each_host_pci_address(Domain dom, F&& fn) {
+    const auto devices = dom.devices();
+    if (!devices)
+        return;
+    for (const auto hostdev : devices.hostdevs()) {
+        const auto source = hostdev.source();
+        if (!source || hostdev.mode().value_or(Domain::Devices::HostDev::Mode::subsystem) != Domain::Devices::HostDev::Mode::subsystem ||
+            hostdev.type() != Domain::Devices::HostDev::Type::pci)
+            continue;
+        const auto packed = source.pci_address().packed();
+        if (packed && packed->type == Address::Type::pci)
+            fn(*packed, hostdev);
+    }
+    for (const auto iface : devices.interfaces()) {
+        const auto source = iface.source();
+        if (!source)
+            continue;
+        const auto packed = source.hostdev_address().packed();
+        if (packed && packed->type == Address::Type::pci)
+            fn(*packed, iface);
+    }
+}
+
+/// Builds the host index over `domains`, a range of `Domain` views; owners refer to domains by their position in the range
+template <class Range> [[nodiscard]] HostAddressIndex index_host_addresses(const Range& domains) {
+    HostAddressIndex index;
+    std::size_t dom_idx = 0;
+    for (const Domain dom : domains) {
+        for_each_host_pci_address(dom, [&](const PackedAddress& packed, auto dev) { index.insert(packed, HostAddressOwner{dom_idx, dev}); });
+        ++dom_idx;
+    }
+    return index;
+}
+
+} // namespace
+} // namespace virtxml
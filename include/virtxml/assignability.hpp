@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "address_index.hpp"
+#include "device_graph.hpp"
+#include "domain.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Checks host PCI devices assigned to domains against the IOMMU groups of the host
+/// A group may only be handed out whole: each member must be assigned to the same domain, be a PCI bridge,
+/// or be free (unbound, or bound to vfio-pci or pci-stub)
+/// Domains are added and removed incrementally; only the groups they touch are re-evaluated
+template <class Key = std::string> class AssignabilityChecker {
+  public:
+    enum class Kind {
+        unknown_device, // the host has no such PCI device
+        no_iommu_group, // the device is not in any IOMMU group
+        shared_device,  // the device is assigned to more than one domain
+        split_group,    // members of the group are assigned to different domains
+        busy_member,    // a member of the group is neither assigned nor free
+    };
+
+    struct Conflict {
+        Kind kind;
+        std::uint32_t device; // packed PCI address
+        std::optional<unsigned> iommu_group;
+        Key domain;
+        std::optional<Key> other_domain;
+    };
+
+  private:
+    struct GroupState {
+        std::unordered_map<Key, unsigned> domains; // assigned members per domain
+        std::vector<Conflict> conflicts;
+    };
+
+    const DeviceGraph& graph;
+    std::unordered_map<std::uint32_t, std::vector<Key>> holders;
+    std::unordered_map<Key, std::vector<std::uint32_t>> domain_devices;
+    std::unordered_map<unsigned, GroupState> groups;
+    std::unordered_map<Key, std::vector<Conflict>> ungrouped; // unknown_device and no_iommu_group, per domain
+    std::unordered_set<unsigned> dirty;
+
+    [[nodiscard]] inline bool is_free(DeviceGraph::Index idx) const noexcept {
+        const auto dev = graph[idx];
+        if (const auto cap = dev.capability(); cap && cap.class_() && (static_cast<unsigned>(cap.class_()) >> 8u) == 0x0604u)
+            return true; // PCI-to-PCI bridge
+        const auto driver = dev.driver();
+        if (!driver || !driver.name())
+            return true;
+        const auto name = static_cast<std::string_view>(driver.name());
+        return name == "vfio-pci" || name == "pci-stub";
+    }
+
+    [[nodiscard]] inline std::optional<unsigned> group_of(std::uint32_t pci) const noexcept {
+        const auto idx = graph.find_pci(pci);
+        return idx ? graph.iommu_group_of(*idx) : std::nullopt;
+    }
+
+    void evaluate(unsigned number, GroupState& group) {
+        group.conflicts.clear();
+        const Key* first_domain = nullptr;
+        for (const auto& [dom, count] : group.domains) {
+            if (first_domain == nullptr)
+                first_domain = &dom;
+            else
+                group.conflicts.push_back(Conflict{Kind::split_group, 0, number, dom, *first_domain});
+        }
+        for (const auto member : graph.iommu_group(number)) {
+            // A member without a PCI address cannot be assigned, and 0 would alias the device at 0000:00:00.0
+            const auto address = graph.pci_address(member);
+            if (!address)
+                continue;
+            const auto pci = *address;
+            const auto it = holders.find(pci);
+            if (it != holders.end() && !it->second.empty()) {
+                for (std::size_t i = 1; i < it->second.size(); ++i)
+                    group.conflicts.push_back(Conflict{Kind::shared_device, pci, number, it->second[i], it->second.front()});
+            } else if (!is_free(member)) {
+                for (const auto& [dom, count] : group.domains)
+                    group.conflicts.push_back(Conflict{Kind::busy_member, pci, number, dom, std::nullopt});
+            }
+        }
+    }
+
+    void refresh() {
+        for (const auto number : dirty) {
+            const auto it = groups.find(number);
+            if (it == groups.end())
+                continue;
+            if (it->second.domains.empty())
+                groups.erase(it);
+            else
+                evaluate(number, it->second);
+        }
+        dirty.clear();
+    }
+
+  public:
+    /// `graph` must outlive the checker
+    explicit AssignabilityChecker(const DeviceGraph& graph) : graph(graph) {}
+
+    /// Records the host PCI devices assigned to `dom`, replacing whatever was recorded under `key` before
+    void add_domain(const Key& key, Domain dom) {
+        remove_domain(key);
+        auto& devices = domain_devices[key];
+        auto& unresolved = ungrouped[key];
+        for_each_host_pci_address(dom, [&](const PackedAddress& addr, auto) {
+            const auto pci = addr.pci_packed();
+            const auto idx = graph.find_pci(pci);
+            if (!idx) {
+                unresolved.push_back(Conflict{Kind::unknown_device, pci, std::nullopt, key, std::nullopt});
+                return;
+            }
+            const auto number = graph.iommu_group_of(*idx);
+            if (!number) {
+                unresolved.push_back(Conflict{Kind::no_iommu_group, pci, std::nullopt, key, std::nullopt});
+                return;
+            }
+            devices.push_back(pci);
+            holders[pci].push_back(key);
+            ++groups[*number].domains[key];
+            dirty.insert(*number);
+        });
+        if (unresolved.empty())
+            ungrouped.erase(key);
+    }
+
+    void remove_domain(const Key& key) {
+        ungrouped.erase(key);
+        const auto it = domain_devices.find(key);
+        if (it == domain_devices.end())
+            return;
+        for (const auto pci : it->second) {
+            auto& dev_holders = holders[pci];
+            dev_holders.erase(std::find(dev_holders.begin(), dev_holders.end(), key));
+            if (dev_holders.empty())
+                holders.erase(pci);
+            const auto number = *group_of(pci);
+            auto& group = groups[number];
+            if (--group.domains[key] == 0)
+                group.domains.erase(key);
+            dirty.insert(number);
+        }
+        domain_devices.erase(it);
+    }
+
+    /// Would assigning the PCI device `pci` to the domain recorded as `key` (or to a new domain) be valid
+    [[nodiscard]] bool can_assign(std::uint32_t pci, const Key& key) const noexcept {
+        const auto number = group_of(pci);
+        if (!number)
+            return false;
+        for (const auto member : graph.iommu_group(*number)) {
+            const auto address = graph.pci_address(member);
+            if (!address)
+                continue;
+            const auto it = holders.find(*address);
+            if (it != holders.end()) {
+                for (const auto& holder : it->second)
+                    if (holder != key)
+                        return false;
+            } else if (*address != pci && !is_free(member)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// All current conflicts; groups touched since the last call are re-evaluated first
+    [[nodiscard]] std::vector<Conflict> conflicts() {
+        refresh();
+        std::vector<Conflict> ret;
+        for (const auto& [key, list] : ungrouped)
+            ret.insert(ret.end(), list.begin(), list.end());
+        for (const auto& [number, group] : groups)
+            ret.insert(ret.end(), group.conflicts.begin(), group.conflicts.end());
+        return ret;
+    }
+};
+
+} // namespace
+} // namespace virtxml
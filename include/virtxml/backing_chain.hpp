@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "domain.hpp"
+#include "storage.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Contiguous copy of the backing chain of a disk, from the active image (position 0) to the base image
+/// Built in a single walk of the nested <backingStore> elements; sources stay views into the document
+class BackingChain {
+  public:
+    using Disk = Domain::Devices::Disk;
+
+    struct Layer {
+        std::optional<unsigned> index; // libvirt's backing index, absent for the active image
+        std::optional<storage::Format> format;
+        Disk::Source source;
+        std::optional<Disk::Type> type;
+    };
+
+  private:
+    constexpr static std::uint32_t npos = ~std::uint32_t{0};
+    constexpr static unsigned max_index = 0xFFFF;
+
+    std::vector<Layer> layers;
+    std::vector<std::uint32_t> by_index; // libvirt index -> position in layers
+
+  public:
+    explicit BackingChain(Disk disk) {
+        const auto driver = disk.driver();
+        layers.push_back(Layer{std::nullopt, driver ? driver.type() : std::nullopt, disk.source(), disk.type()});
+        // An empty <backingStore/> terminates the chain
+        for (auto store = disk.backing_store(); store && store.source(); store = store.next()) {
+            const auto format = store.format();
+            const auto index = store.index() ? std::optional{static_cast<unsigned>(store.index())} : std::nullopt;
+            layers.push_back(Layer{index, format ? format.type() : std::nullopt, store.source(), store.type()});
+            if (index && *index <= max_index) {
+                if (*index >= by_index.size())
+                    by_index.resize(*index + 1, npos);
+                by_index[*index] = static_cast<std::uint32_t>(layers.size() - 1);
+            }
+        }
+    }
+
+    /// Number of backing images below the active one
+    [[nodiscard]] inline std::size_t depth() const noexcept { return layers.size() - 1; }
+    [[nodiscard]] inline std::size_t size() const noexcept { return layers.size(); }
+    [[nodiscard]] inline const Layer& operator[](std::size_t pos) const noexcept { return layers[pos]; }
+    [[nodiscard]] inline const Layer& leaf() const noexcept { return layers.front(); }
+    [[nodiscard]] inline const Layer& base() const noexcept { return layers.back(); }
+    [[nodiscard]] inline auto begin() const noexcept { return layers.cbegin(); }
+    [[nodiscard]] inline auto end() const noexcept { return layers.cend(); }
+
+    /// Layer carrying libvirt's backing index `index` (as in "vda[3]")
+    [[nodiscard]] inline const Layer* find_index(unsigned index) const noexcept {
+        return index < by_index.size() && by_index[index] != npos ? &layers[by_index[index]] : nullptr;
+    }
+};
+
+} // namespace
+} // namespace virtxml
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "domain.hpp"
+#include "network.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Where the traffic of an interface leaves the host
+struct Uplink {
+    enum class Kind {
+        network,
+        bridge,
+        direct,
+    };
+
+    Kind kind;
+    std::string name;
+
+    struct Hash {
+        [[nodiscard]] inline std::size_t operator()(const Uplink& uplink) const noexcept {
+            return std::hash<std::string>{}(uplink.name) * 3 + static_cast<std::size_t>(uplink.kind);
+        }
+    };
+
+    [[nodiscard]] inline bool operator==(const Uplink& oth) const noexcept { return kind == oth.kind && name == oth.name; }
+
+    /// Uplink of `iface`, for network, bridge and direct interfaces; none for other types, including ones this library does not know
+    [[nodiscard]] static std::optional<Uplink> of(Domain::Devices::Interface iface) {
+        using Type = Domain::Devices::Interface::Type;
+        const auto source = iface.source();
+        const auto type_attr = NodeAccess::of(iface)->first_attribute("type");
+        const auto type = type_attr != nullptr ? enum_cast_xml<Type>({type_attr->value(), type_attr->value_size()}) : std::nullopt;
+        if (!source || !type)
+            return std::nullopt;
+        std::optional<Uplink> ret;
+        switch (*type) {
+        case Type::network:
+            ret = Uplink{Kind::network, std::string{source.network().value_or({})}};
+            break;
+        case Type::bridge:
+            ret = Uplink{Kind::bridge, std::string{source.bridge().value_or({})}};
+            break;
+        case Type::direct:
+            ret = Uplink{Kind::direct, std::string{source.direct_dev().value_or({})}};
+            break;
+        default:
+            return std::nullopt;
+        }
+        return ret->name.empty() ? std::nullopt : ret;
+    }
+};
+
+/// Host-wide bandwidth and VLAN usage per uplink, updated incrementally as domains come and go
+/// Rates are in kibibytes per second, as in <bandwidth>
+template <class Key = std::string> class BandwidthAggregator {
+  public:
+    using Interface = Domain::Devices::Interface;
+
+    struct Rates {
+        std::uint64_t average = 0;
+        std::uint64_t floor = 0;
+
+        inline Rates& operator+=(const Rates& oth) noexcept {
+            average += oth.average;
+            floor += oth.floor;
+            return *this;
+        }
+        inline Rates& operator-=(const Rates& oth) noexcept {
+            average -= oth.average;
+            floor -= oth.floor;
+            return *this;
+        }
+    };
+
+    /// Average rates an uplink can guarantee, usually the <bandwidth> of the libvirt network
+    struct Capacity {
+        std::uint64_t inbound = 0;
+        std::uint64_t outbound = 0;
+    };
+
+    struct Totals {
+        Rates inbound;
+        Rates outbound;
+        std::size_t interfaces = 0;
+        std::bitset<4096> vlans; // every VLAN id carried by an interface of the uplink
+        std::optional<Capacity> capacity;
+    };
+
+  private:
+    struct Contribution {
+        const Uplink* uplink;
+        Rates inbound;
+        Rates outbound;
+        std::vector<std::uint16_t> vlans;
+    };
+
+    std::unordered_map<Uplink, Totals, Uplink::Hash> uplinks;
+    std::unordered_map<const Uplink*, std::unordered_map<std::uint16_t, std::uint32_t>> vlan_refs;
+    std::unordered_map<Key, std::vector<Contribution>> domains;
+
+    [[nodiscard]] static Rates rates_of(Bandwidth::Attributes attrs) noexcept {
+        if (!attrs)
+            return {};
+        return Rates{attrs.average() ? static_cast<unsigned long long>(attrs.average()) : 0u,
+                     attrs.floor() ? static_cast<unsigned long long>(attrs.floor()) : 0u};
+    }
+
+    [[nodiscard]] static std::pair<Rates, Rates> rates_of(Interface iface) noexcept {
+        const auto bandwidth = iface.bandwidth();
+        if (!bandwidth)
+            return {};
+        return {rates_of(bandwidth.inbound()), rates_of(bandwidth.outbound())};
+    }
+
+  public:
+    /// Records the interfaces of `dom`, replacing whatever was recorded under `key` before
+    void add_domain(const Key& key, Domain dom) {
+        remove_domain(key);
+        const auto devices = dom.devices();
+        if (!devices)
+            return;
+        auto& contributions = domains[key];
+        for (const auto iface : devices.interfaces()) {
+            auto uplink = Uplink::of(iface);
+            if (!uplink)
+                continue;
+            const auto it = uplinks.try_emplace(std::move(*uplink)).first;
+            auto& totals = it->second;
+            const auto [inbound, outbound] = rates_of(iface);
+            Contribution contribution{&it->first, inbound, outbound, {}};
+            totals.inbound += inbound;
+            totals.outbound += outbound;
+            ++totals.interfaces;
+            if (const auto vlan = iface.vlan()) {
+                auto& refs = vlan_refs[&it->first];
+                for (const auto tag : vlan.tags()) {
+                    const auto id = static_cast<unsigned>(tag.id());
+                    if (id >= totals.vlans.size())
+                        continue;
+                    contribution.vlans.push_back(static_cast<std::uint16_t>(id));
+                    if (refs[static_cast<std::uint16_t>(id)]++ == 0)
+                        totals.vlans.set(id);
+                }
+            }
+            contributions.push_back(std::move(contribution));
+        }
+    }
+
+    void remove_domain(const Key& key) {
+        const auto it = domains.find(key);
+        if (it == domains.end())
+            return;
+        for (const auto& contribution : it->second) {
+            auto& totals = uplinks.find(*contribution.uplink)->second;
+            totals.inbound -= contribution.inbound;
+            totals.outbound -= contribution.outbound;
+            --totals.interfaces;
+            auto& refs = vlan_refs[contribution.uplink];
+            for (const auto id : contribution.vlans)
+                if (--refs[id] == 0) {
+                    refs.erase(id);
+                    totals.vlans.reset(id);
+                }
+        }
+        domains.erase(it);
+    }
+
+    void set_capacity(const Uplink& uplink, Capacity capacity) { uplinks[uplink].capacity = capacity; }
+
+    [[nodiscard]] inline const Totals* find(const Uplink& uplink) const noexcept {
+        const auto it = uplinks.find(uplink);
+        return it != uplinks.end() ? &it->second : nullptr;
+    }
+
+    /// Whether the floors requested by `iface` still fit in the capacity of its uplink; uplinks without a capacity admit everything
+    [[nodiscard]] bool admits(Interface iface) const {
+        const auto uplink = Uplink::of(iface);
+        if (!uplink)
+            return true;
+        const auto totals = find(*uplink);
+        if (totals == nullptr || !totals->capacity)
+            return true;
+        const auto [inbound, outbound] = rates_of(iface);
+        return totals->inbound.floor + inbound.floor <= totals->capacity->inbound &&
+               totals->outbound.floor + outbound.floor <= totals->capacity->outbound;
+    }
+
+    [[nodiscard]] inline const auto& all() const noexcept { return uplinks; }
+};
+
+} // namespace
+} // namespace virtxml
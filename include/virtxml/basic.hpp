@@ -14,7 +14,8 @@ struct Adapter : public Node {
         struct Address : public Node {
             [[nodiscard]] inline Optional<Integral> domain() const noexcept { return Integral{node->first_attribute("domain")}; }
             [[nodiscard]] inline Optional<Integral> bus() const noexcept { return Integral{node->first_attribute("bus")}; }
-            [[nodiscard]] inline Optional<String> function() const noexcept { return String{node->first_attribute("domain")}; }
+            [[nodiscard]] inline Optional<Integral> slot() const noexcept { return Integral{node->first_attribute("slot")}; }
+            [[nodiscard]] inline Optional<Integral> function() const noexcept { return Integral{node->first_attribute("function")}; }
             [[nodiscard]] inline std::optional<bool> multifunction() const noexcept {
                 const auto mf_attr = node->first_attribute("multifunction");
                 return mf_attr ? std::optional{static_cast<bool>(*magic_enum::enum_cast<OnOff>(mf_attr->value()))} : std::nullopt;
@@ -1,8 +1,16 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <optional>
 #include <string_view>
+#include <utility>
+#include <vector>
 #include <gsl/gsl>
+#include <magic_enum.hpp>
 #include <rapidxml_ns.hpp>
+#include "cpu_types.hpp"
+#include "domain.hpp"
 #include "generic.hpp"
 #include "xmlspan.hpp"
 #include "xmlval.hpp"
@@ -27,7 +35,7 @@ struct DriverCapabilities {
 
             struct Feature;
             struct FeatureList : public NamedSpan<Feature> {
-                constexpr explicit FeatureList(xml_node<>* node) : NamedSpan<Feature>("feature", node) {}
+                constexpr explicit FeatureList(NodeRef node) : NamedSpan<Feature>("feature", node) {}
             };
 
             struct Feature : public Node {
@@ -43,7 +51,7 @@ struct DriverCapabilities {
             struct MigrationFeatures : public Node {
                 struct UriTransport : public String {};
                 struct UriTransports : public NamedSpan<UriTransport> {
-                    constexpr explicit UriTransports(xml_node<>* node) : NamedSpan<UriTransport>("uri_transport", node) {}
+                    constexpr explicit UriTransports(NodeRef node) : NamedSpan<UriTransport>("uri_transport", node) {}
                 };
 
 #if 1 /* With functions */
@@ -153,26 +161,111 @@ struct DriverCapabilities {
     };
     struct Guest;
     struct GuestList : public NamedSpan<Guest> {
-        constexpr explicit GuestList(xml_node<>* node) : NamedSpan<Guest>("guest", node) {}
+        constexpr explicit GuestList(NodeRef node) : NamedSpan<Guest>("guest", node) {}
     };
 
     struct Guest : public Node {
+        struct Machine : public Node {
 #if 1 /* With functions */
+            constexpr explicit operator String() const noexcept { return String{node}; }
+            [[nodiscard]] inline Optional<String> canonical() const noexcept { return String{node->first_attribute("canonical")}; }
+            [[nodiscard]] inline Optional<Integral> max_cpus() const noexcept { return Integral{node->first_attribute("maxCpus")}; }
 #else /* With paramexpr */
+            using operator String(this s) = String{s.node};
+            using canonical(this s) = String{s.node->first_attribute("canonical")};
+            using max_cpus(this s) = Integral{s.node->first_attribute("maxCpus")};
+#endif
+        };
+        struct Machines : public NamedSpan<Machine> {
+            constexpr explicit Machines(NodeRef node) : NamedSpan<Machine>("machine", node) {}
+        };
+
+        /// A domain type the arch can run, which may override the arch's emulator and machines
+        struct DomainType : public Node {
+#if 1 /* With functions */
+            [[nodiscard]] inline std::optional<Domain::Type> type() const noexcept {
+                const auto type = node->first_attribute("type");
+                return type != nullptr ? magic_enum::enum_cast<Domain::Type>(std::string_view{type->value(), type->value_size()}) : std::nullopt;
+            }
+            [[nodiscard]] inline Optional<String> emulator() const noexcept { return String{node->first_node("emulator")}; }
+            [[nodiscard]] inline Machines machines() const noexcept { return Machines{node}; }
+#else /* With paramexpr */
+            using type(this s) = magic_enum::enum_cast<Domain::Type>(s.node->first_attribute("type")->value());
+            using emulator(this s) = String{s.node->first_node("emulator")};
+            using machines(this s) = Machines{s.node};
+#endif
+        };
+        struct DomainTypes : public NamedSpan<DomainType> {
+            constexpr explicit DomainTypes(NodeRef node) : NamedSpan<DomainType>("domain", node) {}
+        };
+
+        struct Arch : public Node {
+#if 1 /* With functions */
+            /// Empty for arches this library does not know about
+            [[nodiscard]] inline std::optional<cpu::Arch> name() const noexcept {
+                if (node == nullptr)
+                    return std::nullopt;
+                const auto name = node->first_attribute("name");
+                return name != nullptr ? magic_enum::enum_cast<cpu::Arch>(std::string_view{name->value(), name->value_size()}) : std::nullopt;
+            }
+            [[nodiscard]] inline Integral wordsize() const noexcept { return Integral{node->first_node("wordsize")}; }
+            [[nodiscard]] inline Optional<String> emulator() const noexcept { return String{node->first_node("emulator")}; }
+            [[nodiscard]] inline Optional<String> loader() const noexcept { return String{node->first_node("loader")}; }
+            [[nodiscard]] inline Machines machines() const noexcept { return Machines{node}; }
+            [[nodiscard]] inline DomainTypes domains() const noexcept { return DomainTypes{node}; }
+#else /* With paramexpr */
+            using name(this s) = magic_enum::enum_cast<cpu::Arch>(s.node->first_attribute("name")->value());
+            using wordsize(this s) = Integral{s.node->first_node("wordsize")};
+            using emulator(this s) = String{s.node->first_node("emulator")};
+            using loader(this s) = String{s.node->first_node("loader")};
+            using machines(this s) = Machines{s.node};
+            using domains(this s) = DomainTypes{s.node};
+#endif
+        };
+
+        struct Features : public Node {
+#if 1 /* With functions */
+            /// Whether the feature (e.g. "acpi", "pae", "disksnapshot") is listed
+            [[nodiscard]] inline bool has(gsl::czstring<> name) const noexcept { return node->first_node(name) != nullptr; }
+#else /* With paramexpr */
+            using has(this s, gsl::czstring<> name) = s.node->first_node(name) != nullptr;
+#endif
+        };
+
+#if 1 /* With functions */
+        [[nodiscard]] inline std::optional<Domain::Os::TypeValue> os_type() const noexcept {
+            const auto os_type = node->first_node("os_type");
+            if (os_type == nullptr)
+                return std::nullopt;
+            return magic_enum::enum_cast<Domain::Os::TypeValue>(std::string_view{os_type->value(), os_type->value_size()});
+        }
+        [[nodiscard]] inline Arch arch() const noexcept { return Arch{node->first_node("arch")}; }
+        [[nodiscard]] inline Optional<Features> features() const noexcept { return Features{node->first_node("features")}; }
+#else /* With paramexpr */
+        using os_type(this s) = magic_enum::enum_cast<Domain::Os::TypeValue>(s.node->first_node("os_type")->value());
+        using arch(this s) = Arch{s.node->first_node("arch")};
+        using features(this s) = Features{s.node->first_node("features")};
 #endif
     };
 
-    explicit DriverCapabilities(gsl::zstring<> xml) { doc.parse<0>(xml); }
+    explicit DriverCapabilities(gsl::zstring<> xml) {
+        doc.parse<0>(xml);
+        root = doc.first_node("capabilities");
+    }
+    /// Binds to a <capabilities> element owned by someone else (e.g. a snapshot)
+    explicit DriverCapabilities(NodeRef capabilities) : root(capabilities) {}
+
+    friend NodeAccess;
 
 #if 1 /* With functions */
   private:
     // inline auto cap() { return doc.first_node("capabilities"); }
-    [[nodiscard]] inline auto cap() const { return doc.first_node("capabilities"); }
+    [[nodiscard]] inline auto cap() const { return root; }
 
   public:
     // inline auto host() { return Host{cap()->first_node("host")}; }
     [[nodiscard]] inline Host host() const { return {cap()->first_node("host")}; }
-    [[nodiscard]] inline GuestList guest_list() { return GuestList{cap()}; }
+    [[nodiscard]] inline GuestList guest_list() const { return GuestList{cap()}; }
 #else /* With paramexpr */
   private
     using cap(this s) = s.doc.first_node("capabilities");
@@ -182,6 +275,118 @@ struct DriverCapabilities {
 #endif
   private:
     xml_document<> doc{};
+    NodeRef root;
+};
+
+/// Every (OS type, arch, machine, domain type) combination the guest section of a capabilities document offers, hashed once
+/// so that checking a definition costs a probe or two instead of a walk over the guests
+/// Entries refer to the document's text, so the table must not outlive it
+class GuestTable {
+  public:
+    struct Entry {
+        Domain::Os::TypeValue os_type;
+        cpu::Arch arch;
+        Domain::Type type;
+        std::string_view machine;
+        std::string_view canonical; // machine this one is an alias of, if any
+        std::string_view emulator;
+        std::uint32_t max_cpus; // 0 if not reported
+    };
+
+  private:
+    static constexpr std::uint32_t empty = ~std::uint32_t{0};
+    static constexpr std::uint32_t default_key = 1u << 31u; // slot holds the first machine of its (OS type, arch, type), looked up without a machine
+
+    std::vector<Entry> entries;
+    std::vector<std::uint32_t> slots; // open addressing with linear probing, size a power of two
+
+    [[nodiscard]] static inline std::size_t hash(Domain::Os::TypeValue os_type, cpu::Arch arch, Domain::Type type, std::string_view machine) noexcept {
+        const auto key = static_cast<std::size_t>(os_type) << 16u | static_cast<std::size_t>(arch) << 8u | static_cast<std::size_t>(type);
+        return (std::hash<std::string_view>{}(machine) ^ key) * 0x9E3779B97F4A7C15u;
+    }
+    [[nodiscard]] inline bool matches(std::uint32_t slot, Domain::Os::TypeValue os_type, cpu::Arch arch, Domain::Type type,
+                                      std::string_view machine) const noexcept {
+        const auto& entry = entries[slot & ~default_key];
+        return entry.os_type == os_type && entry.arch == arch && entry.type == type &&
+               ((slot & default_key) != 0 ? machine.empty() : entry.machine == machine);
+    }
+    [[nodiscard]] inline std::uint32_t probe(Domain::Os::TypeValue os_type, cpu::Arch arch, Domain::Type type, std::string_view machine) const noexcept {
+        const auto mask = slots.size() - 1;
+        for (auto i = hash(os_type, arch, type, machine) & mask;; i = (i + 1) & mask)
+            if (slots[i] == empty || matches(slots[i], os_type, arch, type, machine))
+                return static_cast<std::uint32_t>(i);
+    }
+    void insert(std::uint32_t index, bool is_default) {
+        const auto& entry = entries[index];
+        auto& slot = slots[probe(entry.os_type, entry.arch, entry.type, is_default ? std::string_view{} : entry.machine)];
+        if (slot == empty) // a machine listed twice keeps its first entry
+            slot = is_default ? index | default_key : index;
+    }
+
+  public:
+    explicit GuestTable(const DriverCapabilities& caps) {
+        const auto text = [](auto value) { return value ? static_cast<std::string_view>(value) : std::string_view{}; };
+        std::vector<bool> defaults;
+        for (const auto guest : caps.guest_list()) {
+            const auto os_type = guest.os_type();
+            const auto arch = guest.arch();
+            const auto arch_name = arch ? arch.name() : std::nullopt;
+            if (!os_type || !arch_name)
+                continue;
+            for (const auto dom : arch.domains()) {
+                const auto type = dom.type();
+                if (!type)
+                    continue;
+                const auto emulator = dom.emulator() ? text(dom.emulator()) : text(arch.emulator());
+                const auto machines = dom.machines().begin() != dom.machines().end() ? dom.machines() : arch.machines();
+                bool first = true;
+                for (const auto machine : machines) {
+                    const auto max_cpus = machine.max_cpus() ? static_cast<unsigned>(machine.max_cpus()) : 0u;
+                    entries.push_back(Entry{*os_type, *arch_name, *type, text(static_cast<String>(machine)), text(machine.canonical()), emulator, max_cpus});
+                    defaults.push_back(std::exchange(first, false));
+                }
+            }
+        }
+        // At most half full, so that probe sequences stay short
+        std::size_t size = 16;
+        while (size < 4 * entries.size())
+            size *= 2;
+        slots.assign(size, empty);
+        for (std::uint32_t i = 0; i < entries.size(); ++i) {
+            insert(i, false);
+            if (defaults[i])
+                insert(i, true);
+        }
+    }
+
+    /// The entry for `machine`, or for the default machine of the OS type, arch and type if `machine` is empty; nullptr if unsupported
+    /// The OS type is part of the key: Xen, for one, offers both xen and hvm guests for the same arch and domain type
+    [[nodiscard]] inline const Entry* find(Domain::Os::TypeValue os_type, cpu::Arch arch, Domain::Type type, std::string_view machine = {}) const noexcept {
+        const auto slot = slots[probe(os_type, arch, type, machine)];
+        return slot != empty ? &entries[slot & ~default_key] : nullptr;
+    }
+    /// The entry a definition would run with, or nullptr if its arch, machine, domain type or OS type is not offered
+    /// Definitions that leave the arch to the host's default do not match
+    [[nodiscard]] inline const Entry* find(Domain dom) const noexcept {
+        const auto os = dom.os();
+        const auto os_type = os ? os.type() : Domain::Os::Type{nullptr};
+        const auto arch = os_type ? os_type.arch() : std::nullopt;
+        const auto type_attr = NodeAccess::of(dom)->first_attribute("type");
+        const auto type = type_attr != nullptr ? enum_cast_xml<Domain::Type>({type_attr->value(), type_attr->value_size()}) : std::nullopt;
+        const auto os_type_value = os_type ? enum_cast_xml<Domain::Os::TypeValue>({NodeAccess::of(os_type)->value(), NodeAccess::of(os_type)->value_size()})
+                                           : std::nullopt;
+        if (!arch || !type || !os_type_value)
+            return nullptr;
+        const auto machine = os_type.machine() ? static_cast<std::string_view>(os_type.machine()) : std::string_view{};
+        return find(*os_type_value, *arch, *type, machine);
+    }
+    [[nodiscard]] inline bool supports(Domain::Os::TypeValue os_type, cpu::Arch arch, Domain::Type type) const noexcept {
+        return find(os_type, arch, type) != nullptr;
+    }
+
+    [[nodiscard]] inline std::size_t size() const noexcept { return entries.size(); }
+    [[nodiscard]] inline auto begin() const noexcept { return entries.begin(); }
+    [[nodiscard]] inline auto end() const noexcept { return entries.end(); }
 };
 } // namespace
 } // namespace virtxml
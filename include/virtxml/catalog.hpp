@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <rapidxml_ns.hpp>
+#include "domain.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// A parsed <domain>, or the <domstatus> libvirt keeps for a running domain, together with the text it was parsed from
+class DomainDocument {
+    std::string text;
+    xml_document<> doc{};
+
+  public:
+    /// Parses `xml` in place; rapidxml reports malformed input by throwing rapidxml_ns::parse_error
+    explicit DomainDocument(std::string xml) : text(std::move(xml)) { doc.parse<0>(text.data()); }
+    DomainDocument(const DomainDocument&) = delete;
+    DomainDocument& operator=(const DomainDocument&) = delete;
+
+    [[nodiscard]] inline Domain domain() const noexcept {
+        if (const auto status = doc.first_node("domstatus"))
+            return Domain{status->first_node("domain")};
+        return Domain{doc.first_node("domain")};
+    }
+    /// The UUID of the domain, 0 if it has none
+    [[nodiscard]] inline __uint128_t uuid() const noexcept {
+        const auto dom = domain();
+        return dom && dom.uuid() ? static_cast<__uint128_t>(dom.uuid()) : __uint128_t{};
+    }
+};
+
+/// Catalog of parsed domains keyed by UUID, read concurrently without locks while writers publish new versions
+/// Readers pin an epoch through a Guard; documents replaced or erased are freed once no guard from an older epoch remains
+/// Writers are serialized among themselves, and parse before publishing, so readers never wait on a parse
+class DomainCatalog {
+  public:
+    using Key = __uint128_t;
+
+  private:
+    struct KeyHash {
+        [[nodiscard]] inline std::size_t operator()(Key key) const noexcept {
+            return std::hash<std::uint64_t>{}(static_cast<std::uint64_t>(key) ^ static_cast<std::uint64_t>(key >> 64u) * 0x9E3779B97F4A7C15u);
+        }
+    };
+    /// Where successive versions of one domain are published
+    struct Slot {
+        std::atomic<const DomainDocument*> current{nullptr};
+    };
+    using Index = std::unordered_map<Key, Slot*, KeyHash>;
+
+    struct alignas(64) ReaderEpoch {
+        std::atomic<std::uint64_t> epoch{0}; // 0 while the reader slot is free
+    };
+    struct Retired {
+        std::uint64_t epoch;
+        std::unique_ptr<const DomainDocument> document;
+        std::unique_ptr<Slot> slot;
+        std::unique_ptr<const Index> index;
+    };
+
+    std::atomic<std::uint64_t> global_epoch{1};
+    std::atomic<const Index*> index{new Index{}};
+    std::unique_ptr<ReaderEpoch[]> readers;
+    std::size_t reader_count;
+    std::mutex writer;
+    std::vector<Retired> retired;
+
+    /// Lowest epoch pinned by a reader, or the current epoch if none is
+    [[nodiscard]] std::uint64_t oldest_pinned() const noexcept {
+        auto ret = global_epoch.load();
+        for (std::size_t i = 0; i < reader_count; ++i)
+            if (const auto e = readers[i].epoch.load(); e != 0)
+                ret = std::min(ret, e);
+        return ret;
+    }
+
+    // Called with the writer lock held, after the retired objects have been unlinked
+    void retire(Retired item) {
+        item.epoch = global_epoch.fetch_add(1);
+        retired.push_back(std::move(item));
+        const auto oldest = oldest_pinned();
+        retired.erase(std::remove_if(retired.begin(), retired.end(), [oldest](const Retired& r) { return r.epoch < oldest; }), retired.end());
+    }
+
+  public:
+    /// Pins the epoch for the lifetime of the guard; everything read through it stays valid until it is destroyed
+    class Guard {
+        friend DomainCatalog;
+        const DomainCatalog* catalog;
+        ReaderEpoch* pinned;
+        const Index* index;
+
+        explicit Guard(const DomainCatalog& catalog) noexcept : catalog(&catalog) {
+            // Reader slots are claimed with a CAS; a thread only spins when more guards are alive than there are slots
+            const auto start = std::hash<std::thread::id>{}(std::this_thread::get_id());
+            for (std::size_t i = 0;; ++i) {
+                auto& slot = catalog.readers[(start + i) % catalog.reader_count];
+                std::uint64_t expected = 0;
+                if (slot.epoch.compare_exchange_weak(expected, catalog.global_epoch.load())) {
+                    pinned = &slot;
+                    break;
+                }
+            }
+            index = catalog.index.load();
+        }
+
+      public:
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard() { pinned->epoch.store(0, std::memory_order_release); }
+
+        /// Latest version of the domain `uuid`, or nullptr
+        [[nodiscard]] inline const DomainDocument* find(Key uuid) const noexcept {
+            const auto it = index->find(uuid);
+            return it != index->end() ? it->second->current.load() : nullptr;
+        }
+        [[nodiscard]] inline std::size_t size() const noexcept { return index->size(); }
+        /// Calls `fn(Key, const DomainDocument&)` for every domain in the catalog
+        template <class F> void for_each(F&& fn) const {
+            for (const auto& [uuid, slot] : *index)
+                if (const auto doc = slot->current.load())
+                    fn(uuid, *doc);
+        }
+    };
+
+    explicit DomainCatalog(std::size_t max_readers = 4 * std::max(1u, std::thread::hardware_concurrency()))
+        : readers(new ReaderEpoch[std::max<std::size_t>(1, max_readers)]), reader_count(std::max<std::size_t>(1, max_readers)) {}
+    DomainCatalog(const DomainCatalog&) = delete;
+    DomainCatalog& operator=(const DomainCatalog&) = delete;
+    ~DomainCatalog() {
+        const auto idx = index.load();
+        for (const auto& [uuid, slot] : *idx) {
+            delete slot->current.load();
+            delete slot;
+        }
+        delete idx;
+    }
+
+    [[nodiscard]] inline Guard read() const noexcept { return Guard{*this}; }
+
+    /// Publishes `doc` as the current version of its domain; returns false if it has no UUID
+    bool publish(std::unique_ptr<const DomainDocument> doc) {
+        const auto uuid = doc->uuid();
+        if (uuid == 0)
+            return false;
+        std::lock_guard lock{writer};
+        const auto idx = index.load();
+        if (const auto it = idx->find(uuid); it != idx->end()) {
+            retire(Retired{0, std::unique_ptr<const DomainDocument>{it->second->current.exchange(doc.release())}, nullptr, nullptr});
+            return true;
+        }
+        // New domains copy the index, so lookups never see it change under them
+        auto slot = std::make_unique<Slot>();
+        slot->current.store(doc.release());
+        auto next = std::make_unique<Index>(*idx);
+        next->emplace(uuid, slot.release());
+        index.store(next.release());
+        retire(Retired{0, nullptr, nullptr, std::unique_ptr<const Index>{idx}});
+        return true;
+    }
+    /// Parses `xml` on the calling thread, then publishes it
+    bool publish(std::string xml) { return publish(std::make_unique<const DomainDocument>(std::move(xml))); }
+
+    bool erase(Key uuid) {
+        std::lock_guard lock{writer};
+        const auto idx = index.load();
+        const auto it = idx->find(uuid);
+        if (it == idx->end())
+            return false;
+        auto next = std::make_unique<Index>(*idx);
+        next->erase(uuid);
+        std::unique_ptr<Slot> slot{it->second};
+        std::unique_ptr<const DomainDocument> doc{slot->current.load()};
+        index.store(next.release());
+        retire(Retired{0, std::move(doc), std::move(slot), std::unique_ptr<const Index>{idx}});
+        return true;
+    }
+
+    /// Frees whatever no reader can still reach; publishing and erasing already do so
+    void collect() {
+        std::lock_guard lock{writer};
+        const auto oldest = oldest_pinned();
+        retired.erase(std::remove_if(retired.begin(), retired.end(), [oldest](const Retired& r) { return r.epoch < oldest; }), retired.end());
+    }
+};
+
+} // namespace
+} // namespace virtxml
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <gsl/gsl>
+#include <rapidxml_ns.hpp>
+#include "generic.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// A parsed document held in a single allocation of exactly the size it needs
+/// An xml_document embeds a RAPIDXML_STATIC_POOL_SIZE (64 KiB) pool, mostly empty for the small documents libvirt returns for
+/// node devices, secrets or volumes; here the input is parsed once in a per-thread scratch document, whose pool is reused,
+/// and the tree is then copied into one block holding its nodes, attributes and strings, after which the input is released
+/// The copy is made of plain xml_node and xml_attribute objects, so every view works over it; namespace URIs are not carried over
+class CompactDocument {
+    std::unique_ptr<char[]> block;
+    std::size_t size = 0;
+    xml_node<>* root = nullptr;
+
+    struct Layout {
+        std::size_t nodes = 0;
+        std::size_t attributes = 0;
+        std::size_t chars = 0;
+    };
+
+    [[nodiscard]] static inline std::size_t text_size(std::size_t size) noexcept { return size != 0 ? size + 1 : 0; }
+
+    static void measure(const xml_node<>* node, Layout& layout) noexcept {
+        ++layout.nodes;
+        layout.chars += text_size(node->name_size()) + text_size(node->value_size());
+        for (auto attr = node->first_attribute(); attr != nullptr; attr = attr->next_attribute()) {
+            ++layout.attributes;
+            layout.chars += text_size(attr->name_size()) + text_size(attr->value_size());
+        }
+        for (auto child = node->first_node(); child != nullptr; child = child->next_sibling())
+            measure(child, layout);
+    }
+
+    /// Bump allocation out of the block, which `measure` sized exactly
+    struct Writer {
+        xml_node<>* nodes;
+        xml_attribute<>* attributes;
+        char* chars;
+
+        [[nodiscard]] inline const char* copy(const char* text, std::size_t size) noexcept {
+            if (size == 0)
+                return nullptr;
+            const auto ret = chars;
+            std::memcpy(chars, text, size);
+            chars[size] = '\0';
+            chars += size + 1;
+            return ret;
+        }
+
+        xml_node<>* clone(const xml_node<>* from) noexcept {
+            const auto to = new (nodes++) xml_node<>(from->type());
+            if (const auto name = copy(from->name(), from->name_size()))
+                to->name(name, from->name_size());
+            if (const auto value = copy(from->value(), from->value_size()))
+                to->value(value, from->value_size());
+            for (auto attr = from->first_attribute(); attr != nullptr; attr = attr->next_attribute()) {
+                const auto copied = new (attributes++) xml_attribute<>();
+                if (const auto name = copy(attr->name(), attr->name_size()))
+                    copied->name(name, attr->name_size());
+                if (const auto value = copy(attr->value(), attr->value_size()))
+                    copied->value(value, attr->value_size());
+                to->append_attribute(copied);
+            }
+            for (auto child = from->first_node(); child != nullptr; child = child->next_sibling())
+                to->append_node(clone(child));
+            return to;
+        }
+    };
+
+    static_assert(std::is_trivially_destructible_v<xml_node<>> && std::is_trivially_destructible_v<xml_attribute<>>,
+                  "the block is released without destroying its nodes");
+    static_assert(alignof(xml_node<>) >= alignof(xml_attribute<>) && alignof(xml_attribute<>) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                  "nodes, then attributes, are laid out from the start of the block");
+
+  public:
+    /// Parses `xml`; rapidxml reports malformed input by throwing rapidxml_ns::parse_error
+    explicit CompactDocument(std::string xml) {
+        thread_local xml_document<> scratch;
+        scratch.clear();
+        scratch.parse<0>(xml.data());
+
+        Layout layout;
+        measure(&scratch, layout);
+        size = layout.nodes * sizeof(xml_node<>) + layout.attributes * sizeof(xml_attribute<>) + layout.chars;
+        block = std::make_unique<char[]>(size);
+        const auto attributes = block.get() + layout.nodes * sizeof(xml_node<>);
+        Writer writer{reinterpret_cast<xml_node<>*>(block.get()), reinterpret_cast<xml_attribute<>*>(attributes),
+                      attributes + layout.attributes * sizeof(xml_attribute<>)};
+        root = writer.clone(&scratch);
+        scratch.clear();
+    }
+    CompactDocument(CompactDocument&& other) noexcept
+        : block(std::move(other.block)), size(std::exchange(other.size, 0)), root(std::exchange(other.root, nullptr)) {}
+    CompactDocument& operator=(CompactDocument&& other) noexcept {
+        block = std::move(other.block);
+        size = std::exchange(other.size, 0);
+        root = std::exchange(other.root, nullptr);
+        return *this;
+    }
+    CompactDocument(const CompactDocument&) = delete;
+    CompactDocument& operator=(const CompactDocument&) = delete;
+
+    /// The document node, parent of the root element
+    [[nodiscard]] inline xml_node<>* document() const noexcept { return root; }
+    /// The root element `name` as a view, e.g. `doc.root_as<Secret>("secret")`; null if the root element is named otherwise,
+    /// or if the document was moved from
+    template <class View> [[nodiscard]] inline View root_as(gsl::czstring<> name) const noexcept {
+        return View{root != nullptr ? root->first_node(name) : nullptr};
+    }
+
+    /// Bytes held by the document, all in one block
+    [[nodiscard]] inline std::size_t memory_usage() const noexcept { return size; }
+};
+
+} // namespace
+} // namespace virtxml
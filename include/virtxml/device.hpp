@@ -22,7 +22,7 @@ struct Device : public Node {
 
         [[nodiscard]] inline Type type() const noexcept { return *magic_enum::enum_cast<Type>(node->first_attribute("type")->value()); }
     };
-    struct Parent : public Node {
+    struct Parent : public StringNode {
         [[nodiscard]] inline Optional<Integral> wwnn() const noexcept { return Integral{node->first_attribute("wwnn")}; }
         [[nodiscard]] inline Optional<Integral> wwpn() const noexcept { return Integral{node->first_attribute("wwpn")}; }
         [[nodiscard]] inline Optional<Integral> fabric_wwn() const noexcept { return Integral{node->first_attribute("fabric_wwn")}; }
@@ -129,22 +129,26 @@ struct Device : public Node {
         };
         struct IommuGroup : public Node {
             [[nodiscard]] inline Integral number() const noexcept { return Integral{node->first_attribute("number")}; }
+            [[nodiscard]] inline NamedSpan<SubCapability::Address> addresses() const noexcept {
+                return NamedSpan<SubCapability::Address>{"address", node};
+            }
         };
 
         [[nodiscard]] inline Optional<MdevType> mdev_type() const noexcept { return MdevType{node->first_node("type")}; }
         [[nodiscard]] inline DrmType drm_type() const noexcept { return *magic_enum::enum_cast<DrmType>(node->first_attribute("type")->value()); }
         [[nodiscard]] inline Type type() const noexcept { return *magic_enum::enum_cast<Type>(node->first_attribute("type")->value()); }
+        [[nodiscard]] inline String type_str() const noexcept { return String{node->first_attribute("type")}; }
         [[nodiscard]] inline Optional<Integral> class_() const noexcept { return Integral{node->first_node("class")}; }
-        [[nodiscard]] inline Integral domain() const noexcept { return Integral{node->first_attribute("vendor")}; }
-        [[nodiscard]] inline Integral bus() const noexcept { return Integral{node->first_attribute("bus")}; }
-        [[nodiscard]] inline Integral slot() const noexcept { return Integral{node->first_attribute("slot")}; }
-        [[nodiscard]] inline Integral function() const noexcept { return Integral{node->first_attribute("function")}; }
+        [[nodiscard]] inline Integral domain() const noexcept { return Integral{node->first_node("domain")}; }
+        [[nodiscard]] inline Integral bus() const noexcept { return Integral{node->first_node("bus")}; }
+        [[nodiscard]] inline Integral slot() const noexcept { return Integral{node->first_node("slot")}; }
+        [[nodiscard]] inline Integral function() const noexcept { return Integral{node->first_node("function")}; }
         [[nodiscard]] inline Integral device() const noexcept { return Integral{node->first_attribute("device")}; }
         [[nodiscard]] inline Integral number() const noexcept { return Integral{node->first_attribute("number")}; }
         [[nodiscard]] inline Integral subclass() const noexcept { return Integral{node->first_attribute("subclass")}; }
         [[nodiscard]] inline Integral protocol() const noexcept { return Integral{node->first_attribute("protocol")}; }
         [[nodiscard]] inline Optional<String> description() const noexcept { return String{node->first_attribute("description")}; }
-        [[nodiscard]] inline String interface() const noexcept { return String{node->first_attribute("interface")}; }
+        [[nodiscard]] inline String interface() const noexcept { return String{node->first_node("interface")}; }
         [[nodiscard]] inline Optional<String> address() const noexcept { return String{node->first_attribute("address")}; }
         [[nodiscard]] inline NamedSpan<Feature> features() const noexcept { return NamedSpan<Feature>{"feature", node}; }
         [[nodiscard]] inline NamedSpan<Capability> capabilities() const noexcept { return NamedSpan<Capability>{"capability", node}; }
@@ -153,6 +157,7 @@ struct Device : public Node {
         [[nodiscard]] inline Integral target() const noexcept { return Integral{node->first_node("target")}; }
         [[nodiscard]] inline Integral lun() const noexcept { return Integral{node->first_node("lun")}; }
         [[nodiscard]] inline Optional<Capability> capability() const noexcept { return Capability{node->first_node("capability")}; };
+        [[nodiscard]] inline Optional<IommuGroup> iommu_group() const noexcept { return IommuGroup{node->first_node("iommuGroup")}; }
         [[nodiscard]] inline String block() const noexcept { return String{node->first_node("block")}; }
         [[nodiscard]] inline Optional<String> drive_type() const noexcept { return String{node->first_node("drive_type")}; }
         [[nodiscard]] inline Optional<String> model() const noexcept { return String{node->first_node("model")}; }
@@ -167,6 +172,7 @@ struct Device : public Node {
     [[nodiscard]] inline Optional<String> path() const noexcept { return String{node->first_node("path")}; }
     [[nodiscard]] inline Optional<DevNode> dev_node() const noexcept { return DevNode{node->first_node("devnode")}; }
     [[nodiscard]] inline Optional<Parent> parent() const noexcept { return Parent{node->first_node("parent")}; }
+    [[nodiscard]] inline Optional<Driver> driver() const noexcept { return Driver{node->first_node("driver")}; }
     [[nodiscard]] inline Optional<Capability> capability() const noexcept { return Capability{node->first_node("capability")}; }
     [[nodiscard]] inline Optional<String> product() const noexcept { return String{node->first_node("product")}; }
 }; // namespace
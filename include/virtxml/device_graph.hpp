@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <magic_enum.hpp>
+#include "device.hpp"
+#include "generic.hpp"
+#include "xmlval.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Host-wide index over the node devices of a host (as listed by virConnectListAllNodeDevices)
+/// The graph stores views; the documents they point into must outlive it
+class DeviceGraph {
+  public:
+    using Index = std::uint32_t;
+    using IndexList = std::vector<Index>;
+    constexpr static Index npos = ~Index{0};
+
+  private:
+    struct Vertex {
+        Device device;
+        std::string_view parent_name;
+        Index parent = npos;
+        std::uint32_t pci = npos;
+        Index iommu_group = npos;
+        Index children_begin = 0;
+        Index children_end = 0;
+    };
+
+    std::vector<Vertex> vertices;
+    IndexList children_store;
+    std::unordered_map<std::string_view, Index> by_name;
+    std::unordered_map<std::uint32_t, Index> by_pci;
+    std::unordered_map<unsigned, IndexList> by_iommu_group;
+    std::unordered_map<std::string_view, Index> by_net_interface;
+    std::unordered_map<std::string_view, Index> by_block;
+
+    inline static const IndexList empty_list{};
+
+    void index_capability(Index idx, Device::Capability cap) {
+        const auto type_str = cap.type_str();
+        if (!type_str)
+            return;
+        switch (magic_enum::enum_cast<Device::Capability::Type>(static_cast<std::string_view>(type_str)).value_or(Device::Capability::Type::system)) {
+        case Device::Capability::Type::pci:
+            if (cap.domain() && cap.bus() && cap.slot() && cap.function()) {
+                vertices[idx].pci = pack_pci_address(static_cast<unsigned>(cap.domain()), static_cast<unsigned>(cap.bus()),
+                                                     static_cast<unsigned>(cap.slot()), static_cast<unsigned>(cap.function()));
+                by_pci.emplace(vertices[idx].pci, idx);
+            }
+            if (const auto group = cap.iommu_group(); group && group.number()) {
+                vertices[idx].iommu_group = static_cast<unsigned>(group.number());
+                by_iommu_group[vertices[idx].iommu_group].push_back(idx);
+            }
+            break;
+        case Device::Capability::Type::net:
+            if (const auto ifname = cap.interface().value_or({}); !ifname.empty())
+                by_net_interface.emplace(ifname, idx);
+            break;
+        case Device::Capability::Type::storage:
+            if (const auto block = cap.block().value_or({}); !block.empty())
+                by_block.emplace(block, idx);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void link() {
+        std::vector<Index> child_counts(vertices.size(), 0);
+        for (auto& v : vertices) {
+            if (v.parent_name.empty())
+                continue;
+            if (const auto it = by_name.find(v.parent_name); it != by_name.end()) {
+                v.parent = it->second;
+                ++child_counts[it->second];
+            }
+        }
+
+        Index offset = 0;
+        for (Index i = 0; i < vertices.size(); ++i) {
+            vertices[i].children_begin = vertices[i].children_end = offset;
+            offset += child_counts[i];
+        }
+        children_store.resize(offset);
+        for (Index i = 0; i < vertices.size(); ++i)
+            if (const auto p = vertices[i].parent; p != npos)
+                children_store[vertices[p].children_end++] = i;
+    }
+
+  public:
+    class Children {
+        const Index* first;
+        const Index* last;
+
+      public:
+        constexpr Children(const Index* first, const Index* last) noexcept : first(first), last(last) {}
+        [[nodiscard]] constexpr const Index* begin() const noexcept { return first; }
+        [[nodiscard]] constexpr const Index* end() const noexcept { return last; }
+        [[nodiscard]] constexpr std::size_t size() const noexcept { return static_cast<std::size_t>(last - first); }
+        [[nodiscard]] constexpr bool empty() const noexcept { return first == last; }
+    };
+
+    DeviceGraph() = default;
+
+    /// Builds the graph in one pass over `devices`, a range of `Device` views
+    template <class Range> explicit DeviceGraph(const Range& devices) {
+        for (const Device dev : devices) {
+            const auto idx = static_cast<Index>(vertices.size());
+            const auto name = dev.name().value_or({});
+            const auto parent = dev.parent();
+            vertices.push_back(Vertex{dev, parent ? static_cast<std::string_view>(parent) : std::string_view{}});
+            if (!name.empty())
+                by_name.emplace(name, idx);
+            if (const auto cap = dev.capability(); cap)
+                index_capability(idx, cap);
+        }
+        link();
+    }
+
+    [[nodiscard]] inline std::size_t size() const noexcept { return vertices.size(); }
+    [[nodiscard]] inline Device operator[](Index idx) const noexcept { return vertices[idx].device; }
+    [[nodiscard]] inline std::optional<Index> parent(Index idx) const noexcept {
+        const auto p = vertices[idx].parent;
+        return p != npos ? std::optional{p} : std::nullopt;
+    }
+    [[nodiscard]] inline std::optional<std::uint32_t> pci_address(Index idx) const noexcept {
+        const auto pci = vertices[idx].pci;
+        return pci != npos ? std::optional{pci} : std::nullopt;
+    }
+    [[nodiscard]] inline std::optional<unsigned> iommu_group_of(Index idx) const noexcept {
+        const auto group = vertices[idx].iommu_group;
+        return group != npos ? std::optional<unsigned>{group} : std::nullopt;
+    }
+    [[nodiscard]] inline Children children(Index idx) const noexcept {
+        const auto& v = vertices[idx];
+        return {children_store.data() + v.children_begin, children_store.data() + v.children_end};
+    }
+
+    [[nodiscard]] inline std::optional<Index> find(std::string_view name) const noexcept {
+        const auto it = by_name.find(name);
+        return it != by_name.end() ? std::optional{it->second} : std::nullopt;
+    }
+    [[nodiscard]] inline std::optional<Index> find_pci(std::uint32_t packed_address) const noexcept {
+        const auto it = by_pci.find(packed_address);
+        return it != by_pci.end() ? std::optional{it->second} : std::nullopt;
+    }
+    [[nodiscard]] inline std::optional<Index> find_pci(unsigned domain, unsigned bus, unsigned slot, unsigned function) const noexcept {
+        return find_pci(pack_pci_address(domain, bus, slot, function));
+    }
+    [[nodiscard]] inline const IndexList& iommu_group(unsigned number) const noexcept {
+        const auto it = by_iommu_group.find(number);
+        return it != by_iommu_group.end() ? it->second : empty_list;
+    }
+    [[nodiscard]] inline std::optional<Index> find_net_interface(std::string_view ifname) const noexcept {
+        const auto it = by_net_interface.find(ifname);
+        return it != by_net_interface.end() ? std::optional{it->second} : std::nullopt;
+    }
+    [[nodiscard]] inline std::optional<Index> find_block(std::string_view dev) const noexcept {
+        const auto it = by_block.find(dev);
+        return it != by_block.end() ? std::optional{it->second} : std::nullopt;
+    }
+};
+
+} // namespace
+} // namespace virtxml
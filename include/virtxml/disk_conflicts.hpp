@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "backing_chain.hpp"
+#include "domain.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Canonical identity of the storage behind a disk source, with its hash computed once
+struct DiskSourceKey {
+    std::string canonical;
+    std::size_t hash = 0;
+
+    struct Hash {
+        [[nodiscard]] inline std::size_t operator()(const DiskSourceKey& key) const noexcept { return key.hash; }
+    };
+
+    explicit DiskSourceKey(std::string canonical) : canonical(std::move(canonical)), hash(std::hash<std::string>{}(this->canonical)) {}
+
+    [[nodiscard]] inline bool operator==(const DiskSourceKey& oth) const noexcept { return hash == oth.hash && canonical == oth.canonical; }
+};
+
+namespace impl {
+// Lexical normalization: collapses repeated slashes, "." and ".." components
+inline void append_normalized_path(std::string& out, std::string_view path) {
+    const auto root = out.size();
+    std::size_t pos = 0;
+    while (pos < path.size()) {
+        const auto next = std::min(path.find('/', pos), path.size());
+        const auto component = path.substr(pos, next - pos);
+        pos = next + 1;
+        if (component.empty() || component == ".")
+            continue;
+        if (component == "..") {
+            const auto slash = out.rfind('/');
+            out.resize(slash != std::string::npos && slash >= root ? slash : root);
+            continue;
+        }
+        out += '/';
+        out += component;
+    }
+    if (out.size() == root)
+        out += '/';
+}
+} // namespace impl
+
+/// Canonicalizes a disk or backing store source; returns nothing for sources that name no storage (e.g. an empty cdrom)
+[[nodiscard]] inline std::optional<DiskSourceKey> canonical_disk_source(std::optional<Domain::Devices::Disk::Type> type,
+                                                                         Domain::Devices::Disk::Source source) {
+    using Disk = Domain::Devices::Disk;
+    if (!source)
+        return std::nullopt;
+    if (!type) {
+        if (source.file())
+            type = Disk::Type::file;
+        else if (source.dev())
+            type = Disk::Type::block;
+        else if (source.pool())
+            type = Disk::Type::volume;
+        else if (source.protocol())
+            type = Disk::Type::network;
+        else if (source.dir())
+            type = Disk::Type::dir;
+        else
+            return std::nullopt;
+    }
+
+    std::string ret;
+    switch (*type) {
+    case Disk::Type::file:
+    case Disk::Type::block:
+    case Disk::Type::dir: {
+        const auto path = (*type == Disk::Type::file ? source.file() : *type == Disk::Type::block ? source.dev() : source.dir()).value_or({});
+        if (path.empty())
+            return std::nullopt;
+        // Files and block devices share a namespace: /dev/sda can appear as either
+        ret = *type == Disk::Type::dir ? "dir:" : "path:";
+        impl::append_normalized_path(ret, path);
+        break;
+    }
+    case Disk::Type::volume: {
+        const auto pool = source.pool().value_or({});
+        const auto volume = source.volume().value_or({});
+        if (pool.empty() || volume.empty())
+            return std::nullopt;
+        ret.append("volume:").append(pool).append("/").append(volume);
+        break;
+    }
+    case Disk::Type::network: {
+        const auto protocol = source.protocol();
+        const auto name = source.name().value_or({});
+        if (!protocol)
+            return std::nullopt;
+        ret.append(magic_enum::enum_name(*protocol)).append(":");
+        switch (*protocol) {
+        case Disk::Source::Protocol::rbd:
+        case Disk::Source::Protocol::sheepdog:
+        case Disk::Source::Protocol::gluster:
+        case Disk::Source::Protocol::vxhs:
+            // Cluster protocols: the hosts are monitors or bricks, the image name alone identifies the storage
+            break;
+        default:
+            if (const auto hosts = source.hosts(); hosts.begin() != hosts.end()) {
+                const auto host = *hosts.begin();
+                ret.append(host.name().value_or(host.socket().value_or({})));
+                if (host.port())
+                    ret.append(":").append(std::to_string(static_cast<unsigned>(host.port())));
+            }
+            ret.append("/");
+            break;
+        }
+        ret.append(name);
+        break;
+    }
+    }
+    return DiskSourceKey{std::move(ret)};
+}
+
+/// Detects storage written by one domain while being used by another, across all the domains of a fleet
+/// Every layer of every disk's backing chain is indexed; only the active layer of a writable disk counts as a writer
+template <class Key = std::string> class DiskConflictDetector {
+  public:
+    using Disk = Domain::Devices::Disk;
+
+    struct Use {
+        Key domain;
+        Disk disk;
+        std::uint32_t layer; // position in the backing chain, 0 being the active image
+        bool writable;
+        bool shareable;
+    };
+
+    struct Conflict {
+        const DiskSourceKey* source;
+        const std::vector<Use>* uses;
+    };
+
+  private:
+    using Entries = std::unordered_map<DiskSourceKey, std::vector<Use>, DiskSourceKey::Hash>;
+    using Record = std::pair<DiskSourceKey, Use>;
+
+    struct Shard {
+        Entries entries;
+        std::unordered_set<const DiskSourceKey*> conflicting;
+    };
+
+    std::vector<Shard> shards;
+    std::unordered_map<Key, std::vector<DiskSourceKey>> domain_sources;
+
+    [[nodiscard]] inline Shard& shard_of(const DiskSourceKey& key) noexcept { return shards[key.hash % shards.size()]; }
+
+    [[nodiscard]] static bool is_conflict(const std::vector<Use>& uses) noexcept {
+        for (const auto& writer : uses) {
+            if (!writer.writable)
+                continue;
+            for (const auto& other : uses)
+                if (other.domain != writer.domain && !(writer.shareable && other.shareable))
+                    return true;
+        }
+        return false;
+    }
+
+    static void evaluate(Shard& shard, typename Entries::iterator it) {
+        if (it->second.empty()) {
+            shard.conflicting.erase(&it->first);
+            shard.entries.erase(it);
+        } else if (is_conflict(it->second)) {
+            shard.conflicting.insert(&it->first);
+        } else {
+            shard.conflicting.erase(&it->first);
+        }
+    }
+
+    template <class F> static void for_each_use(const Key& key, Domain dom, F&& fn) {
+        const auto devices = dom.devices();
+        if (!devices)
+            return;
+        for (const auto disk : devices.disks()) {
+            const auto device = disk.device().value_or(Disk::Device::disk);
+            const bool readonly = disk.readonly() || device == Disk::Device::cdrom;
+            const bool shareable = disk.shareable();
+            const BackingChain chain{disk};
+            for (std::uint32_t layer = 0; layer < chain.size(); ++layer) {
+                auto source = canonical_disk_source(chain[layer].type, chain[layer].source);
+                if (source)
+                    fn(std::move(*source), Use{key, disk, layer, layer == 0 && !readonly, shareable});
+            }
+        }
+    }
+
+  public:
+    explicit DiskConflictDetector(unsigned shard_count = std::max(1u, std::thread::hardware_concurrency())) : shards(std::max(1u, shard_count)) {}
+
+    /// Indexes `domains`, a random-access range of (Key, Domain) pairs, with one thread per shard, replacing whatever was indexed before
+    /// Records are extracted from the documents in parallel, then each shard is built by a single thread
+    /// An exception thrown by any of the threads is rethrown once all of them are joined, leaving the detector empty
+    template <class Range> void build(const Range& domains) {
+        clear();
+        const auto threads = static_cast<unsigned>(shards.size());
+        const auto count = static_cast<std::size_t>(std::size(domains));
+        std::vector<std::vector<std::vector<Record>>> buckets(threads, std::vector<std::vector<Record>>(threads));
+        std::vector<std::vector<std::pair<Key, std::vector<DiskSourceKey>>>> sources(threads);
+
+        auto run = [this, threads](auto&& fn) {
+            std::vector<std::exception_ptr> errors(threads);
+            const auto guarded = [&](unsigned t) {
+                try {
+                    fn(t);
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            };
+            std::vector<std::thread> workers;
+            workers.reserve(threads - 1);
+            try {
+                for (unsigned t = 1; t < threads; ++t)
+                    workers.emplace_back(guarded, t);
+            } catch (...) {
+                // Could not start a thread: the ones already running must still be joined before unwinding
+                for (auto& worker : workers)
+                    worker.join();
+                clear();
+                throw;
+            }
+            guarded(0u);
+            for (auto& worker : workers)
+                worker.join();
+            for (const auto& error : errors) {
+                if (error) {
+                    clear();
+                    std::rethrow_exception(error);
+                }
+            }
+        };
+
+        run([&](unsigned t) {
+            for (auto i = count * t / threads; i < count * (t + 1) / threads; ++i) {
+                const auto& [key, dom] = domains[i];
+                auto& dom_sources = sources[t].emplace_back(key, std::vector<DiskSourceKey>{}).second;
+                for_each_use(key, dom, [&](DiskSourceKey&& source, Use&& use) {
+                    dom_sources.push_back(source);
+                    auto& bucket = buckets[t][source.hash % threads];
+                    bucket.emplace_back(std::move(source), std::move(use));
+                });
+            }
+        });
+
+        run([&](unsigned s) {
+            auto& shard = shards[s];
+            for (auto& per_thread : buckets)
+                for (auto& [source, use] : per_thread[s])
+                    shard.entries[std::move(source)].push_back(std::move(use));
+            for (auto it = shard.entries.begin(); it != shard.entries.end(); ++it)
+                if (is_conflict(it->second))
+                    shard.conflicting.insert(&it->first);
+        });
+
+        for (auto& per_thread : sources)
+            for (auto& [key, list] : per_thread)
+                domain_sources[key] = std::move(list);
+    }
+
+    /// Forgets every domain
+    void clear() noexcept {
+        for (auto& shard : shards) {
+            shard.entries.clear();
+            shard.conflicting.clear();
+        }
+        domain_sources.clear();
+    }
+
+    /// Re-indexes a single domain, replacing whatever was recorded under `key` before
+    void update_domain(const Key& key, Domain dom) {
+        remove_domain(key);
+        auto& dom_sources = domain_sources[key];
+        for_each_use(key, dom, [&](DiskSourceKey&& source, Use&& use) {
+            dom_sources.push_back(source);
+            auto& shard = shard_of(source);
+            const auto it = shard.entries.try_emplace(std::move(source)).first;
+            it->second.push_back(std::move(use));
+            evaluate(shard, it);
+        });
+    }
+
+    void remove_domain(const Key& key) {
+        const auto dom_it = domain_sources.find(key);
+        if (dom_it == domain_sources.end())
+            return;
+        for (const auto& source : dom_it->second) {
+            auto& shard = shard_of(source);
+            const auto it = shard.entries.find(source);
+            if (it == shard.entries.end())
+                continue;
+            auto& uses = it->second;
+            uses.erase(std::remove_if(uses.begin(), uses.end(), [&](const Use& use) { return use.domain == key; }), uses.end());
+            evaluate(shard, it);
+        }
+        domain_sources.erase(dom_it);
+    }
+
+    /// Uses of the storage named by `source`, if any domain uses it
+    [[nodiscard]] const std::vector<Use>* find(const DiskSourceKey& source) const noexcept {
+        const auto& shard = shards[source.hash % shards.size()];
+        const auto it = shard.entries.find(source);
+        return it != shard.entries.end() ? &it->second : nullptr;
+    }
+
+    /// Current write-sharing conflicts; the pointers stay valid until the next update
+    [[nodiscard]] std::vector<Conflict> conflicts() const {
+        std::vector<Conflict> ret;
+        for (const auto& shard : shards)
+            for (const auto source : shard.conflicting)
+                ret.push_back(Conflict{source, &shard.entries.find(*source)->second});
+        return ret;
+    }
+};
+
+} // namespace
+} // namespace virtxml
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <optional>
 #include <string_view>
 #include <gsl/gsl>
 #include <magic_enum.hpp>
@@ -39,10 +42,12 @@ struct Rom : public Node {
     [[nodiscard]] inline Optional<String> file() const noexcept { return String{node->first_attribute("file")}; }
 };
 struct Reconnect : public Node {
-    [[nodiscard]] inline bool enabled() const noexcept { return static_cast<bool>(*magic_enum::enum_cast<YesNo>(node->first_attribute("enabled"))); }
+    [[nodiscard]] inline bool enabled() const noexcept { return bool_wrap_attr<YesNo>(node, "enabled"); }
     [[nodiscard]] inline Optional<Integral> timeout() const noexcept { return Integral{node->first_attribute("timeout")}; }
 };
 
+struct PackedAddress;
+
 struct Address : public Node {
     enum class Type {
         pci,
@@ -57,10 +62,10 @@ struct Address : public Node {
         dimm,
     };
 
-    [[nodiscard]] inline Type type() const noexcept { return *magic_enum::enum_cast<Type>(node->first_attribute("type")->value()); }
+    [[nodiscard]] inline Type type() const noexcept { return enum_wrap_attr<Type>(node, "type", true); }
     [[nodiscard]] inline Optional<Integral> domain() const noexcept { return Integral{node->first_attribute("domain")}; }
     [[nodiscard]] inline Optional<Integral> bus() const noexcept { return Integral{node->first_attribute("bus")}; }
-    [[nodiscard]] inline Optional<String> function() const noexcept { return String{node->first_attribute("domain")}; }
+    [[nodiscard]] inline Optional<Integral> function() const noexcept { return Integral{node->first_attribute("function")}; }
     [[nodiscard]] inline std::optional<bool> multifunction() const noexcept {
         const auto mf_attr = node->first_attribute("multifunction");
         return mf_attr ? std::optional{static_cast<bool>(*magic_enum::enum_cast<OnOff>(mf_attr->value()))} : std::nullopt;
@@ -78,10 +83,249 @@ struct Address : public Node {
     [[nodiscard]] inline Optional<Integral> irq() const noexcept { return Integral{node->first_attribute("irq")}; }
     [[nodiscard]] inline Optional<Integral> slot() const noexcept { return Integral{node->first_attribute("slot")}; }
     [[nodiscard]] inline Optional<Integral> base() const noexcept { return Integral{node->first_attribute("base")}; }
+    [[nodiscard]] inline std::optional<PackedAddress> packed() const noexcept;
 };
 
+/// Value form of an <address/> element, decoded in a single pass over its attributes
+/// The key packs the fields identifying a slot for the address type: pci is domain:bus:slot.function in 32 bits,
+/// drive is controller type and index in 8 bits each, then bus:target:unit in 16 bits each, as controllers are numbered per type
+/// (an IDE and a SCSI disk both at 0:0:0:0 sit on distinct controllers)
+struct PackedAddress {
+    /// Controller a drive address refers to, given by the bus of the disk, or by its target name when it has no bus
+    enum class DriveController : std::uint8_t {
+        unknown,
+        ide,
+        scsi,
+        sata,
+        fdc,
+    };
+
+    Address::Type type{};
+    bool multifunction = false;
+    std::uint64_t key = 0;
+    /// False for a pci address lacking its bus or slot attribute, which libvirt assigns itself; its key then pins nothing
+    bool pinned = true;
+
+    struct Hash {
+        [[nodiscard]] inline std::size_t operator()(const PackedAddress& addr) const noexcept {
+            return std::hash<std::uint64_t>{}(addr.key * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint64_t>(addr.type));
+        }
+    };
+
+    [[nodiscard]] constexpr static PackedAddress pci(unsigned domain, unsigned bus, unsigned slot, unsigned function) noexcept {
+        return {Address::Type::pci, false, pack_pci_address(domain, bus, slot, function)};
+    }
+    [[nodiscard]] constexpr static PackedAddress drive(DriveController kind, unsigned controller, unsigned bus, unsigned target, unsigned unit) noexcept {
+        return {Address::Type::drive, false, pack_drive(kind, controller, bus, target, unit)};
+    }
+
+    [[nodiscard]] constexpr std::uint32_t pci_packed() const noexcept { return static_cast<std::uint32_t>(key); }
+    [[nodiscard]] constexpr unsigned pci_domain() const noexcept { return key >> 16u & 0xFFFFu; }
+    [[nodiscard]] constexpr unsigned pci_bus() const noexcept { return key >> 8u & 0xFFu; }
+    [[nodiscard]] constexpr unsigned pci_slot() const noexcept { return key >> 3u & 0x1Fu; }
+    [[nodiscard]] constexpr unsigned pci_function() const noexcept { return key & 0x7u; }
+    [[nodiscard]] constexpr DriveController drive_controller_type() const noexcept { return static_cast<DriveController>(key >> 56u); }
+    [[nodiscard]] constexpr unsigned drive_controller() const noexcept { return key >> 48u & 0xFFu; }
+    [[nodiscard]] constexpr unsigned drive_bus() const noexcept { return key >> 32u & 0xFFFFu; }
+    [[nodiscard]] constexpr unsigned drive_target() const noexcept { return key >> 16u & 0xFFFFu; }
+    [[nodiscard]] constexpr unsigned drive_unit() const noexcept { return key & 0xFFFFu; }
+
+    [[nodiscard]] constexpr bool operator==(const PackedAddress& oth) const noexcept { return type == oth.type && key == oth.key; }
+    [[nodiscard]] constexpr bool operator!=(const PackedAddress& oth) const noexcept { return !(*this == oth); }
+
+    /// Decodes any address-like element; the type defaults to pci for host addresses that carry no type attribute
+    [[nodiscard]] static std::optional<PackedAddress> decode(NodeRef node, Address::Type default_type = Address::Type::pci) noexcept {
+        if (node == nullptr)
+            return std::nullopt;
+
+        enum Field { domain, bus, slot, function, controller, target, unit, port, reg, cssid, ssid, devno, iobase, irq, fields_count };
+        std::uint64_t fields[fields_count]{};
+        std::uint32_t usb_port = 0;
+        unsigned given = 0; // bit `1 << field` set for the fields the element spells out
+        auto type = std::optional{default_type};
+        bool multifunction = false;
+
+        for (auto attr = node->first_attribute(); attr != nullptr; attr = attr->next_attribute()) {
+            const auto name = std::string_view{attr->name(), attr->name_size()};
+            const auto value = std::string_view{attr->value(), attr->value_size()};
+            switch (name.size()) {
+            case 3:
+                if (name == "bus") {
+                    fields[bus] = parse_uint(value);
+                    given |= 1u << bus;
+                } else if (name == "irq")
+                    fields[irq] = parse_uint(value);
+                else if (name == "reg")
+                    fields[reg] = parse_uint(value);
+                break;
+            case 4:
+                if (name == "type")
+                    type = decode_type(value);
+                else if (name == "slot") {
+                    fields[slot] = parse_uint(value);
+                    given |= 1u << slot;
+                } else if (name == "unit")
+                    fields[unit] = parse_uint(value);
+                else if (name == "port") {
+                    fields[port] = parse_uint(value);
+                    usb_port = parse_usb_port(value);
+                } else if (name == "ssid")
+                    fields[ssid] = parse_uint(value);
+                break;
+            case 5:
+                if (name == "cssid")
+                    fields[cssid] = parse_uint(value);
+                else if (name == "devno")
+                    fields[devno] = parse_uint(value);
+                break;
+            case 6:
+                if (name == "domain")
+                    fields[domain] = parse_uint(value);
+                else if (name == "target")
+                    fields[target] = parse_uint(value);
+                else if (name == "iobase")
+                    fields[iobase] = parse_uint(value);
+                break;
+            case 8:
+                if (name == "function")
+                    fields[function] = parse_uint(value);
+                break;
+            case 10:
+                if (name == "controller")
+                    fields[controller] = parse_uint(value);
+                break;
+            case 13:
+                if (name == "multifunction")
+                    multifunction = value == "on";
+                break;
+            default:
+                break;
+            }
+        }
+        if (!type)
+            return std::nullopt;
+
+        PackedAddress ret{*type, multifunction, 0};
+        switch (*type) {
+        case Address::Type::pci:
+            ret.key = pack_pci_address(fields[domain], fields[bus], fields[slot], fields[function]);
+            ret.pinned = (given & (1u << bus | 1u << slot)) == (1u << bus | 1u << slot);
+            break;
+        case Address::Type::drive:
+            ret.key = pack_drive(drive_controller_of(node->parent()), fields[controller], fields[bus], fields[target], fields[unit]);
+            break;
+        case Address::Type::virtio_serial:
+            ret.key = pack16(0, fields[controller], fields[bus], fields[port]);
+            break;
+        case Address::Type::ccid:
+            ret.key = pack16(0, 0, fields[controller], fields[slot]);
+            break;
+        case Address::Type::usb:
+            ret.key = (fields[bus] & 0xFFFFu) << 32u | usb_port;
+            break;
+        case Address::Type::spapr_vio:
+            ret.key = fields[reg];
+            break;
+        case Address::Type::ccw:
+            ret.key = (fields[cssid] & 0xFFu) << 24u | (fields[ssid] & 0xFFu) << 16u | (fields[devno] & 0xFFFFu);
+            break;
+        case Address::Type::isa:
+            ret.key = (fields[iobase] & 0xFFFFu) << 16u | (fields[irq] & 0xFFu);
+            break;
+        case Address::Type::dimm:
+            ret.key = fields[slot];
+            break;
+        case Address::Type::virtio_mmio:
+            break;
+        }
+        return ret;
+    }
+
+  private:
+    [[nodiscard]] constexpr static std::uint64_t pack16(std::uint64_t a, std::uint64_t b, std::uint64_t c, std::uint64_t d) noexcept {
+        return (a & 0xFFFFu) << 48u | (b & 0xFFFFu) << 32u | (c & 0xFFFFu) << 16u | (d & 0xFFFFu);
+    }
+
+    [[nodiscard]] constexpr static std::uint64_t pack_drive(DriveController kind, std::uint64_t controller, std::uint64_t bus, std::uint64_t target,
+                                                            std::uint64_t unit) noexcept {
+        return static_cast<std::uint64_t>(kind) << 56u | (controller & 0xFFu) << 48u | pack16(0, bus, target, unit);
+    }
+
+    /// `device` is the element holding the address: a <disk> names its bus in <target>, a SCSI <hostdev> sits on a SCSI controller
+    [[nodiscard]] static DriveController drive_controller_of(NodeRef device) noexcept {
+        if (device == nullptr)
+            return DriveController::unknown;
+        const auto device_name = std::string_view{device->name(), device->name_size()};
+        if (device_name == "hostdev")
+            return DriveController::scsi;
+        const auto target = device_name == "disk" ? device->first_node("target") : nullptr;
+        if (target == nullptr)
+            return DriveController::unknown;
+        if (const auto bus = target->first_attribute("bus"))
+            return magic_enum::enum_cast<DriveController>(std::string_view{bus->value(), bus->value_size()}).value_or(DriveController::unknown);
+        // Without a bus, libvirt goes by the prefix of the target name
+        const auto dev = target->first_attribute("dev");
+        const auto prefix = dev != nullptr ? std::string_view{dev->value(), dev->value_size()}.substr(0, 2) : std::string_view{};
+        if (prefix == "hd")
+            return DriveController::ide;
+        if (prefix == "sd")
+            return DriveController::scsi;
+        if (prefix == "fd")
+            return DriveController::fdc;
+        return DriveController::unknown;
+    }
+
+    [[nodiscard]] constexpr static std::uint64_t parse_uint(std::string_view sv) noexcept {
+        std::uint64_t ret = 0;
+        if (sv.size() > 2 && sv[0] == '0' && (sv[1] == 'x' || sv[1] == 'X')) {
+            for (const char c : sv.substr(2)) {
+                if (c >= '0' && c <= '9')
+                    ret = ret << 4u | static_cast<unsigned>(c - '0');
+                else if (c >= 'a' && c <= 'f')
+                    ret = ret << 4u | static_cast<unsigned>(c - 'a' + 10);
+                else if (c >= 'A' && c <= 'F')
+                    ret = ret << 4u | static_cast<unsigned>(c - 'A' + 10);
+                else
+                    break;
+            }
+            return ret;
+        }
+        for (const char c : sv) {
+            if (c < '0' || c > '9')
+                break;
+            ret = ret * 10u + static_cast<unsigned>(c - '0');
+        }
+        return ret;
+    }
+
+    // USB ports are hub paths ("1", "1.2.3"); each level is packed in a byte, up to four levels
+    [[nodiscard]] constexpr static std::uint32_t parse_usb_port(std::string_view sv) noexcept {
+        std::uint32_t ret = 0;
+        for (auto level = 0u; level < 4u && !sv.empty(); ++level) {
+            const auto dot = sv.find('.');
+            ret |= static_cast<std::uint32_t>(parse_uint(sv.substr(0, dot)) & 0xFFu) << (24u - level * 8u);
+            sv = dot == std::string_view::npos ? std::string_view{} : sv.substr(dot + 1);
+        }
+        return ret;
+    }
+
+    [[nodiscard]] static std::optional<Address::Type> decode_type(std::string_view sv) noexcept {
+        char buf[16]{};
+        if (sv.size() >= sizeof(buf))
+            return std::nullopt;
+        std::replace_copy(sv.begin(), sv.end(), buf, '-', '_');
+        return magic_enum::enum_cast<Address::Type>(std::string_view{buf, sv.size()});
+    }
+};
+
+inline std::optional<PackedAddress> Address::packed() const noexcept { return PackedAddress::decode(node); }
+
 struct Domain : private Node {
   public:
+    constexpr explicit Domain(NodeRef node) : Node(node) {}
+    using Node::operator bool;
+    friend NodeAccess;
+
     enum class Type {
         qemu,
         kqemu,
@@ -229,7 +473,7 @@ struct Domain : private Node {
         };
         struct HvmBootMenu : public Node {
             [[nodiscard]] inline bool enable() const noexcept {
-                return static_cast<bool>(*magic_enum::enum_cast<YesNo>(node->first_attribute("enable")));
+                return bool_wrap_attr<YesNo>(node, "enable");
             }
 
             [[nodiscard]] inline Optional<Integral> timeout() const noexcept { return Integral{node->first_attribute("timeout")}; }
@@ -435,6 +679,11 @@ struct Domain : private Node {
         };
 
         struct Emulator : public StringNode {};
+        struct Any : public Node {
+            [[nodiscard]] inline std::string_view kind() const noexcept { return {node->name(), node->name_size()}; }
+            [[nodiscard]] inline Optional<Alias> alias() const noexcept { return Alias{node->first_node("alias")}; }
+            [[nodiscard]] inline Optional<Address> address() const noexcept { return Address{node->first_node("address")}; }
+        };
         struct SecLabel : public Node {
             [[nodiscard]] inline Optional<String> model() const noexcept { return String{node->first_attribute("model")}; }
             [[nodiscard]] inline std::optional<bool> relabel() const noexcept {
@@ -551,11 +800,16 @@ struct Domain : private Node {
                         return type_attr ? magic_enum::enum_cast<storage::Format>(type_attr->value()) : std::nullopt;
                     }
                 };
+                [[nodiscard]] inline std::optional<Type> type() const noexcept { return enum_wrap_attr<Type, Optional>(node, "type"); }
                 [[nodiscard]] inline Optional<Integral> index() const noexcept { return Integral{node->first_attribute("index")}; }
                 [[nodiscard]] inline Optional<Source> source() const noexcept { return Source{node->first_node("source")}; }
                 [[nodiscard]] inline Optional<BackingStore> next() const noexcept { return BackingStore{node->first_node("backingStore")}; }
                 [[nodiscard]] inline Optional<Format> format() const noexcept { return Format{node->first_node("format")}; }
             };
+            struct Driver : public Node {
+                [[nodiscard]] inline Optional<String> name() const noexcept { return String{node->first_attribute("name")}; }
+                [[nodiscard]] inline std::optional<storage::Format> type() const noexcept { return enum_wrap_attr<storage::Format, Optional>(node, "type"); }
+            };
 
             [[nodiscard]] inline std::optional<Device> device() const noexcept {
                 const auto dev_attr = node->first_attribute("device");
@@ -567,6 +821,7 @@ struct Domain : private Node {
             }
             [[nodiscard]] inline Optional<Source> source() const noexcept { return Source{node->first_node("source")}; }
             [[nodiscard]] inline Optional<BackingStore> backing_store() const noexcept { return BackingStore{node->first_node("backingStore")}; }
+            [[nodiscard]] inline Optional<Driver> driver() const noexcept { return Driver{node->first_node("driver")}; }
             [[nodiscard]] inline std::optional<bool> raw_io() const noexcept {
                 const auto rio_attr = node->first_attribute("raw_io");
                 return rio_attr ? std::optional{static_cast<bool>(*magic_enum::enum_cast<YesNo>(rio_attr->value()))} : std::nullopt;
@@ -576,6 +831,8 @@ struct Domain : private Node {
                 return sgio_attr ? magic_enum::enum_cast<SgIO>(sgio_attr->value()) : std::nullopt;
             }
             [[nodiscard]] inline Optional<Snapshot> snapshot() const noexcept { return Snapshot{node->first_node("snapshot")}; }
+            [[nodiscard]] inline bool readonly() const noexcept { return node->first_node("readonly") != nullptr; }
+            [[nodiscard]] inline bool shareable() const noexcept { return node->first_node("shareable") != nullptr; }
         };
         struct Ip : public Node {
             [[nodiscard]] inline String address() const noexcept { return String{node->first_attribute("address")}; }
@@ -843,11 +1100,13 @@ struct Domain : private Node {
                     [[nodiscard]] inline Optional<Integral> usb_device() const noexcept { return Integral{node->first_attribute("device")}; }
                     [[nodiscard]] inline Optional<Integral> pci_domain() const noexcept { return Integral{node->first_attribute("domain")}; }
                     [[nodiscard]] inline Optional<Integral> pci_bus() const noexcept { return Integral{node->first_attribute("bus")}; }
-                    [[nodiscard]] inline Optional<String> pci_function() const noexcept { return String{node->first_attribute("domain")}; }
+                    [[nodiscard]] inline Optional<Integral> pci_slot() const noexcept { return Integral{node->first_attribute("slot")}; }
+                    [[nodiscard]] inline Optional<Integral> pci_function() const noexcept { return Integral{node->first_attribute("function")}; }
                     [[nodiscard]] inline std::optional<bool> pci_multifunction() const noexcept {
                         const auto mf_attr = node->first_attribute("multifunction");
                         return mf_attr ? std::optional{static_cast<bool>(*magic_enum::enum_cast<OnOff>(mf_attr->value()))} : std::nullopt;
                     }
+                    [[nodiscard]] inline std::optional<PackedAddress> packed() const noexcept { return PackedAddress::decode(node); }
                 };
 
                 [[nodiscard]] inline Optional<String> bridge() const noexcept { return String{node->first_attribute("bridge")}; }
@@ -909,7 +1168,7 @@ struct Domain : private Node {
                 [[nodiscard]] inline Optional<String> actual() const noexcept { return String{node->first_attribute("actual")}; }
             };
             struct Mac : public Node {
-                [[nodiscard]] inline String address() const noexcept { return String{node->first_attribute("address")}; }
+                [[nodiscard]] inline MacAddress address() const noexcept { return MacAddress{node->first_attribute("address")}; }
             };
             struct Script : public Node {
                 [[nodiscard]] inline String path() const noexcept { return String{node->first_attribute("path")}; }
@@ -1143,11 +1402,13 @@ struct Domain : private Node {
                 struct PciAddress : public Node {
                     [[nodiscard]] inline Optional<Integral> domain() const noexcept { return Integral{node->first_attribute("domain")}; }
                     [[nodiscard]] inline Optional<Integral> bus() const noexcept { return Integral{node->first_attribute("bus")}; }
-                    [[nodiscard]] inline Optional<String> function() const noexcept { return String{node->first_attribute("domain")}; }
+                    [[nodiscard]] inline Optional<Integral> slot() const noexcept { return Integral{node->first_attribute("slot")}; }
+                    [[nodiscard]] inline Optional<Integral> function() const noexcept { return Integral{node->first_attribute("function")}; }
                     [[nodiscard]] inline std::optional<bool> multifunction() const noexcept {
                         const auto mf_attr = node->first_attribute("multifunction");
                         return mf_attr ? std::optional{static_cast<bool>(*magic_enum::enum_cast<OnOff>(mf_attr->value()))} : std::nullopt;
                     }
+                    [[nodiscard]] inline std::optional<PackedAddress> packed() const noexcept { return PackedAddress::decode(node); }
                 };
                 struct Vendor : public Node {
                     [[nodiscard]] inline Integral id() const noexcept { return Integral{node->first_attribute("id")}; }
@@ -1305,7 +1566,7 @@ struct Domain : private Node {
                 };
 
                 [[nodiscard]] inline Compression compression() const noexcept {
-                    return *magic_enum::enum_cast<Compression>(node->first_attribute("compression")->value());
+                    return *enum_cast_xml<Compression>(node->first_attribute("compression")->value());
                 }
             };
             struct Playback : public Node {
@@ -1337,7 +1598,7 @@ struct Domain : private Node {
             };
             struct EnableC : public Node {
                 [[nodiscard]] inline bool enable() const noexcept {
-                    return static_cast<bool>(*magic_enum::enum_cast<YesNo>(node->first_attribute("copypaste")->value()));
+                    return static_cast<bool>(*magic_enum::enum_cast<YesNo>(node->first_attribute("enable")->value()));
                 }
             };
             struct Gl : public EnableC {
@@ -1535,7 +1796,7 @@ struct Domain : private Node {
                 [[nodiscard]] inline Optional<Model> model() const noexcept { return Model{node->first_node("model")}; }
             };
             [[nodiscard]] inline QemuCharDevType type() const noexcept {
-                return *magic_enum::enum_cast<QemuCharDevType>(node->first_attribute("type")->value());
+                return *enum_cast_xml<QemuCharDevType>(node->first_attribute("type")->value());
             }
             [[nodiscard]] inline Optional<String> tty() const noexcept { return String{node->first_attribute("tty")}; }
             [[nodiscard]] inline NamedSpan<Source> sources() const noexcept { return NamedSpan<Source>{"source", node}; }
@@ -1568,7 +1829,7 @@ struct Domain : private Node {
             };
 
             [[nodiscard]] inline QemuCharDevType type() const noexcept {
-                return *magic_enum::enum_cast<QemuCharDevType>(node->first_attribute("type")->value());
+                return *enum_cast_xml<QemuCharDevType>(node->first_attribute("type")->value());
             }
             [[nodiscard]] inline NamedSpan<QemuCharDev::Source> sources() const noexcept { return NamedSpan<QemuCharDev::Source>{"source", node}; }
             [[nodiscard]] inline Optional<Alias> alias() const noexcept { return Alias{node->first_node("alias")}; }
@@ -1655,14 +1916,19 @@ struct Domain : private Node {
             [[nodiscard]] inline Optional<Address> address() const noexcept { return Address{node->first_node("address")}; }
         };
         struct Tpm : public Node {
-            enum class Model { tpm_tis };
+            enum class Model {
+                tpm_tis,
+                tpm_crb,
+                tpm_spapr,
+            };
 
             struct Backend : public Node {
                 enum class Type {
                     passthrough,
+                    emulator,
                 };
 
-                [[nodiscard]] inline Type type() const noexcept { return enum_wrap_attr<Type>(node, "model"); }
+                [[nodiscard]] inline Type type() const noexcept { return enum_wrap_attr<Type>(node, "type"); }
                 [[nodiscard]] inline Optional<String> path() const noexcept { return String{node->first_attribute("path")}; }
             };
 
@@ -1805,6 +2071,7 @@ struct Domain : private Node {
         };
 
         [[nodiscard]] inline Optional<Emulator> emulator() const noexcept { return Emulator{node->first_node("emulator")}; }
+        [[nodiscard]] inline ChildSpan<Any> all() const noexcept { return ChildSpan<Any>{node}; }
         [[nodiscard]] inline NamedSpan<Disk> disks() const noexcept { return NamedSpan<Disk>{"disk", node}; }
         [[nodiscard]] inline NamedSpan<Controller> controllers() const noexcept { return NamedSpan<Controller>{"controller", node}; }
         [[nodiscard]] inline NamedSpan<Lease> leases() const noexcept { return NamedSpan<Lease>{"lease", node}; }
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <gsl/gsl>
+#include <magic_enum.hpp>
+#include <rapidxml_ns.hpp>
+#include "cpu_types.hpp"
+#include "domain.hpp"
+#include "generic.hpp"
+#include "xmlval.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// A set of enumerators of E, one bit each, so that set operations are single instructions
+template <class E> class EnumSet {
+    static_assert(magic_enum::enum_count<E>() <= 64, "EnumSet holds at most 64 enumerators");
+    std::uint64_t bits = 0;
+
+  public:
+    constexpr EnumSet() noexcept = default;
+    constexpr explicit EnumSet(std::uint64_t bits) noexcept : bits(bits) {}
+
+    /// Bit of `value`, by its position among the enumerators
+    [[nodiscard]] static constexpr std::uint64_t bit(E value) noexcept {
+        constexpr auto values = magic_enum::enum_values<E>();
+        for (std::size_t i = 0; i < values.size(); ++i)
+            if (values[i] == value)
+                return std::uint64_t{1} << i;
+        return 0;
+    }
+
+    constexpr EnumSet& insert(E value) noexcept {
+        bits |= bit(value);
+        return *this;
+    }
+    [[nodiscard]] constexpr bool contains(E value) const noexcept { return (bits & bit(value)) != 0; }
+    /// Whether every enumerator of `other` is in the set
+    [[nodiscard]] constexpr bool contains(EnumSet other) const noexcept { return (other.bits & ~bits) == 0; }
+    [[nodiscard]] constexpr bool empty() const noexcept { return bits == 0; }
+    [[nodiscard]] constexpr std::uint64_t raw() const noexcept { return bits; }
+
+    [[nodiscard]] constexpr friend EnumSet operator|(EnumSet lhs, EnumSet rhs) noexcept { return EnumSet{lhs.bits | rhs.bits}; }
+    [[nodiscard]] constexpr friend EnumSet operator&(EnumSet lhs, EnumSet rhs) noexcept { return EnumSet{lhs.bits & rhs.bits}; }
+    /// Enumerators of `lhs` not in `rhs`
+    [[nodiscard]] constexpr friend EnumSet operator-(EnumSet lhs, EnumSet rhs) noexcept { return EnumSet{lhs.bits & ~rhs.bits}; }
+    [[nodiscard]] constexpr friend bool operator==(EnumSet lhs, EnumSet rhs) noexcept { return lhs.bits == rhs.bits; }
+    [[nodiscard]] constexpr friend bool operator!=(EnumSet lhs, EnumSet rhs) noexcept { return lhs.bits != rhs.bits; }
+};
+
+/// The enumerated parts of a domain definition, either those a DomainCapabilities document offers or those a Domain uses
+struct CapabilitySet {
+    using Devices = Domain::Devices;
+
+    EnumSet<Domain::Os::HvmLoader::Type> loader_types;
+    EnumSet<cpu::Mode> cpu_modes;
+    EnumSet<Devices::Disk::Device> disk_devices;
+    EnumSet<Devices::Graphics::Type> graphics_types;
+    EnumSet<Devices::Video::Model::Type> video_models;
+    EnumSet<Devices::HostDev::Mode> hostdev_modes;
+    EnumSet<Devices::HostDev::Type> hostdev_types; // subsystem and capabilities types alike
+    EnumSet<Devices::Rng::Model> rng_models;
+    EnumSet<Devices::Rng::Backend::Model> rng_backends;
+    EnumSet<Devices::Tpm::Model> tpm_models;
+    EnumSet<Devices::Tpm::Backend::Type> tpm_backends;
+    bool unknown = false; // a definition used a value, or lacked a required one, that no capabilities can offer
+
+    /// What `needed` uses that this set lacks; empty if it covers all of it
+    [[nodiscard]] constexpr CapabilitySet missing(const CapabilitySet& needed) const noexcept {
+        return CapabilitySet{needed.loader_types - loader_types,     needed.cpu_modes - cpu_modes,       needed.disk_devices - disk_devices,
+                             needed.graphics_types - graphics_types, needed.video_models - video_models, needed.hostdev_modes - hostdev_modes,
+                             needed.hostdev_types - hostdev_types,   needed.rng_models - rng_models,     needed.rng_backends - rng_backends,
+                             needed.tpm_models - tpm_models,         needed.tpm_backends - tpm_backends, needed.unknown};
+    }
+    [[nodiscard]] constexpr bool empty() const noexcept {
+        return (loader_types.raw() | cpu_modes.raw() | disk_devices.raw() | graphics_types.raw() | video_models.raw() | hostdev_modes.raw() |
+                hostdev_types.raw() | rng_models.raw() | rng_backends.raw() | tpm_models.raw() | tpm_backends.raw()) == 0 &&
+               !unknown;
+    }
+    [[nodiscard]] constexpr bool covers(const CapabilitySet& needed) const noexcept { return missing(needed).empty(); }
+};
+
+namespace impl {
+/// Adds the enumerator spelled by the attribute `name` of `node` to `set`, or `fallback` when the attribute is absent
+/// An unknown spelling, or a missing attribute without a fallback, sets `unknown` rather than standing for some default
+template <class E>
+void require(EnumSet<E>& set, bool& unknown, NodeRef node, gsl::czstring<> name, std::optional<E> fallback = std::nullopt,
+             bool underscores = false) noexcept {
+    const auto attr = node != nullptr ? node->first_attribute(name) : nullptr;
+    const auto value = attr != nullptr ? enum_cast_xml<E>({attr->value(), attr->value_size()}, underscores) : fallback;
+    if (value)
+        set.insert(*value);
+    else
+        unknown = true;
+}
+} // namespace impl
+
+/// What a domain definition uses, to check against DomainCapabilities::offered()
+/// Every value is read with the optional-returning casts, so that one this library does not know makes the result unsatisfiable
+[[nodiscard]] inline CapabilitySet requirements(Domain dom) noexcept {
+    using Devices = Domain::Devices;
+    using impl::require;
+    CapabilitySet ret;
+    if (const auto os = dom.os())
+        if (const auto loader = os.hvm_loader(); loader && NodeAccess::of(loader)->first_attribute("type") != nullptr)
+            require(ret.loader_types, ret.unknown, NodeAccess::of(loader), "type");
+    // The mode is optional, and its values are dashed
+    if (const auto cpu = dom.cpu(); cpu && NodeAccess::of(cpu)->first_attribute("mode") != nullptr)
+        require(ret.cpu_modes, ret.unknown, NodeAccess::of(cpu), "mode", {}, true);
+    const auto devices = dom.devices();
+    if (!devices)
+        return ret;
+    for (const auto disk : devices.disks())
+        require(ret.disk_devices, ret.unknown, NodeAccess::of(disk), "device", std::optional{Devices::Disk::Device::disk});
+    for (const auto graphics : devices.graphics())
+        require(ret.graphics_types, ret.unknown, NodeAccess::of(graphics), "type");
+    for (const auto video : devices.videos())
+        if (const auto model = video.model())
+            require(ret.video_models, ret.unknown, NodeAccess::of(model), "type");
+    for (const auto hostdev : devices.hostdevs()) {
+        require(ret.hostdev_modes, ret.unknown, NodeAccess::of(hostdev), "mode", std::optional{Devices::HostDev::Mode::subsystem});
+        require(ret.hostdev_types, ret.unknown, NodeAccess::of(hostdev), "type", {}, true);
+    }
+    for (const auto rng : devices.rngs()) {
+        require(ret.rng_models, ret.unknown, NodeAccess::of(rng), "model");
+        require(ret.rng_backends, ret.unknown, NodeAccess::of(rng)->first_node("backend"), "model");
+    }
+    for (const auto tpm : devices.tpms()) {
+        require(ret.tpm_models, ret.unknown, NodeAccess::of(tpm), "model", std::optional{Devices::Tpm::Model::tpm_tis}, true);
+        require(ret.tpm_backends, ret.unknown, NodeAccess::of(tpm)->first_node("backend"), "type");
+    }
+    return ret;
+}
+
+/// What one (emulator, arch, machine, domain type) supports, as returned by virConnectGetDomainCapabilities
+class DomainCapabilities {
+  public:
+    /// An element with a `supported` attribute and <enum name=...><value/>...</enum> children
+    struct Supportable : public Node {
+        [[nodiscard]] inline bool supported() const noexcept {
+            const auto attr = node != nullptr ? node->first_attribute("supported") : nullptr;
+            return attr != nullptr && std::string_view{attr->value(), attr->value_size()} == "yes";
+        }
+        /// The values of the enum `name` that E knows, or none if the element is unsupported
+        template <class E> [[nodiscard]] EnumSet<E> values(gsl::czstring<> name, bool underscores = false) const {
+            EnumSet<E> ret;
+            if (!supported())
+                return ret;
+            for (auto it = node->first_node("enum"); it != nullptr; it = it->next_sibling("enum")) {
+                const auto attr = it->first_attribute("name");
+                if (attr == nullptr || std::string_view{attr->value(), attr->value_size()} != name)
+                    continue;
+                for (auto value = it->first_node("value"); value != nullptr; value = value->next_sibling("value"))
+                    if (const auto e = enum_cast_xml<E>({value->value(), value->value_size()}, underscores))
+                        ret.insert(*e);
+            }
+            return ret;
+        }
+    };
+
+    struct Cpu : public Node {
+        /// The modes listed as supported
+        [[nodiscard]] inline EnumSet<cpu::Mode> modes() const {
+            EnumSet<cpu::Mode> ret;
+            for (auto it = node != nullptr ? node->first_node("mode") : nullptr; it != nullptr; it = it->next_sibling("mode")) {
+                const auto name = it->first_attribute("name");
+                if (name == nullptr || !Supportable{it}.supported())
+                    continue;
+                if (const auto mode = enum_cast_xml<cpu::Mode>({name->value(), name->value_size()}, true))
+                    ret.insert(*mode);
+            }
+            return ret;
+        }
+    };
+
+    explicit DomainCapabilities(gsl::zstring<> xml) {
+        doc.parse<0>(xml);
+        root = doc.first_node("domainCapabilities");
+    }
+    /// Binds to a <domainCapabilities> element owned by someone else
+    explicit DomainCapabilities(NodeRef domain_capabilities) : root(domain_capabilities) {}
+    DomainCapabilities(const DomainCapabilities&) = delete;
+    DomainCapabilities& operator=(const DomainCapabilities&) = delete;
+
+    friend NodeAccess;
+
+    [[nodiscard]] inline Optional<String> path() const noexcept { return String{root->first_node("path")}; }
+    [[nodiscard]] inline std::optional<Domain::Type> domain() const noexcept { return text_enum<Domain::Type>("domain"); }
+    [[nodiscard]] inline Optional<String> machine() const noexcept { return String{root->first_node("machine")}; }
+    [[nodiscard]] inline std::optional<cpu::Arch> arch() const noexcept { return text_enum<cpu::Arch>("arch"); }
+    [[nodiscard]] inline Optional<Integral> max_vcpus() const noexcept {
+        const auto vcpu = root->first_node("vcpu");
+        return Integral{vcpu != nullptr ? vcpu->first_attribute("max") : nullptr};
+    }
+    [[nodiscard]] inline Supportable iothreads() const noexcept { return Supportable{root->first_node("iothreads")}; }
+    [[nodiscard]] inline Supportable os() const noexcept { return Supportable{root->first_node("os")}; }
+    [[nodiscard]] inline Supportable loader() const noexcept { return Supportable{child("os", "loader")}; }
+    [[nodiscard]] inline Cpu cpu() const noexcept { return Cpu{root->first_node("cpu")}; }
+    /// A device element under <devices>, e.g. "disk", "graphics" or "hostdev"
+    [[nodiscard]] inline Supportable device(gsl::czstring<> name) const noexcept { return Supportable{child("devices", name)}; }
+    /// A feature under <features>, e.g. "gic", "vmcoreinfo", "genid" or "sev"
+    [[nodiscard]] inline Supportable feature(gsl::czstring<> name) const noexcept { return Supportable{child("features", name)}; }
+
+    /// Summarizes the enums of the document as bitmasks; build once, then check many definitions against it
+    [[nodiscard]] CapabilitySet offered() const {
+        using Devices = Domain::Devices;
+        CapabilitySet ret;
+        ret.loader_types = os().supported() ? loader().values<Domain::Os::HvmLoader::Type>("type") : ret.loader_types;
+        ret.cpu_modes = cpu().modes();
+        ret.disk_devices = device("disk").values<Devices::Disk::Device>("diskDevice");
+        ret.graphics_types = device("graphics").values<Devices::Graphics::Type>("type");
+        ret.video_models = device("video").values<Devices::Video::Model::Type>("modelType");
+        const auto hostdev = device("hostdev");
+        ret.hostdev_modes = hostdev.values<Devices::HostDev::Mode>("mode");
+        ret.hostdev_types = hostdev.values<Devices::HostDev::Type>("subsysType", true) | hostdev.values<Devices::HostDev::Type>("capsType", true);
+        const auto rng = device("rng");
+        ret.rng_models = rng.values<Devices::Rng::Model>("model");
+        ret.rng_backends = rng.values<Devices::Rng::Backend::Model>("backendModel");
+        const auto tpm = device("tpm");
+        ret.tpm_models = tpm.values<Devices::Tpm::Model>("model", true);
+        ret.tpm_backends = tpm.values<Devices::Tpm::Backend::Type>("backendModel");
+        return ret;
+    }
+
+  private:
+    template <class E> [[nodiscard]] std::optional<E> text_enum(gsl::czstring<> name) const noexcept {
+        const auto element = root->first_node(name);
+        return element != nullptr ? magic_enum::enum_cast<E>(std::string_view{element->value(), element->value_size()}) : std::nullopt;
+    }
+    [[nodiscard]] inline NodeRef child(gsl::czstring<> parent, gsl::czstring<> name) const noexcept {
+        const auto element = root->first_node(parent);
+        return element != nullptr ? element->first_node(name) : nullptr;
+    }
+
+    xml_document<> doc{};
+    NodeRef root;
+};
+
+} // namespace
+} // namespace virtxml
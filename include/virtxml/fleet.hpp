@@ -0,0 +1,367 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "domain.hpp"
+#include "generic.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Fields of many domains laid out as columns, for scans and aggregations over a whole fleet
+/// Strings are dictionary-encoded; the scan primitives are plain loops over contiguous arrays, which compilers vectorize
+namespace fleet {
+using Row = std::uint32_t;
+using Code = std::uint32_t;
+/// One byte per row, 1 if the row is selected
+using Mask = std::vector<std::uint8_t>;
+
+constexpr Code null_code = ~Code{0}; // the field was absent
+
+struct IntegerColumn {
+    std::string name;
+    std::vector<std::int64_t> values;
+};
+
+struct StringColumn {
+    std::string name;
+    std::vector<Code> codes;
+    std::vector<std::string> dictionary; // sorted, so codes compare like the strings they stand for
+
+    /// Code of `value`, or null_code if no row has it
+    [[nodiscard]] inline Code code_of(std::string_view value) const noexcept {
+        const auto it = std::lower_bound(dictionary.begin(), dictionary.end(), value);
+        return it != dictionary.end() && *it == value ? static_cast<Code>(it - dictionary.begin()) : null_code;
+    }
+    /// Value at `row`, empty if absent
+    [[nodiscard]] inline std::string_view operator[](Row row) const noexcept {
+        return codes[row] != null_code ? std::string_view{dictionary[codes[row]]} : std::string_view{};
+    }
+};
+
+struct Snapshot {
+    std::size_t rows = 0;
+    std::vector<IntegerColumn> integers;
+    std::vector<StringColumn> strings;
+
+    [[nodiscard]] inline const IntegerColumn* integer(std::string_view name) const noexcept {
+        const auto it = std::find_if(integers.begin(), integers.end(), [=](const auto& col) { return col.name == name; });
+        return it != integers.end() ? &*it : nullptr;
+    }
+    [[nodiscard]] inline const StringColumn* string(std::string_view name) const noexcept {
+        const auto it = std::find_if(strings.begin(), strings.end(), [=](const auto& col) { return col.name == name; });
+        return it != strings.end() ? &*it : nullptr;
+    }
+};
+
+/// Extracts the chosen fields of a range of domains into a Snapshot, splitting the rows among threads
+/// Fields are callables taking either `(Domain)` or `(std::size_t row, Domain)`, the latter to join data kept outside the XML such as the host
+/// String fields return `std::optional<std::string_view>`, which only needs to stay valid until build() returns
+class Builder {
+  public:
+    using IntegerField = std::function<std::int64_t(std::size_t, Domain)>;
+    using StringField = std::function<std::optional<std::string_view>(std::size_t, Domain)>;
+
+  private:
+    std::vector<std::pair<std::string, IntegerField>> integer_fields;
+    std::vector<std::pair<std::string, StringField>> string_fields;
+
+    template <class R, class F> static std::function<R(std::size_t, Domain)> adapt(F&& field) {
+        if constexpr (std::is_invocable_v<F, std::size_t, Domain>)
+            return std::forward<F>(field);
+        else
+            return [field = std::forward<F>(field)](std::size_t, Domain dom) -> R { return field(dom); };
+    }
+
+  public:
+    template <class F> Builder& integer(std::string name, F&& field) {
+        integer_fields.emplace_back(std::move(name), adapt<std::int64_t>(std::forward<F>(field)));
+        return *this;
+    }
+    template <class F> Builder& string(std::string name, F&& field) {
+        string_fields.emplace_back(std::move(name), adapt<std::optional<std::string_view>>(std::forward<F>(field)));
+        return *this;
+    }
+
+    /// `domains` is a random access range of Domain
+    template <class Range> [[nodiscard]] Snapshot build(const Range& domains, unsigned threads = std::thread::hardware_concurrency()) const {
+        const auto count = static_cast<std::size_t>(std::size(domains));
+        threads = static_cast<unsigned>(std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(1, count)));
+
+        Snapshot ret;
+        ret.rows = count;
+        for (const auto& [name, field] : integer_fields)
+            ret.integers.push_back(IntegerColumn{name, std::vector<std::int64_t>(count)});
+        for (const auto& [name, field] : string_fields)
+            ret.strings.push_back(StringColumn{name, std::vector<Code>(count), {}});
+
+        auto run = [threads](auto&& fn) {
+            std::vector<std::thread> workers;
+            workers.reserve(threads - 1);
+            for (unsigned t = 1; t < threads; ++t)
+                workers.emplace_back(fn, t);
+            fn(0u);
+            for (auto& worker : workers)
+                worker.join();
+        };
+        const auto first_row = [&](unsigned t) { return count * t / threads; };
+
+        // Each thread encodes its rows against its own dictionaries; these are merged once all rows are read
+        std::vector<std::vector<std::vector<std::string_view>>> local(threads, std::vector<std::vector<std::string_view>>(string_fields.size()));
+        run([&](unsigned t) {
+            std::vector<std::unordered_map<std::string_view, Code>> codes(string_fields.size());
+            for (auto i = first_row(t); i < first_row(t + 1); ++i) {
+                const Domain dom = domains[i];
+                for (std::size_t c = 0; c < integer_fields.size(); ++c)
+                    ret.integers[c].values[i] = integer_fields[c].second(i, dom);
+                for (std::size_t c = 0; c < string_fields.size(); ++c) {
+                    const auto value = string_fields[c].second(i, dom);
+                    if (!value) {
+                        ret.strings[c].codes[i] = null_code;
+                        continue;
+                    }
+                    const auto [it, added] = codes[c].try_emplace(*value, static_cast<Code>(local[t][c].size()));
+                    if (added)
+                        local[t][c].push_back(*value);
+                    ret.strings[c].codes[i] = it->second;
+                }
+            }
+        });
+
+        std::vector<std::vector<std::vector<Code>>> remap(threads, std::vector<std::vector<Code>>(string_fields.size()));
+        for (std::size_t c = 0; c < string_fields.size(); ++c) {
+            std::vector<std::string_view> merged;
+            for (unsigned t = 0; t < threads; ++t)
+                merged.insert(merged.end(), local[t][c].begin(), local[t][c].end());
+            std::sort(merged.begin(), merged.end());
+            merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+            auto& dictionary = ret.strings[c].dictionary;
+            dictionary.assign(merged.begin(), merged.end());
+            for (unsigned t = 0; t < threads; ++t) {
+                remap[t][c].reserve(local[t][c].size());
+                for (const auto value : local[t][c])
+                    remap[t][c].push_back(static_cast<Code>(std::lower_bound(merged.begin(), merged.end(), value) - merged.begin()));
+            }
+        }
+        run([&](unsigned t) {
+            for (std::size_t c = 0; c < string_fields.size(); ++c) {
+                auto& codes = ret.strings[c].codes;
+                const auto& table = remap[t][c];
+                for (auto i = first_row(t); i < first_row(t + 1); ++i)
+                    codes[i] = codes[i] != null_code ? table[codes[i]] : null_code;
+            }
+        });
+        return ret;
+    }
+};
+
+enum class Compare { eq, ne, lt, le, gt, ge };
+
+/// Rows whose value compares to `value` as `op` says
+[[nodiscard]] inline Mask where(const IntegerColumn& col, Compare op, std::int64_t value) {
+    const auto n = col.values.size();
+    const auto in = col.values.data();
+    Mask ret(n);
+    const auto out = ret.data();
+    // One loop per operator keeps the comparison out of the loop body
+    switch (op) {
+    case Compare::eq:
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = in[i] == value;
+        break;
+    case Compare::ne:
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = in[i] != value;
+        break;
+    case Compare::lt:
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = in[i] < value;
+        break;
+    case Compare::le:
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = in[i] <= value;
+        break;
+    case Compare::gt:
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = in[i] > value;
+        break;
+    case Compare::ge:
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = in[i] >= value;
+        break;
+    }
+    return ret;
+}
+/// Rows whose string equals `value`; the dictionary is searched once, then only codes are compared
+[[nodiscard]] inline Mask where(const StringColumn& col, std::string_view value) {
+    const auto code = col.code_of(value);
+    const auto n = col.codes.size();
+    const auto in = col.codes.data();
+    Mask ret(n);
+    const auto out = ret.data();
+    if (code != null_code)
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = in[i] == code;
+    return ret;
+}
+/// Rows where the string field was present
+[[nodiscard]] inline Mask present(const StringColumn& col) {
+    const auto n = col.codes.size();
+    const auto in = col.codes.data();
+    Mask ret(n);
+    const auto out = ret.data();
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = in[i] != null_code;
+    return ret;
+}
+
+/// Keeps in `lhs` the rows also selected by `rhs`
+inline Mask& intersect(Mask& lhs, const Mask& rhs) noexcept {
+    for (std::size_t i = 0; i < lhs.size(); ++i)
+        lhs[i] &= rhs[i];
+    return lhs;
+}
+/// Adds to `lhs` the rows selected by `rhs`
+inline Mask& unite(Mask& lhs, const Mask& rhs) noexcept {
+    for (std::size_t i = 0; i < lhs.size(); ++i)
+        lhs[i] |= rhs[i];
+    return lhs;
+}
+inline Mask& invert(Mask& mask) noexcept {
+    for (auto& selected : mask)
+        selected ^= 1u;
+    return mask;
+}
+
+[[nodiscard]] inline std::size_t count(const Mask& mask) noexcept {
+    std::size_t ret = 0;
+    for (const auto selected : mask)
+        ret += selected;
+    return ret;
+}
+/// Indices of the selected rows, in order
+[[nodiscard]] inline std::vector<Row> rows(const Mask& mask) {
+    std::vector<Row> ret;
+    ret.reserve(count(mask));
+    for (std::size_t i = 0; i < mask.size(); ++i)
+        if (mask[i] != 0)
+            ret.push_back(static_cast<Row>(i));
+    return ret;
+}
+
+/// Sum over the rows selected by `mask`, or over all rows
+[[nodiscard]] inline std::int64_t sum(const IntegerColumn& col, const Mask* mask = nullptr) noexcept {
+    const auto n = col.values.size();
+    const auto in = col.values.data();
+    std::int64_t ret = 0;
+    if (mask == nullptr) {
+        for (std::size_t i = 0; i < n; ++i)
+            ret += in[i];
+    } else {
+        const auto sel = mask->data();
+        for (std::size_t i = 0; i < n; ++i)
+            ret += in[i] & -static_cast<std::int64_t>(sel[i]);
+    }
+    return ret;
+}
+
+/// Per-group aggregates, indexed by the code of the key in its column's dictionary
+struct Groups {
+    std::vector<std::int64_t> sums;
+    std::vector<std::uint64_t> counts;
+};
+/// Sums `value` grouped by `key`; rows without a key, or not selected by `mask`, are left out
+[[nodiscard]] inline Groups group_sum(const StringColumn& key, const IntegerColumn& value, const Mask* mask = nullptr) {
+    // Absent keys land in one extra trailing group, which is dropped, so the loop needs no branch
+    const auto groups = key.dictionary.size();
+    Groups ret{std::vector<std::int64_t>(groups + 1), std::vector<std::uint64_t>(groups + 1)};
+    const auto n = key.codes.size();
+    const auto codes = key.codes.data();
+    const auto in = value.values.data();
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto sel = mask != nullptr ? (*mask)[i] : std::uint8_t{1};
+        const auto group = std::min<std::size_t>(codes[i], groups);
+        ret.sums[group] += in[i] & -static_cast<std::int64_t>(sel);
+        ret.counts[group] += sel;
+    }
+    ret.sums.pop_back();
+    ret.counts.pop_back();
+    return ret;
+}
+
+/// Up to `k` rows with the largest values, largest first; ties keep row order
+[[nodiscard]] inline std::vector<Row> top(const IntegerColumn& col, std::size_t k, const Mask* mask = nullptr) {
+    std::vector<Row> ret;
+    if (mask != nullptr) {
+        ret = rows(*mask);
+    } else {
+        ret.resize(col.values.size());
+        for (std::size_t i = 0; i < ret.size(); ++i)
+            ret[i] = static_cast<Row>(i);
+    }
+    const auto greater = [&](Row lhs, Row rhs) { return col.values[lhs] != col.values[rhs] ? col.values[lhs] > col.values[rhs] : lhs < rhs; };
+    k = std::min(k, ret.size());
+    std::partial_sort(ret.begin(), ret.begin() + static_cast<std::ptrdiff_t>(k), ret.end(), greater);
+    ret.resize(k);
+    return ret;
+}
+
+/// Common fields, to pass to Builder
+namespace fields {
+namespace impl {
+[[nodiscard]] inline std::int64_t child_integer(Domain dom, const char* name) noexcept {
+    const auto child = dom ? NodeAccess::of(dom)->first_node(name) : nullptr;
+    if (child == nullptr)
+        return 0;
+    return std::strtoll(child->value(), nullptr, integer_base({child->value(), child->value_size()}));
+}
+} // namespace impl
+
+/// Maximum vCPU count, from <vcpu>
+[[nodiscard]] inline std::int64_t vcpus(Domain dom) noexcept { return impl::child_integer(dom, "vcpu"); }
+/// Maximum memory in KiB, from <memory> and its unit
+[[nodiscard]] inline std::int64_t memory_kib(Domain dom) noexcept {
+    const auto memory = dom ? NodeAccess::of(dom)->first_node("memory") : nullptr;
+    const auto bytes = memory != nullptr ? ScaledIntegral{memory}.bytes(1024) : std::nullopt;
+    return bytes ? static_cast<std::int64_t>(*bytes / 1024) : 0;
+}
+[[nodiscard]] inline std::int64_t disk_count(Domain dom) noexcept {
+    std::int64_t ret = 0;
+    if (const auto devices = dom ? dom.devices() : Domain::Devices{nullptr})
+        for ([[maybe_unused]] const auto disk : devices.disks())
+            ++ret;
+    return ret;
+}
+[[nodiscard]] inline std::int64_t hostdev_count(Domain dom) noexcept {
+    std::int64_t ret = 0;
+    if (const auto devices = dom ? dom.devices() : Domain::Devices{nullptr})
+        for ([[maybe_unused]] const auto hostdev : devices.hostdevs())
+            ++ret;
+    return ret;
+}
+[[nodiscard]] inline std::optional<std::string_view> name(Domain dom) noexcept {
+    if (!dom || !dom.name())
+        return std::nullopt;
+    return static_cast<std::string_view>(dom.name());
+}
+[[nodiscard]] inline std::optional<std::string_view> type(Domain dom) noexcept {
+    const auto attr = dom ? NodeAccess::of(dom)->first_attribute("type") : nullptr;
+    if (attr == nullptr)
+        return std::nullopt;
+    return std::string_view{attr->value(), attr->value_size()};
+}
+} // namespace fields
+} // namespace fleet
+
+} // namespace
+} // namespace virtxml
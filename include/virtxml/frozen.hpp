@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <gsl/gsl>
+#include <rapidxml_ns.hpp>
+#include "generic.hpp"
+#include "intern.hpp"
+#include "node_ref.hpp"
+
+namespace virtxml {
+inline namespace {
+
+namespace frozen {
+using Symbol = std::uint32_t; // element name, numbered by first appearance within its document
+constexpr std::uint32_t none = records::none;
+
+/// What a frozen document keeps about an element besides its record, for scans by name
+struct Element {
+    Symbol name;
+    std::uint32_t end; // the element's descendants are the elements in (own index, end)
+};
+} // namespace frozen
+
+/// A read-only copy of a document re-laid in document order, for long-lived documents such as capabilities or domain caches
+/// Elements are 36-byte records of 32-bit links and string offsets, in one contiguous block with the attributes and the strings,
+/// and the views walk them in place through NodeRef; each distinct string is stored once
+/// Every element also has a name symbol, so that finding every element of a name, in the whole document or in one subtree,
+/// is a linear scan over an array of 8-byte entries
+/// Like snapshots, only elements and their values and attributes are kept, not text or comment nodes
+/// Given an InternTable, strings are taken from it instead of being copied into the document, and are then shared across
+/// documents: name_of() and the names and values of the elements of every document frozen with the same table compare by address
+class FrozenDocument {
+  public:
+    using Symbol = frozen::Symbol;
+
+  private:
+    std::unique_ptr<char[]> block; // the tree, the interned string pointers if any, the elements, the attributes, then the strings
+    std::size_t block_size = 0;
+    std::vector<frozen::Element> elements;
+    std::vector<std::string_view> symbols;
+    std::unordered_map<std::string_view, Symbol> symbol_ids;
+
+    /// Where the records are; it lives at the start of the block, so that views stay valid when the document is moved
+    [[nodiscard]] inline const records::Tree& tree() const noexcept { return *reinterpret_cast<const records::Tree*>(block.get()); }
+
+    template <class View, class F> void scan(std::uint32_t first, std::uint32_t last, std::string_view name, F& fn) const {
+        const auto it = symbol_ids.find(name);
+        if (it == symbol_ids.end())
+            return;
+        const auto symbol = it->second;
+        for (auto i = first; i < last; ++i)
+            if (elements[i].name == symbol)
+                fn(View{element(i)});
+    }
+
+    static_assert(alignof(records::Tree) >= alignof(const char*) && alignof(const char*) >= alignof(records::Element) &&
+                      alignof(records::Tree) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                  "the tree, the string pointers, then the records are laid out from the start of the block");
+    static_assert(std::is_trivially_destructible_v<records::Tree>, "the block is released without destroying its tree");
+
+  public:
+    /// Copies the subtree of the element `root`, which only needs to live during the call; it may itself be frozen or a snapshot
+    /// Strings come from `strings` if given, which must then outlive the document
+    explicit FrozenDocument(NodeRef root, InternTable* strings = nullptr) {
+        records::Builder builder;
+        if (root != nullptr)
+            builder.add(root);
+        const auto element_count = builder.elements.size();
+
+        // Names are numbered by first appearance; the builder stores each distinct string once, so its offset identifies it
+        std::unordered_map<std::uint32_t, Symbol> numbered;
+        elements.reserve(element_count);
+        for (std::uint32_t i = 0; i < element_count; ++i) {
+            const auto& el = builder.elements[i];
+            const auto symbol = numbered.try_emplace(el.name.offset, static_cast<Symbol>(numbered.size())).first;
+            // Elements are in document order: the parent's range is known, and ends where the next sibling starts
+            const auto end = el.next_sibling != records::none ? el.next_sibling
+                             : el.parent != records::none     ? elements[el.parent].end
+                                                              : static_cast<std::uint32_t>(element_count);
+            elements.push_back(frozen::Element{symbol->second, end});
+        }
+
+        // Interned strings are numbered, and string offsets become indices among them
+        std::vector<const char*> interned;
+        if (strings != nullptr) {
+            std::unordered_map<std::uint32_t, std::uint32_t> numbers;
+            interned.reserve(builder.offsets.size());
+            numbers.reserve(builder.offsets.size());
+            for (const auto& [str, ref] : builder.offsets) {
+                numbers.emplace(ref.offset, static_cast<std::uint32_t>(interned.size()));
+                interned.push_back(strings->intern(str).data());
+            }
+            const auto renumber = [&](records::Item& item) {
+                item.name.offset = numbers.at(item.name.offset);
+                item.value.offset = numbers.at(item.value.offset);
+            };
+            std::for_each(builder.elements.begin(), builder.elements.end(), renumber);
+            std::for_each(builder.attributes.begin(), builder.attributes.end(), renumber);
+            builder.strings.clear();
+        }
+
+        const auto pointers_at = sizeof(records::Tree);
+        const auto elements_at = pointers_at + interned.size() * sizeof(const char*);
+        const auto attributes_at = elements_at + element_count * sizeof(records::Element);
+        const auto strings_at = attributes_at + builder.attributes.size() * sizeof(records::Attribute);
+        block_size = strings_at + builder.strings.size();
+        block = std::make_unique<char[]>(block_size);
+        const auto place = [&](std::size_t at, const void* from, std::size_t size) {
+            if (size != 0)
+                std::memcpy(block.get() + at, from, size);
+        };
+        place(pointers_at, interned.data(), interned.size() * sizeof(const char*));
+        place(elements_at, builder.elements.data(), element_count * sizeof(records::Element));
+        place(attributes_at, builder.attributes.data(), builder.attributes.size() * sizeof(records::Attribute));
+        place(strings_at, builder.strings.data(), builder.strings.size());
+        const auto& frozen_tree = *new (block.get()) records::Tree{reinterpret_cast<const records::Element*>(block.get() + elements_at),
+                                                                    reinterpret_cast<const records::Attribute*>(block.get() + attributes_at),
+                                                                    block.get() + strings_at,
+                                                                    strings != nullptr ? reinterpret_cast<const char* const*>(block.get() + pointers_at)
+                                                                                       : nullptr};
+
+        std::vector<std::uint32_t> first_of(numbered.size());
+        for (auto i = static_cast<std::uint32_t>(element_count); i-- > 0;)
+            first_of[elements[i].name] = i;
+        symbols.reserve(first_of.size());
+        for (const auto i : first_of) {
+            const auto& el = frozen_tree.elements[i];
+            symbols.emplace_back(frozen_tree.text(el.name), el.name.size);
+            symbol_ids.emplace(symbols.back(), static_cast<Symbol>(symbols.size() - 1));
+        }
+    }
+    FrozenDocument(FrozenDocument&&) noexcept = default;
+    FrozenDocument& operator=(FrozenDocument&&) noexcept = default;
+    FrozenDocument(const FrozenDocument&) = delete;
+    FrozenDocument& operator=(const FrozenDocument&) = delete;
+
+    /// The root element, null for a document frozen from nothing
+    [[nodiscard]] inline NodeRef root() const noexcept { return NodeRef{tree(), elements.empty() ? records::none : 0}; }
+    /// The root element `name` as a view, e.g. `frozen.root_as<Domain>("domain")`; null if the root element is named otherwise
+    template <class View> [[nodiscard]] inline View root_as(gsl::czstring<> name) const noexcept {
+        return View{!elements.empty() && tree().named(tree().elements[0], name, std::strlen(name)) ? root() : nullptr};
+    }
+
+    [[nodiscard]] inline std::uint32_t element_count() const noexcept { return static_cast<std::uint32_t>(elements.size()); }
+    [[nodiscard]] inline NodeRef element(std::uint32_t index) const noexcept { return NodeRef{tree(), index}; }
+    [[nodiscard]] inline const records::Element& record(std::uint32_t index) const noexcept { return tree().elements[index]; }
+    [[nodiscard]] inline Symbol symbol_of(std::uint32_t index) const noexcept { return elements[index].name; }
+    /// Index of an element of this document, such as the element behind a view over it
+    [[nodiscard]] inline std::optional<std::uint32_t> index_of(NodeRef node) const noexcept {
+        if (node == nullptr || node.owner() != &tree())
+            return std::nullopt;
+        return node.index();
+    }
+
+    [[nodiscard]] inline std::optional<Symbol> symbol(std::string_view name) const noexcept {
+        const auto it = symbol_ids.find(name);
+        return it != symbol_ids.end() ? std::optional{it->second} : std::nullopt;
+    }
+    [[nodiscard]] inline std::string_view name_of(Symbol symbol) const noexcept { return symbols[symbol]; }
+
+    /// Calls `fn(View)` for every element named `name`, in document order, e.g. `for_each<Domain::Devices::Disk>("disk", fn)`
+    template <class View, class F> void for_each(std::string_view name, F&& fn) const { scan<View>(0, element_count(), name, fn); }
+    /// Same, restricted to the descendants of `scope`, an element of this document
+    template <class View, class F> void for_each_in(NodeRef scope, std::string_view name, F&& fn) const {
+        if (const auto index = index_of(scope))
+            scan<View>(*index + 1, elements[*index].end, name, fn);
+    }
+
+    /// Bytes held by the document: its block of records and strings (unless interned), and its name symbols
+    [[nodiscard]] inline std::size_t memory_usage() const noexcept {
+        return block_size + elements.capacity() * sizeof(frozen::Element) + symbols.capacity() * sizeof(std::string_view);
+    }
+};
+
+/// Freezes the subtree of an element, or of the element behind a view such as a Domain, a Device or DriverCapabilities
+template <class View> [[nodiscard]] FrozenDocument freeze(const View& view, InternTable* strings = nullptr) {
+    if constexpr (std::is_pointer_v<View> || std::is_same_v<View, NodeRef>)
+        return FrozenDocument{view, strings};
+    else
+        return FrozenDocument{NodeAccess::of(view), strings};
+}
+
+} // namespace
+} // namespace virtxml
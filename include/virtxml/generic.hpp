@@ -1,6 +1,8 @@
 #pragma once
 
+#include <type_traits>
 #include <rapidxml_ns.hpp>
+#include "node_ref.hpp"
 
 namespace virtxml {
 using namespace rapidxml_ns;
@@ -8,9 +10,11 @@ using namespace rapidxml_ns;
 template <typename T> using Optional = T;
 
 template <class, class> struct HasMore;
+struct NodeAccess;
 
 struct Node {
     constexpr Node(xml_node<>* node) : node(node) {}
+    constexpr Node(NodeRef node) : node(node) {}
 #if 1 /* With functions */
     constexpr explicit operator bool() const noexcept { return node != nullptr; }
 #else /* With paramexpr */
@@ -18,13 +22,24 @@ struct Node {
 #endif
 
     template <class, class> friend struct HasMore;
+    friend NodeAccess;
 
   protected:
-    xml_node<>* node;
+    NodeRef node;
+};
+
+/// Grants serializers access to the element a view is bound to
+struct NodeAccess {
+    template <class View> [[nodiscard]] static inline NodeRef of(const View& view) noexcept {
+        if constexpr (std::is_base_of_v<Node, View>)
+            return static_cast<const Node&>(view).node;
+        else
+            return view.cap();
+    }
 };
 
 template <class FCRTP, class CRTP> struct HasMore {
-    [[nodiscard]] inline const xml_node<>* get_node() const noexcept {
+    [[nodiscard]] inline NodeRef get_node() const noexcept {
         return static_cast<const Node&>(static_cast<const FCRTP&>(static_cast<const CRTP&>(*this))).node;
     }
 };
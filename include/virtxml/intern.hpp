@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace virtxml {
+inline namespace {
+
+/// Strings shared by many resident documents, such as emulator paths, machine types, bridge names or cpu models, each stored once
+/// Interning the same contents always yields the same pointer, so interned strings compare and hash by address alone;
+/// strings are NUL-terminated and live as long as the table
+/// Safe to use from any number of threads: the table is split in shards, each read under a shared lock and written under an
+/// exclusive one, so that concurrent freezes of distinct documents seldom contend
+class InternTable {
+    static constexpr std::size_t chunk_size = 16 * 1024;
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_set<std::string_view> strings;
+        std::vector<std::unique_ptr<char[]>> chunks;
+        char* cursor = nullptr;
+        std::size_t left = 0;
+        std::size_t bytes = 0;
+
+        /// Copies `str` into the shard's chunks; called with the exclusive lock held
+        [[nodiscard]] std::string_view store(std::string_view str) {
+            const auto size = str.size() + 1;
+            char* dest;
+            if (size > chunk_size / 4) {
+                // Large strings get a chunk of their own, and the current chunk goes on being filled
+                chunks.push_back(std::make_unique<char[]>(size));
+                bytes += size;
+                dest = chunks.back().get();
+            } else {
+                if (size > left) {
+                    chunks.push_back(std::make_unique<char[]>(chunk_size));
+                    bytes += chunk_size;
+                    cursor = chunks.back().get();
+                    left = chunk_size;
+                }
+                dest = cursor;
+                cursor += size;
+                left -= size;
+            }
+            std::memcpy(dest, str.data(), str.size());
+            dest[str.size()] = '\0';
+            return {dest, str.size()};
+        }
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    std::size_t shard_count;
+
+  public:
+    explicit InternTable(std::size_t shard_count = 16) : shards(std::make_unique<Shard[]>(std::max<std::size_t>(1, shard_count))),
+                                                         shard_count(std::max<std::size_t>(1, shard_count)) {}
+    InternTable(const InternTable&) = delete;
+    InternTable& operator=(const InternTable&) = delete;
+
+    /// The interned copy of `str`, made on first sight
+    [[nodiscard]] std::string_view intern(std::string_view str) {
+        auto& shard = shards[std::hash<std::string_view>{}(str) % shard_count];
+        {
+            std::shared_lock lock{shard.mutex};
+            if (const auto it = shard.strings.find(str); it != shard.strings.end())
+                return *it;
+        }
+        std::unique_lock lock{shard.mutex};
+        if (const auto it = shard.strings.find(str); it != shard.strings.end())
+            return *it;
+        return *shard.strings.insert(shard.store(str)).first;
+    }
+    /// The interned copy of `str`, if any; never inserts
+    [[nodiscard]] std::string_view find(std::string_view str) const {
+        const auto& shard = shards[std::hash<std::string_view>{}(str) % shard_count];
+        std::shared_lock lock{shard.mutex};
+        const auto it = shard.strings.find(str);
+        return it != shard.strings.end() ? *it : std::string_view{};
+    }
+    /// Equality of two strings interned by the same table
+    [[nodiscard]] static constexpr bool same(std::string_view lhs, std::string_view rhs) noexcept { return lhs.data() == rhs.data(); }
+
+    /// Number of distinct strings
+    [[nodiscard]] std::size_t size() const {
+        std::size_t ret = 0;
+        for (std::size_t i = 0; i < shard_count; ++i) {
+            std::shared_lock lock{shards[i].mutex};
+            ret += shards[i].strings.size();
+        }
+        return ret;
+    }
+    /// Bytes of string storage, excluding the hash sets
+    [[nodiscard]] std::size_t memory_usage() const {
+        std::size_t ret = 0;
+        for (std::size_t i = 0; i < shard_count; ++i) {
+            std::shared_lock lock{shards[i].mutex};
+            ret += shards[i].bytes;
+        }
+        return ret;
+    }
+};
+
+} // namespace
+} // namespace virtxml
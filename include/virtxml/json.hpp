@@ -0,0 +1,345 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <initializer_list>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <rapidxml_ns.hpp>
+#include "generic.hpp"
+#include "xmlval.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Typing of the attributes and elements of a document for JSON output
+/// Elements and attributes the schema does not describe are typed by looking at their text
+class JsonSchema {
+  public:
+    enum class Kind {
+        automatic, // yes/no and on/off are booleans, canonical decimal integers are numbers, the rest are strings
+        string,    // also used for enumerations
+        number,    // decimal, or 0x-prefixed hexadecimal as in PCI addresses
+        boolean,
+    };
+
+    struct Element {
+        Kind value = Kind::automatic;
+        bool repeated = false; // always emitted as an array, even when there is a single occurrence
+        std::map<std::string_view, Kind, std::less<>> attributes;
+        std::map<std::string_view, Element, std::less<>> children;
+
+        Element& attribute(std::string_view name, Kind kind) {
+            attributes[name] = kind;
+            return *this;
+        }
+        Element& text(Kind kind) {
+            value = kind;
+            return *this;
+        }
+        Element& child(std::string_view name, bool repeat = false) {
+            auto& ret = children[name];
+            ret.repeated = ret.repeated || repeat;
+            return ret;
+        }
+        [[nodiscard]] inline const Element* find_child(std::string_view name) const noexcept {
+            const auto it = children.find(name);
+            return it != children.end() ? &it->second : nullptr;
+        }
+        [[nodiscard]] inline Kind attribute_kind(std::string_view name) const noexcept {
+            const auto it = attributes.find(name);
+            return it != attributes.end() ? it->second : Kind::automatic;
+        }
+    };
+
+    Element root;
+};
+
+/// Subset of a document to emit, as '/'-separated paths from the root ("name", "devices/disk/source", "devices/disk/target/dev")
+/// A path selects the element or attribute it names with everything below it
+class JsonProjection {
+    struct Step {
+        bool whole = false;
+        std::map<std::string, Step, std::less<>> next;
+    };
+    Step root;
+
+  public:
+    JsonProjection(std::initializer_list<std::string_view> paths) {
+        for (const auto path : paths)
+            add(path);
+    }
+
+    void add(std::string_view path) {
+        auto* step = &root;
+        while (!path.empty()) {
+            const auto slash = path.find('/');
+            step = &step->next[std::string{path.substr(0, slash)}];
+            path = slash == std::string_view::npos ? std::string_view{} : path.substr(slash + 1);
+        }
+        step->whole = true;
+    }
+
+    struct Cursor {
+        const Step* step; // nullptr once everything below is selected
+
+        [[nodiscard]] inline bool all() const noexcept { return step == nullptr; }
+        /// Cursor for the child `name`, or nothing if it is not selected
+        [[nodiscard]] inline std::optional<Cursor> enter(std::string_view name) const {
+            if (step == nullptr)
+                return *this;
+            const auto it = step->next.find(name);
+            if (it == step->next.end())
+                return std::nullopt;
+            return Cursor{it->second.whole ? nullptr : &it->second};
+        }
+    };
+    [[nodiscard]] inline Cursor cursor() const noexcept { return Cursor{root.whole ? nullptr : &root}; }
+};
+
+namespace impl {
+class JsonTranscoder {
+    using Kind = JsonSchema::Kind;
+    using Cursor = JsonProjection::Cursor;
+
+    std::string& out;
+    inline static const JsonSchema::Element untyped{};
+
+    void string(std::string_view str) {
+        constexpr char hex[] = "0123456789abcdef";
+        out.push_back('"');
+        auto run = str.begin();
+        for (auto it = str.begin(); it != str.end(); ++it) {
+            const auto c = static_cast<unsigned char>(*it);
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+            out.append(run, it);
+            run = it + 1;
+            switch (c) {
+            case '"':
+                out.append("\\\"");
+                break;
+            case '\\':
+                out.append("\\\\");
+                break;
+            case '\n':
+                out.append("\\n");
+                break;
+            case '\t':
+                out.append("\\t");
+                break;
+            case '\r':
+                out.append("\\r");
+                break;
+            default:
+                out.append("\\u00").push_back(hex[c >> 4u]);
+                out.push_back(hex[c & 0xFu]);
+            }
+        }
+        out.append(run, str.end());
+        out.push_back('"');
+    }
+
+    [[nodiscard]] static bool is_canonical_integer(std::string_view str) noexcept {
+        if (!str.empty() && str.front() == '-')
+            str.remove_prefix(1);
+        if (str.empty() || str.size() > 18 || (str.front() == '0' && str.size() > 1))
+            return false;
+        for (const auto c : str)
+            if (c < '0' || c > '9')
+                return false;
+        return true;
+    }
+
+    [[nodiscard]] static std::optional<bool> as_boolean(std::string_view str) noexcept {
+        if (str == "yes" || str == "on" || str == "true")
+            return true;
+        if (str == "no" || str == "off" || str == "false")
+            return false;
+        return std::nullopt;
+    }
+
+    void scalar(const char* value, std::size_t size, Kind kind) {
+        const std::string_view str{value, size};
+        switch (kind) {
+        case Kind::automatic:
+            if (const auto b = as_boolean(str))
+                out.append(*b ? "true" : "false");
+            else if (is_canonical_integer(str))
+                out.append(str);
+            else
+                string(str);
+            return;
+        case Kind::number: {
+            if (is_canonical_integer(str)) {
+                out.append(str);
+                return;
+            }
+            // strtoull would wrap a negative value around; a value out of range stays a string
+            const auto sign = str.find_first_not_of(" \t\r\n");
+            const auto negative = sign != std::string_view::npos && str[sign] == '-';
+            char* end = nullptr;
+            errno = 0;
+            const auto number = negative ? std::to_string(std::strtoll(value, &end, integer_base(str)))
+                                         : std::to_string(std::strtoull(value, &end, integer_base(str)));
+            if (size != 0 && end == value + size && errno == 0)
+                out.append(number);
+            else
+                string(str);
+            return;
+        }
+        case Kind::boolean:
+            if (const auto b = as_boolean(str))
+                out.append(*b ? "true" : "false");
+            else
+                string(str);
+            return;
+        case Kind::string:
+            string(str);
+            return;
+        }
+    }
+
+    [[nodiscard]] static bool is_repeated(NodeRef first, const JsonSchema::Element& schema) noexcept {
+        if (schema.repeated)
+            return true;
+        return first->next_sibling(first->name(), first->name_size()) != nullptr;
+    }
+
+    void element(NodeRef node, const JsonSchema::Element& schema, Cursor cursor) {
+        bool has_members = false;
+        for (auto attr = node->first_attribute(); attr != nullptr && !has_members; attr = attr->next_attribute())
+            has_members = cursor.all() || cursor.enter({attr->name(), attr->name_size()});
+        for (auto child = node->first_node(); child != nullptr && !has_members; child = child->next_sibling())
+            has_members = child->type() == node_element && (cursor.all() || cursor.enter({child->name(), child->name_size()}));
+        if (!has_members) {
+            if (node->value_size() == 0 && schema.value == Kind::automatic)
+                out.append("{}");
+            else
+                scalar(node->value(), node->value_size(), schema.value);
+            return;
+        }
+
+        out.push_back('{');
+        bool first = true;
+        const auto key = [&](std::string_view name) {
+            if (!first)
+                out.push_back(',');
+            first = false;
+            string(name);
+            out.push_back(':');
+        };
+        for (auto attr = node->first_attribute(); attr != nullptr; attr = attr->next_attribute()) {
+            const std::string_view name{attr->name(), attr->name_size()};
+            if (!cursor.enter(name))
+                continue;
+            key(name);
+            scalar(attr->value(), attr->value_size(), schema.attribute_kind(name));
+        }
+        // Indentation between child elements is not content
+        const std::string_view text{node->value(), node->value_size()};
+        if (text.find_first_not_of(" \t\r\n") != std::string_view::npos && cursor.all()) {
+            key("#text");
+            scalar(node->value(), node->value_size(), schema.value);
+        }
+        // Groups siblings of the same name into one array, in order of first appearance
+        std::vector<std::string_view> done;
+        for (auto child = node->first_node(); child != nullptr; child = child->next_sibling()) {
+            if (child->type() != node_element)
+                continue;
+            const std::string_view name{child->name(), child->name_size()};
+            const auto sub = cursor.enter(name);
+            if (!sub || std::find(done.begin(), done.end(), name) != done.end())
+                continue;
+            const auto found = schema.find_child(name);
+            const auto& child_schema = found != nullptr ? *found : untyped;
+            key(name);
+            if (!is_repeated(child, child_schema)) {
+                element(child, child_schema, *sub);
+                continue;
+            }
+            done.push_back(name);
+            out.push_back('[');
+            for (auto item = child; item != nullptr; item = item->next_sibling(child->name(), child->name_size())) {
+                if (item != child)
+                    out.push_back(',');
+                element(item, child_schema, *sub);
+            }
+            out.push_back(']');
+        }
+        out.push_back('}');
+    }
+
+  public:
+    explicit JsonTranscoder(std::string& out) : out(out) {}
+
+    void run(NodeRef root, const JsonSchema* schema, const JsonProjection* projection) {
+        if (root == nullptr) {
+            out.append("null");
+            return;
+        }
+        element(root, schema != nullptr ? schema->root : untyped, projection != nullptr ? projection->cursor() : Cursor{nullptr});
+    }
+};
+} // namespace impl
+
+/// Appends the JSON form of `root` to `out` in a single walk of the document, without building any intermediate tree
+/// Attributes and child elements become members, repeated children arrays, and the text of an element with members "#text"
+inline void to_json(NodeRef root, std::string& out, const JsonSchema* schema = nullptr, const JsonProjection* projection = nullptr) {
+    impl::JsonTranscoder{out}.run(root, schema, projection);
+}
+template <class View, class = std::enable_if_t<!std::is_pointer_v<View>>>
+inline void to_json(const View& view, std::string& out, const JsonSchema* schema = nullptr, const JsonProjection* projection = nullptr) {
+    to_json(NodeAccess::of(view), out, schema, projection);
+}
+
+/// Typing of the parts of <domain> that virthttp serves most
+[[nodiscard]] inline const JsonSchema& domain_json_schema() {
+    static const JsonSchema schema = [] {
+        using Kind = JsonSchema::Kind;
+        JsonSchema ret;
+        auto& dom = ret.root.attribute("id", Kind::number).attribute("type", Kind::string);
+        dom.child("name").text(Kind::string);
+        dom.child("uuid").text(Kind::string);
+        dom.child("title").text(Kind::string);
+        dom.child("description").text(Kind::string);
+        dom.child("memory").text(Kind::number);
+        dom.child("currentMemory").text(Kind::number);
+        dom.child("vcpu").text(Kind::number).attribute("current", Kind::number);
+        auto& os = dom.child("os");
+        os.child("boot", true).attribute("dev", Kind::string);
+        os.child("type").attribute("arch", Kind::string).attribute("machine", Kind::string).text(Kind::string);
+        auto& devices = dom.child("devices");
+        for (const auto name : {"disk", "interface", "controller", "hostdev", "filesystem", "graphics", "video", "serial", "console",
+                                "channel", "input", "sound", "redirdev", "smartcard", "rng", "tpm", "memory", "watchdog", "panic"})
+            devices.child(name, true);
+        auto& disk = devices.child("disk", true);
+        disk.child("source").child("host", true).attribute("port", Kind::number);
+        disk.child("target").attribute("dev", Kind::string);
+        for (const auto name : {"disk", "interface", "controller", "hostdev"}) {
+            auto& address = devices.child(name, true).child("address");
+            for (const auto field : {"domain", "bus", "slot", "function", "controller", "target", "unit"})
+                address.attribute(field, Kind::number);
+            address.attribute("multifunction", Kind::boolean);
+        }
+        auto& iface = devices.child("interface", true);
+        iface.child("mac").attribute("address", Kind::string);
+        iface.child("vlan").attribute("trunk", Kind::boolean).child("tag", true).attribute("id", Kind::number);
+        for (const auto dir : {"inbound", "outbound"}) {
+            auto& rates = iface.child("bandwidth").child(dir);
+            for (const auto field : {"average", "peak", "floor", "burst"})
+                rates.attribute(field, Kind::number);
+        }
+        devices.child("graphics", true).attribute("port", Kind::number).attribute("autoport", Kind::boolean);
+        return ret;
+    }();
+    return schema;
+}
+
+} // namespace
+} // namespace virtxml
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "domain.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Fleet-wide index from packed 48-bit MAC addresses to the interfaces carrying them
+/// Open addressing with linear probing and backward-shift deletion; interfaces sharing a MAC are chained, and the MAC reported as duplicate
+template <class Key = std::string> class MacIndex {
+  public:
+    using Interface = Domain::Devices::Interface;
+
+    struct Owner {
+        Key domain;
+        Interface interface;
+    };
+
+  private:
+    constexpr static std::uint64_t empty = ~std::uint64_t{0}; // never a 48-bit value
+    constexpr static std::uint32_t npos = ~std::uint32_t{0};
+
+    struct Slot {
+        std::uint64_t mac = empty;
+        std::uint32_t owner = npos; // head of the chain of owners
+    };
+    struct Entry {
+        Owner owner;
+        std::uint64_t mac;
+        std::uint32_t next;
+    };
+
+    std::vector<Slot> slots = std::vector<Slot>(16);
+    std::size_t used = 0;
+    std::vector<Entry> entries;
+    std::vector<std::uint32_t> free_entries;
+    std::unordered_map<Key, std::vector<std::uint32_t>> domain_entries;
+    std::unordered_set<std::uint64_t> duplicated;
+
+    [[nodiscard]] inline std::size_t home(std::uint64_t mac) const noexcept {
+        return static_cast<std::size_t>((mac * 0x9E3779B97F4A7C15u) >> 32u) & (slots.size() - 1);
+    }
+
+    [[nodiscard]] inline std::size_t probe(std::uint64_t mac) const noexcept {
+        auto pos = home(mac);
+        while (slots[pos].mac != mac && slots[pos].mac != empty)
+            pos = (pos + 1) & (slots.size() - 1);
+        return pos;
+    }
+
+    void grow() {
+        auto old = std::move(slots);
+        slots.assign(old.size() * 2, Slot{});
+        for (const auto& slot : old)
+            if (slot.mac != empty)
+                slots[probe(slot.mac)] = slot;
+    }
+
+    void erase_slot(std::size_t pos) {
+        const auto mask = slots.size() - 1;
+        for (auto next = (pos + 1) & mask; slots[next].mac != empty; next = (next + 1) & mask) {
+            // Move back any entry whose probe sequence passes through the hole
+            if (((next - home(slots[next].mac)) & mask) >= ((next - pos) & mask)) {
+                slots[pos] = slots[next];
+                pos = next;
+            }
+        }
+        slots[pos] = Slot{};
+        --used;
+    }
+
+    [[nodiscard]] inline std::uint32_t allocate(Entry entry) {
+        if (free_entries.empty()) {
+            entries.push_back(std::move(entry));
+            return static_cast<std::uint32_t>(entries.size() - 1);
+        }
+        const auto idx = free_entries.back();
+        free_entries.pop_back();
+        entries[idx] = std::move(entry);
+        return idx;
+    }
+
+    void unlink(std::uint32_t idx) {
+        const auto pos = probe(entries[idx].mac);
+        auto* link = &slots[pos].owner;
+        while (*link != idx)
+            link = &entries[*link].next;
+        *link = entries[idx].next;
+        if (slots[pos].owner == npos) {
+            duplicated.erase(entries[idx].mac);
+            erase_slot(pos);
+        } else if (entries[slots[pos].owner].next == npos) {
+            duplicated.erase(entries[idx].mac);
+        }
+        free_entries.push_back(idx);
+    }
+
+  public:
+    inline void reserve(std::size_t count) {
+        while (slots.size() < count * 2)
+            grow();
+        entries.reserve(count);
+    }
+
+    /// Records `iface` of the domain `key` under `mac`; returns false if another interface already carries it
+    bool insert(const Key& key, std::uint64_t mac, Interface iface) {
+        if ((used + 1) * 2 > slots.size())
+            grow();
+        auto& slot = slots[probe(mac)];
+        if (slot.mac == empty) {
+            slot.mac = mac;
+            ++used;
+        }
+        const auto idx = allocate(Entry{Owner{key, iface}, mac, slot.owner});
+        slot.owner = idx;
+        domain_entries[key].push_back(idx);
+        if (entries[idx].next == npos)
+            return true;
+        duplicated.insert(mac);
+        return false;
+    }
+
+    /// Indexes every interface of `dom` that has a valid MAC, replacing whatever was recorded under `key` before
+    /// Returns the number of interfaces whose MAC was already taken
+    std::size_t add_domain(const Key& key, Domain dom) {
+        remove_domain(key);
+        std::size_t dups = 0;
+        const auto devices = dom.devices();
+        if (!devices)
+            return 0;
+        for (const auto iface : devices.interfaces()) {
+            const auto mac = iface.mac();
+            const auto packed = mac ? mac.address().packed() : std::nullopt;
+            if (packed && !insert(key, *packed, iface))
+                ++dups;
+        }
+        return dups;
+    }
+
+    void remove_domain(const Key& key) {
+        const auto it = domain_entries.find(key);
+        if (it == domain_entries.end())
+            return;
+        for (const auto idx : it->second)
+            unlink(idx);
+        domain_entries.erase(it);
+    }
+
+    /// Most recently inserted owner of `mac`
+    [[nodiscard]] inline const Owner* find(std::uint64_t mac) const noexcept {
+        const auto& slot = slots[probe(mac)];
+        return slot.mac == mac ? &entries[slot.owner].owner : nullptr;
+    }
+
+    /// Calls `fn(const Owner&)` for every interface carrying `mac`
+    template <class F> void for_each_owner(std::uint64_t mac, F&& fn) const {
+        const auto& slot = slots[probe(mac)];
+        if (slot.mac != mac)
+            return;
+        for (auto idx = slot.owner; idx != npos; idx = entries[idx].next)
+            fn(entries[idx].owner);
+    }
+
+    [[nodiscard]] inline bool is_duplicated(std::uint64_t mac) const noexcept { return duplicated.count(mac) != 0; }
+    [[nodiscard]] inline const std::unordered_set<std::uint64_t>& duplicates() const noexcept { return duplicated; }
+    /// Number of distinct MACs
+    [[nodiscard]] inline std::size_t size() const noexcept { return used; }
+};
+
+} // namespace
+} // namespace virtxml
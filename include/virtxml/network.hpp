@@ -1,5 +1,8 @@
 #pragma once
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
 #include <string_view>
 #include <type_traits>
 #include <magic_enum.hpp>
@@ -55,7 +58,7 @@ struct Bandwidth : public Node {
         [[nodiscard]] inline Optional<Integral> average() const noexcept { return Integral{node->first_attribute("average")}; }
         [[nodiscard]] inline Optional<Integral> peak() const noexcept { return Integral{node->first_attribute("peak")}; }
         [[nodiscard]] inline Optional<Integral> floor() const noexcept { return Integral{node->first_attribute("floor")}; }
-        [[nodiscard]] inline Optional<Integral> burst() const noexcept { return Integral{node->first_attribute("bur  st")}; }
+        [[nodiscard]] inline Optional<Integral> burst() const noexcept { return Integral{node->first_attribute("burst")}; }
     };
 
     [[nodiscard]] inline Optional<Attributes> inbound() const noexcept { return Attributes{node->first_node("inbound")}; }
@@ -80,5 +83,123 @@ struct Vlan : public Node {
     [[nodiscard]] inline NamedSpan<Tag> tags() const noexcept { return NamedSpan<Tag>{"tag", node}; }
 };
 
+/// <network>, as returned by virNetworkGetXMLDesc
+struct Network : public Node {
+    struct Forward : public Node {
+        enum class Mode {
+            nat,
+            route,
+            open,
+            bridge,
+            private_,
+            vepa,
+            passthrough,
+            hostdev,
+        };
+
+        struct Nat : public Node {
+            struct AddressRange : public Node {
+                [[nodiscard]] inline IpAddress start() const noexcept { return IpAddress{node->first_attribute("start")}; }
+                [[nodiscard]] inline IpAddress end() const noexcept { return IpAddress{node->first_attribute("end")}; }
+            };
+            struct PortRange : public Node {
+                [[nodiscard]] inline Integral start() const noexcept { return Integral{node->first_attribute("start")}; }
+                [[nodiscard]] inline Integral end() const noexcept { return Integral{node->first_attribute("end")}; }
+            };
+
+            [[nodiscard]] inline std::optional<bool> ipv6() const noexcept { return bool_wrap_attr<YesNo, Optional>(node, "ipv6"); }
+            [[nodiscard]] inline Optional<AddressRange> address() const noexcept { return AddressRange{node->first_node("address")}; }
+            [[nodiscard]] inline Optional<PortRange> port() const noexcept { return PortRange{node->first_node("port")}; }
+        };
+        struct Interface : public Node {
+            [[nodiscard]] inline String dev() const noexcept { return String{node->first_attribute("dev")}; }
+        };
+
+        /// Empty if the mode is unknown; an element without one forwards with NAT
+        [[nodiscard]] inline std::optional<Mode> mode() const noexcept {
+            const auto attr = node->first_attribute("mode");
+            return attr ? enum_cast_xml<Mode>({attr->value(), attr->value_size()}) : std::optional{Mode::nat};
+        }
+        [[nodiscard]] inline Optional<String> dev() const noexcept { return String{node->first_attribute("dev")}; }
+        [[nodiscard]] inline Optional<Nat> nat() const noexcept { return Nat{node->first_node("nat")}; }
+        [[nodiscard]] inline NamedSpan<Interface> interfaces() const noexcept { return NamedSpan<Interface>{"interface", node}; }
+        [[nodiscard]] inline Optional<Interface> pf() const noexcept { return Interface{node->first_node("pf")}; }
+    };
+
+    struct Bridge : public Node {
+        [[nodiscard]] inline Optional<String> name() const noexcept { return String{node->first_attribute("name")}; }
+        [[nodiscard]] inline std::optional<bool> stp() const noexcept { return bool_wrap_attr<OnOff, Optional>(node, "stp"); }
+        [[nodiscard]] inline Optional<Integral> delay() const noexcept { return Integral{node->first_attribute("delay")}; }
+        [[nodiscard]] inline std::optional<MacTableManager> mac_table_manager() const noexcept {
+            return enum_wrap_attr<MacTableManager, Optional>(node, "macTableManager");
+        }
+    };
+
+    struct Ip : public Node {
+        struct Dhcp : public Node {
+            struct Range : public Node {
+                [[nodiscard]] inline IpAddress start() const noexcept { return IpAddress{node->first_attribute("start")}; }
+                [[nodiscard]] inline IpAddress end() const noexcept { return IpAddress{node->first_attribute("end")}; }
+            };
+            /// A static lease, by MAC for IPv4 and by DHCP unique identifier for IPv6
+            struct Host : public Node {
+                [[nodiscard]] inline Optional<MacAddress> mac() const noexcept { return MacAddress{node->first_attribute("mac")}; }
+                [[nodiscard]] inline Optional<String> id() const noexcept { return String{node->first_attribute("id")}; }
+                [[nodiscard]] inline Optional<String> name() const noexcept { return String{node->first_attribute("name")}; }
+                [[nodiscard]] inline Optional<IpAddress> ip() const noexcept { return IpAddress{node->first_attribute("ip")}; }
+            };
+            struct Bootp : public Node {
+                [[nodiscard]] inline String file() const noexcept { return String{node->first_attribute("file")}; }
+                [[nodiscard]] inline Optional<String> server() const noexcept { return String{node->first_attribute("server")}; }
+            };
+
+            [[nodiscard]] inline NamedSpan<Range> ranges() const noexcept { return NamedSpan<Range>{"range", node}; }
+            [[nodiscard]] inline NamedSpan<Host> hosts() const noexcept { return NamedSpan<Host>{"host", node}; }
+            [[nodiscard]] inline Optional<Bootp> bootp() const noexcept { return Bootp{node->first_node("bootp")}; }
+        };
+
+        [[nodiscard]] inline Optional<IpAddress> address() const noexcept { return IpAddress{node->first_attribute("address")}; }
+        [[nodiscard]] inline Optional<String> family() const noexcept { return String{node->first_attribute("family")}; }
+        [[nodiscard]] inline Optional<IpAddress> netmask() const noexcept { return IpAddress{node->first_attribute("netmask")}; }
+        [[nodiscard]] inline Optional<Integral> prefix() const noexcept { return Integral{node->first_attribute("prefix")}; }
+        /// From `prefix`, or else from an IPv4 `netmask`; empty if neither is usable
+        [[nodiscard]] inline std::optional<unsigned> prefix_length() const noexcept {
+            if (const auto attr = prefix())
+                return static_cast<unsigned>(attr);
+            const auto mask = netmask() ? netmask().packed() : std::nullopt;
+            if (!mask || !is_ipv4_mapped(*mask))
+                return std::nullopt;
+            auto bits = static_cast<std::uint32_t>(*mask);
+            unsigned ret = 0;
+            for (; (bits & 0x80000000u) != 0; bits <<= 1u)
+                ++ret;
+            return bits == 0 ? std::optional{ret} : std::nullopt; // ones must be contiguous
+        }
+        [[nodiscard]] inline Optional<Dhcp> dhcp() const noexcept { return Dhcp{node->first_node("dhcp")}; }
+    };
+
+    [[nodiscard]] inline String name() const noexcept { return String{node->first_node("name")}; }
+    [[nodiscard]] inline Optional<Uuid> uuid() const noexcept { return Uuid{node->first_node("uuid")}; }
+    [[nodiscard]] inline std::optional<bool> ipv6() const noexcept { return bool_wrap_attr<YesNo, Optional>(node, "ipv6"); }
+    [[nodiscard]] inline Optional<Forward> forward() const noexcept { return Forward{node->first_node("forward")}; }
+    [[nodiscard]] inline Optional<Bridge> bridge() const noexcept { return Bridge{node->first_node("bridge")}; }
+    [[nodiscard]] inline Optional<MacAddress> mac() const noexcept {
+        const auto mac = node->first_node("mac");
+        return MacAddress{mac != nullptr ? mac->first_attribute("address") : nullptr};
+    }
+    [[nodiscard]] inline Optional<Integral> mtu() const noexcept {
+        const auto mtu = node->first_node("mtu");
+        return Integral{mtu != nullptr ? mtu->first_attribute("size") : nullptr};
+    }
+    [[nodiscard]] inline Optional<String> domain_name() const noexcept {
+        const auto domain = node->first_node("domain");
+        return String{domain != nullptr ? domain->first_attribute("name") : nullptr};
+    }
+    [[nodiscard]] inline NamedSpan<Ip> ips() const noexcept { return NamedSpan<Ip>{"ip", node}; }
+    [[nodiscard]] inline Optional<Bandwidth> bandwidth() const noexcept { return Bandwidth{node->first_node("bandwidth")}; }
+    [[nodiscard]] inline Optional<Vlan> vlan() const noexcept { return Vlan{node->first_node("vlan")}; }
+    [[nodiscard]] inline Optional<VirtualPort> virtualport() const noexcept { return VirtualPort{node->first_node("virtualport")}; }
+};
+
 } // namespace
 }
\ No newline at end of file
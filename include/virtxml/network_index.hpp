@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <rapidxml_ns.hpp>
+#include "network.hpp"
+#include "xmlval.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// A parsed <network> together with the text it was parsed from
+class NetworkDocument {
+    std::string text;
+    xml_document<> doc{};
+
+  public:
+    /// Parses `xml` in place; rapidxml reports malformed input by throwing rapidxml_ns::parse_error
+    explicit NetworkDocument(std::string xml) : text(std::move(xml)) { doc.parse<0>(text.data()); }
+    NetworkDocument(const NetworkDocument&) = delete;
+    NetworkDocument& operator=(const NetworkDocument&) = delete;
+
+    [[nodiscard]] inline Network network() const noexcept { return Network{doc.first_node("network")}; }
+};
+
+/// IPAM lookups over one network definition: static DHCP hosts hashed by MAC and by IP, and the subnets and DHCP ranges
+/// sorted by start so that the one holding an address is found by binary search
+/// Addresses are 128-bit, IPv4 in its IPv4-mapped form (see parse_ip_address); the index refers to the network's document
+class NetworkIndex {
+  public:
+    using Address = __uint128_t;
+    using Host = Network::Ip::Dhcp::Host;
+
+    struct Subnet {
+        Address first;
+        Address last;
+        Network::Ip ip;
+    };
+    struct Range {
+        Address start;
+        Address end;
+        Network::Ip::Dhcp::Range range;
+        const Subnet* subnet; // nullptr if the range is not inside the subnet of its <ip>
+    };
+
+    /// Inconsistencies found while indexing
+    struct Problems {
+        std::vector<std::uint64_t> duplicate_macs;
+        std::vector<Address> duplicate_ips;
+        std::vector<Host> hosts_outside_subnets;
+        std::vector<Network::Ip::Dhcp::Range> ranges_outside_subnets; // or unparsable
+        std::vector<std::pair<Network::Ip::Dhcp::Range, Network::Ip::Dhcp::Range>> overlapping_ranges;
+    };
+
+  private:
+    struct AddressHash {
+        [[nodiscard]] inline std::size_t operator()(Address address) const noexcept {
+            return std::hash<std::uint64_t>{}(static_cast<std::uint64_t>(address) ^ static_cast<std::uint64_t>(address >> 64u) * 0x9E3779B97F4A7C15u);
+        }
+    };
+
+    std::vector<Host> hosts;
+    std::unordered_map<std::uint64_t, std::uint32_t> by_mac;
+    std::unordered_map<Address, std::uint32_t, AddressHash> by_ip;
+    std::vector<Subnet> subnets; // sorted by first address
+    std::vector<Range> ranges;   // sorted by start
+    std::vector<std::uint32_t> reach; // for each range, the one ending last among it and those starting before it
+    Problems found;
+
+    /// Last element of `items` whose `key` is not above `address`, if `address` is within it
+    template <class T, class K, class L> [[nodiscard]] static const T* containing(const std::vector<T>& items, Address address, K key, L last) noexcept {
+        const auto it = std::upper_bound(items.begin(), items.end(), address, [&](Address a, const T& item) { return a < item.*key; });
+        if (it == items.begin())
+            return nullptr;
+        const auto& item = *std::prev(it);
+        return address <= item.*last ? &item : nullptr;
+    }
+
+  public:
+    explicit NetworkIndex(Network net) {
+        for (const auto ip : net.ips()) {
+            const auto address = ip.address() ? ip.address().packed() : std::nullopt;
+            const auto prefix = ip.prefix_length();
+            if (address && prefix) {
+                const auto bits = std::min(128u, *prefix + (is_ipv4_mapped(*address) ? 96u : 0u));
+                const auto host_mask = bits == 0 ? ~Address{0} : bits == 128 ? Address{0} : (Address{1} << (128u - bits)) - 1;
+                subnets.push_back(Subnet{*address & ~host_mask, *address | host_mask, ip});
+            }
+        }
+        std::sort(subnets.begin(), subnets.end(), [](const Subnet& lhs, const Subnet& rhs) { return lhs.first < rhs.first; });
+
+        for (const auto ip : net.ips()) {
+            const auto dhcp = ip.dhcp();
+            if (!dhcp)
+                continue;
+            for (const auto range : dhcp.ranges()) {
+                const auto start = range.start().packed();
+                const auto end = range.end().packed();
+                const auto subnet = start ? subnet_of(*start) : nullptr;
+                if (!start || !end || *end < *start || subnet == nullptr || *end > subnet->last) {
+                    found.ranges_outside_subnets.push_back(range);
+                    if (!start || !end || *end < *start)
+                        continue;
+                }
+                ranges.push_back(Range{*start, *end, range, subnet != nullptr && *end <= subnet->last ? subnet : nullptr});
+            }
+            for (const auto host : dhcp.hosts()) {
+                const auto index = static_cast<std::uint32_t>(hosts.size());
+                hosts.push_back(host);
+                if (const auto mac = host.mac() ? host.mac().packed() : std::nullopt)
+                    if (!by_mac.emplace(*mac, index).second)
+                        found.duplicate_macs.push_back(*mac);
+                if (const auto address = host.ip() ? host.ip().packed() : std::nullopt) {
+                    if (!by_ip.emplace(*address, index).second)
+                        found.duplicate_ips.push_back(*address);
+                    if (subnet_of(*address) == nullptr)
+                        found.hosts_outside_subnets.push_back(host);
+                }
+            }
+        }
+        std::sort(ranges.begin(), ranges.end(), [](const Range& lhs, const Range& rhs) { return lhs.start < rhs.start; });
+        reach.reserve(ranges.size());
+        for (std::uint32_t i = 0; i < ranges.size(); ++i) {
+            // Any earlier range reaching this one overlaps it; the one reaching furthest stands for them
+            if (i != 0 && ranges[i].start <= ranges[reach.back()].end) {
+                for (std::uint32_t j = 0; j < i; ++j)
+                    if (ranges[i].start <= ranges[j].end)
+                        found.overlapping_ranges.emplace_back(ranges[j].range, ranges[i].range);
+            }
+            reach.push_back(i == 0 || ranges[i].end > ranges[reach.back()].end ? i : reach.back());
+        }
+    }
+
+    /// The static host for `mac` (see parse_mac_address), or a null view
+    [[nodiscard]] inline Host host_by_mac(std::uint64_t mac) const noexcept {
+        const auto it = by_mac.find(mac);
+        return it != by_mac.end() ? hosts[it->second] : Host{nullptr};
+    }
+    /// The static host for `address`, or a null view
+    [[nodiscard]] inline Host host_by_ip(Address address) const noexcept {
+        const auto it = by_ip.find(address);
+        return it != by_ip.end() ? hosts[it->second] : Host{nullptr};
+    }
+    /// The subnet of an <ip> element holding `address`, or nullptr
+    [[nodiscard]] inline const Subnet* subnet_of(Address address) const noexcept { return containing(subnets, address, &Subnet::first, &Subnet::last); }
+    /// A DHCP range holding `address`, or nullptr; with overlapping ranges, the one ending last among those starting at or before it
+    [[nodiscard]] inline const Range* range_of(Address address) const noexcept {
+        const auto it = std::upper_bound(ranges.begin(), ranges.end(), address, [](Address a, const Range& range) { return a < range.start; });
+        if (it == ranges.begin())
+            return nullptr;
+        const auto& range = ranges[reach[static_cast<std::size_t>(it - ranges.begin()) - 1]];
+        return address <= range.end ? &range : nullptr;
+    }
+    /// Whether `address` can be given out statically: inside a subnet, neither its network, broadcast nor own address,
+    /// and neither a static host's nor within a DHCP range
+    [[nodiscard]] inline bool is_free(Address address) const noexcept {
+        const auto subnet = subnet_of(address);
+        if (subnet == nullptr || address == subnet->first || by_ip.count(address) != 0 || range_of(address) != nullptr)
+            return false;
+        if (is_ipv4_mapped(address) && address == subnet->last && subnet->last != subnet->first + 1)
+            return false;
+        const auto own = subnet->ip.address().packed();
+        return !own || *own != address;
+    }
+
+    [[nodiscard]] inline std::size_t host_count() const noexcept { return hosts.size(); }
+    [[nodiscard]] inline const std::vector<Subnet>& subnet_list() const noexcept { return subnets; }
+    [[nodiscard]] inline const std::vector<Range>& range_list() const noexcept { return ranges; }
+    [[nodiscard]] inline const Problems& problems() const noexcept { return found; }
+    [[nodiscard]] inline bool consistent() const noexcept {
+        return found.duplicate_macs.empty() && found.duplicate_ips.empty() && found.hosts_outside_subnets.empty() && found.ranges_outside_subnets.empty() &&
+               found.overlapping_ranges.empty();
+    }
+};
+
+} // namespace
+} // namespace virtxml
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <rapidxml_ns.hpp>
+
+namespace virtxml {
+using namespace rapidxml_ns;
+
+class NodeRef;
+
+/// Element trees laid out as flat records linked by 32-bit indices, with strings referred to by 32-bit offsets
+/// A tree holds no pointer, so it can be written to a file or a shared memory segment and read in place wherever it is mapped;
+/// snapshots, shared snapshots and frozen documents are such trees, and views read them through NodeRef like rapidxml nodes
+/// Only elements are kept, with their values and attributes, not text or comment nodes
+namespace records {
+constexpr std::uint32_t none = ~std::uint32_t{0};
+
+struct StrRef {
+    std::uint32_t offset; // into the string table, where the string is followed by a NUL
+    std::uint32_t size;
+};
+/// What elements and attributes have in common, first in both
+struct Item {
+    StrRef name;
+    StrRef value;
+};
+/// Elements are in document order: a parent comes before its children, and a child before its next sibling
+struct Element : Item {
+    std::uint32_t parent; // `none` for a root
+    std::uint32_t first_child;
+    std::uint32_t next_sibling;
+    std::uint32_t first_attribute;
+    std::uint32_t attribute_count;
+};
+struct Attribute : Item {};
+static_assert(sizeof(Element) == 36 && sizeof(Attribute) == 16 && alignof(Element) == 4 && alignof(Attribute) == 4);
+static_assert(std::is_trivially_copyable_v<Element> && std::is_trivially_copyable_v<Attribute>, "records are copied and mapped as bytes");
+
+/// Where the records of a tree are; it must outlive the NodeRefs into the tree, which point to it
+struct Tree {
+    const Element* elements = nullptr;
+    const Attribute* attributes = nullptr;
+    const char* strings = nullptr;
+    const char* const* interned = nullptr; // if set, string offsets are indices into it instead of offsets into `strings`
+
+    [[nodiscard]] inline const char* text(StrRef ref) const noexcept { return interned != nullptr ? interned[ref.offset] : strings + ref.offset; }
+    [[nodiscard]] inline bool named(const Item& item, const char* name, std::size_t name_size) const noexcept {
+        return name == nullptr || (item.name.size == name_size && std::memcmp(text(item.name), name, name_size) == 0);
+    }
+};
+
+/// Whether records read from an untrusted source form trees that NodeRef can walk without leaving them
+/// Links must point forward in document order and agree with the parents, which rules out cycles; every string must be NUL-terminated
+[[nodiscard]] inline bool valid(const Element* elements, std::uint32_t element_count, const Attribute* attributes, std::uint32_t attribute_count,
+                                const char* strings, std::uint32_t strings_size) noexcept {
+    const auto valid_string = [&](StrRef ref) {
+        return ref.offset < strings_size && ref.size < strings_size - ref.offset && strings[ref.offset + ref.size] == '\0';
+    };
+    for (std::uint32_t i = 0; i < element_count; ++i) {
+        const auto& el = elements[i];
+        if ((el.parent != none && el.parent >= i) || !valid_string(el.name) || !valid_string(el.value))
+            return false;
+        if (el.first_child != none && (el.first_child <= i || el.first_child >= element_count || elements[el.first_child].parent != i))
+            return false;
+        if (el.next_sibling != none && (el.next_sibling <= i || el.next_sibling >= element_count || el.parent == none ||
+                                        elements[el.next_sibling].parent != el.parent))
+            return false;
+        if (el.first_attribute > attribute_count || el.attribute_count > attribute_count - el.first_attribute)
+            return false;
+    }
+    for (std::uint32_t i = 0; i < attribute_count; ++i)
+        if (!valid_string(attributes[i].name) || !valid_string(attributes[i].value))
+            return false;
+    return true;
+}
+
+/// Lays out element subtrees as records, each distinct string stored once across all of them
+struct Builder {
+    std::vector<Element> elements{};
+    std::vector<Attribute> attributes{};
+    std::string strings{};
+    std::unordered_map<std::string, StrRef> offsets{};
+
+    [[nodiscard]] StrRef intern(const char* str, std::size_t size) {
+        const auto [it, added] = offsets.try_emplace(std::string{str, size});
+        if (added) {
+            it->second = StrRef{static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(size)};
+            strings.append(str, size).push_back('\0');
+        }
+        return it->second;
+    }
+
+    /// Appends the subtree of `element`, whose records then follow all those added before; returns the index of its record
+    std::uint32_t add(NodeRef element, std::uint32_t parent = none);
+
+    [[nodiscard]] inline Tree tree() const noexcept { return Tree{elements.data(), attributes.data(), strings.data()}; }
+};
+} // namespace records
+
+/// An attribute, either of a rapidxml node or of an element record; used like an xml_attribute<> pointer
+class AttributeRef {
+    friend NodeRef;
+    friend class ValueRef;
+
+    const void* ptr = nullptr;             // the xml_base<> of a rapidxml attribute, or the records::Item of a record
+    const records::Tree* tree = nullptr;   // null for rapidxml attributes
+    const records::Attribute* end = nullptr; // past the attributes of the record's element
+
+    constexpr AttributeRef(const records::Tree* tree, const records::Attribute* attr, const records::Attribute* end) noexcept
+        : ptr(static_cast<const records::Item*>(attr)), tree(tree), end(end) {}
+    [[nodiscard]] inline const records::Attribute* record() const noexcept {
+        return static_cast<const records::Attribute*>(static_cast<const records::Item*>(ptr));
+    }
+    [[nodiscard]] static AttributeRef find(const records::Tree* tree, const records::Attribute* from, const records::Attribute* end, const char* name,
+                                           std::size_t name_size) noexcept {
+        if (name != nullptr && name_size == 0)
+            name_size = std::strlen(name);
+        for (; from < end; ++from)
+            if (tree->named(*from, name, name_size))
+                return AttributeRef{tree, from, end};
+        return {};
+    }
+
+  public:
+    constexpr AttributeRef() noexcept = default;
+    constexpr AttributeRef(std::nullptr_t) noexcept {}
+    constexpr AttributeRef(xml_attribute<>* attr) noexcept : ptr(static_cast<xml_base<>*>(attr)) {}
+
+    constexpr const AttributeRef* operator->() const noexcept { return this; }
+    constexpr explicit operator bool() const noexcept { return ptr != nullptr; }
+    friend constexpr bool operator==(const AttributeRef& lhs, const AttributeRef& rhs) noexcept { return lhs.ptr == rhs.ptr; }
+    friend constexpr bool operator!=(const AttributeRef& lhs, const AttributeRef& rhs) noexcept { return lhs.ptr != rhs.ptr; }
+
+    /// The rapidxml attribute, nullptr for a record
+    [[nodiscard]] inline xml_attribute<>* xml() const noexcept {
+        return tree == nullptr ? static_cast<xml_attribute<>*>(static_cast<xml_base<>*>(const_cast<void*>(ptr))) : nullptr;
+    }
+
+    [[nodiscard]] inline const char* name() const noexcept { return tree == nullptr ? xml()->name() : tree->text(record()->name); }
+    [[nodiscard]] inline std::size_t name_size() const noexcept { return tree == nullptr ? xml()->name_size() : record()->name.size; }
+    [[nodiscard]] inline const char* value() const noexcept { return tree == nullptr ? xml()->value() : tree->text(record()->value); }
+    [[nodiscard]] inline std::size_t value_size() const noexcept { return tree == nullptr ? xml()->value_size() : record()->value.size; }
+    [[nodiscard]] inline AttributeRef next_attribute(const char* name = nullptr, std::size_t name_size = 0) const noexcept {
+        return tree == nullptr ? AttributeRef{xml()->next_attribute(name, name_size)} : find(tree, record() + 1, end, name, name_size);
+    }
+};
+
+/// An element, either a rapidxml node or a record of a records::Tree; the handle views are bound to, used like an xml_node<> pointer
+/// Records are walked through their links in place, and only support reading
+class NodeRef {
+    friend class ValueRef;
+
+    const void* ptr = nullptr;           // the xml_base<> of a rapidxml node, or the records::Item of a record
+    const records::Tree* tree = nullptr; // null for rapidxml nodes
+
+    [[nodiscard]] inline const records::Element* element() const noexcept {
+        return static_cast<const records::Element*>(static_cast<const records::Item*>(ptr));
+    }
+    [[nodiscard]] inline NodeRef find(std::uint32_t from, const char* name, std::size_t name_size) const noexcept {
+        if (name != nullptr && name_size == 0)
+            name_size = std::strlen(name);
+        for (; from != records::none; from = tree->elements[from].next_sibling)
+            if (tree->named(tree->elements[from], name, name_size))
+                return NodeRef{*tree, from};
+        return {};
+    }
+
+  public:
+    constexpr NodeRef() noexcept = default;
+    constexpr NodeRef(std::nullptr_t) noexcept {}
+    constexpr NodeRef(xml_node<>* node) noexcept : ptr(static_cast<xml_base<>*>(node)) {}
+    /// Element `index` of `tree`, null for records::none
+    constexpr NodeRef(const records::Tree& tree, std::uint32_t index) noexcept
+        : ptr(index != records::none ? static_cast<const records::Item*>(tree.elements + index) : nullptr),
+          tree(index != records::none ? &tree : nullptr) {}
+
+    constexpr const NodeRef* operator->() const noexcept { return this; }
+    constexpr explicit operator bool() const noexcept { return ptr != nullptr; }
+    friend constexpr bool operator==(const NodeRef& lhs, const NodeRef& rhs) noexcept { return lhs.ptr == rhs.ptr; }
+    friend constexpr bool operator!=(const NodeRef& lhs, const NodeRef& rhs) noexcept { return lhs.ptr != rhs.ptr; }
+
+    /// The rapidxml node, nullptr for a record
+    [[nodiscard]] inline xml_node<>* xml() const noexcept {
+        return tree == nullptr ? static_cast<xml_node<>*>(static_cast<xml_base<>*>(const_cast<void*>(ptr))) : nullptr;
+    }
+    /// The tree of a record, nullptr for a rapidxml node
+    [[nodiscard]] constexpr const records::Tree* owner() const noexcept { return tree; }
+    /// Index of a record within its tree
+    [[nodiscard]] inline std::uint32_t index() const noexcept { return static_cast<std::uint32_t>(element() - tree->elements); }
+
+    [[nodiscard]] inline node_type type() const noexcept { return tree == nullptr ? xml()->type() : node_element; }
+    [[nodiscard]] inline const char* name() const noexcept { return tree == nullptr ? xml()->name() : tree->text(element()->name); }
+    [[nodiscard]] inline std::size_t name_size() const noexcept { return tree == nullptr ? xml()->name_size() : element()->name.size; }
+    [[nodiscard]] inline const char* value() const noexcept { return tree == nullptr ? xml()->value() : tree->text(element()->value); }
+    [[nodiscard]] inline std::size_t value_size() const noexcept { return tree == nullptr ? xml()->value_size() : element()->value.size; }
+
+    /// The parent; the root record of a tree has none, whereas a rapidxml root element has its document
+    [[nodiscard]] inline NodeRef parent() const noexcept { return tree == nullptr ? NodeRef{xml()->parent()} : NodeRef{*tree, element()->parent}; }
+    [[nodiscard]] inline NodeRef first_node(const char* name = nullptr, std::size_t name_size = 0) const noexcept {
+        return tree == nullptr ? NodeRef{xml()->first_node(name, name_size)} : find(element()->first_child, name, name_size);
+    }
+    [[nodiscard]] inline NodeRef next_sibling(const char* name = nullptr, std::size_t name_size = 0) const noexcept {
+        return tree == nullptr ? NodeRef{xml()->next_sibling(name, name_size)} : find(element()->next_sibling, name, name_size);
+    }
+    /// Records only link forward, so going backward walks the children of the parent from the first one
+    [[nodiscard]] NodeRef last_node(const char* name = nullptr, std::size_t name_size = 0) const noexcept {
+        if (tree == nullptr)
+            return xml()->last_node(name, name_size);
+        NodeRef ret;
+        for (auto child = first_node(name, name_size); child; child = child.next_sibling(name, name_size))
+            ret = child;
+        return ret;
+    }
+    [[nodiscard]] NodeRef previous_sibling(const char* name = nullptr, std::size_t name_size = 0) const noexcept {
+        if (tree == nullptr)
+            return xml()->previous_sibling(name, name_size);
+        NodeRef ret;
+        if (element()->parent == records::none)
+            return ret;
+        for (auto sibling = parent().first_node(name, name_size); sibling && sibling != *this; sibling = sibling.next_sibling(name, name_size))
+            ret = sibling;
+        return ret;
+    }
+
+    [[nodiscard]] inline AttributeRef first_attribute(const char* name = nullptr, std::size_t name_size = 0) const noexcept {
+        if (tree == nullptr)
+            return xml()->first_attribute(name, name_size);
+        const auto first = tree->attributes + element()->first_attribute;
+        return AttributeRef::find(tree, first, first + element()->attribute_count, name, name_size);
+    }
+};
+
+/// The element or attribute whose value a String, an Integral or another Value reads
+class ValueRef {
+    const void* ptr = nullptr;
+    const records::Tree* tree = nullptr;
+
+    [[nodiscard]] inline const xml_base<>* base() const noexcept { return static_cast<const xml_base<>*>(ptr); }
+    [[nodiscard]] inline const records::Item* item() const noexcept { return static_cast<const records::Item*>(ptr); }
+
+  public:
+    constexpr ValueRef() noexcept = default;
+    constexpr ValueRef(std::nullptr_t) noexcept {}
+    constexpr ValueRef(xml_base<>* item) noexcept : ptr(item) {}
+    constexpr ValueRef(NodeRef node) noexcept : ptr(node.ptr), tree(node.tree) {}
+    constexpr ValueRef(AttributeRef attr) noexcept : ptr(attr.ptr), tree(attr.tree) {}
+
+    constexpr const ValueRef* operator->() const noexcept { return this; }
+    constexpr explicit operator bool() const noexcept { return ptr != nullptr; }
+    friend constexpr bool operator==(const ValueRef& lhs, const ValueRef& rhs) noexcept { return lhs.ptr == rhs.ptr; }
+    friend constexpr bool operator!=(const ValueRef& lhs, const ValueRef& rhs) noexcept { return lhs.ptr != rhs.ptr; }
+
+    [[nodiscard]] inline const char* value() const noexcept { return tree == nullptr ? base()->value() : tree->text(item()->value); }
+    [[nodiscard]] inline std::size_t value_size() const noexcept { return tree == nullptr ? base()->value_size() : item()->value.size; }
+    /// The element, when the value is that of an element and not of an attribute
+    [[nodiscard]] inline NodeRef node() const noexcept {
+        if (tree == nullptr)
+            return static_cast<xml_node<>*>(static_cast<xml_base<>*>(const_cast<void*>(ptr)));
+        return NodeRef{*tree, static_cast<std::uint32_t>(static_cast<const records::Element*>(item()) - tree->elements)};
+    }
+};
+
+inline std::uint32_t records::Builder::add(NodeRef element, std::uint32_t parent) {
+    const auto idx = static_cast<std::uint32_t>(elements.size());
+    elements.push_back(Element{{intern(element->name(), element->name_size()), intern(element->value(), element->value_size())},
+                               parent, none, none, static_cast<std::uint32_t>(attributes.size()), 0});
+    for (auto attr = element->first_attribute(); attr; attr = attr->next_attribute()) {
+        attributes.push_back(Attribute{{intern(attr->name(), attr->name_size()), intern(attr->value(), attr->value_size())}});
+        ++elements[idx].attribute_count;
+    }
+    auto last = none;
+    for (auto child = element->first_node(); child; child = child->next_sibling()) {
+        if (child->type() != node_element)
+            continue;
+        const auto child_idx = add(child, idx);
+        (last == none ? elements[idx].first_child : elements[last].next_sibling) = child_idx;
+        last = child_idx;
+    }
+    return idx;
+}
+
+} // namespace virtxml
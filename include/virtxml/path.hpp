@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <rapidxml_ns.hpp>
+#include "generic.hpp"
+#include "xmlval.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Element path into a document, parsed at compile time when declared constexpr
+/// Syntax: "step/step/...[@attribute]" where a step is "name" or "name[n]", n counting from 1 as in XPath
+/// "devices/disk[2]/source@file" is the file of the second disk; "@type" is an attribute of the root itself
+template <std::size_t MaxSteps> struct Path {
+    struct Step {
+        std::string_view name;
+        unsigned index = 0; // 0-based
+    };
+
+    std::array<Step, MaxSteps> steps{};
+    std::size_t count = 0;
+    std::string_view attribute;
+    std::uint64_t hash = 0xcbf29ce484222325u; // FNV-1a of the whole path, a stable identity for caches keyed by path
+    bool valid = true;
+
+    constexpr explicit Path(std::string_view path) noexcept {
+        for (const auto c : path)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3u;
+        const auto at = path.find('@');
+        if (at != std::string_view::npos) {
+            attribute = path.substr(at + 1);
+            valid = !attribute.empty() && attribute.find_first_of("/@[]") == std::string_view::npos;
+            path = path.substr(0, at);
+        }
+        while (!path.empty() && valid) {
+            const auto slash = path.find('/');
+            auto step = path.substr(0, slash);
+            path = slash == std::string_view::npos ? std::string_view{} : path.substr(slash + 1);
+            if (step.empty() || count == MaxSteps) {
+                valid = false;
+                break;
+            }
+            unsigned index = 0;
+            if (const auto bracket = step.find('['); bracket != std::string_view::npos) {
+                auto digits = step.substr(bracket + 1);
+                valid = digits.size() > 1 && digits.back() == ']';
+                digits.remove_suffix(1);
+                for (const auto c : digits) {
+                    valid = valid && c >= '0' && c <= '9';
+                    index = index * 10 + static_cast<unsigned>(c - '0');
+                }
+                valid = valid && index != 0;
+                --index;
+                step = step.substr(0, bracket);
+            }
+            valid = valid && !step.empty();
+            steps[count++] = Step{step, index};
+        }
+    }
+
+    /// Element the path leads to from `node`, in one walk without intermediate views; nullptr if any step is missing or the path is malformed
+    [[nodiscard]] inline NodeRef resolve(NodeRef node) const noexcept {
+        if (!valid)
+            return nullptr;
+        for (std::size_t i = 0; i < count && node != nullptr; ++i) {
+            const auto& step = steps[i];
+            node = node->first_node(step.name.data(), step.name.size());
+            for (auto skip = step.index; skip != 0 && node != nullptr; --skip)
+                node = node->next_sibling(step.name.data(), step.name.size());
+        }
+        return node;
+    }
+
+    /// Attribute value, or element text when the path names no attribute
+    [[nodiscard]] inline std::optional<std::string_view> value(NodeRef root) const noexcept {
+        const auto node = resolve(root);
+        if (node == nullptr)
+            return std::nullopt;
+        if (attribute.empty())
+            return std::string_view{node->value(), node->value_size()};
+        const auto attr = node->first_attribute(attribute.data(), attribute.size());
+        return attr != nullptr ? std::optional{std::string_view{attr->value(), attr->value_size()}} : std::nullopt;
+    }
+};
+
+template <std::size_t N> [[nodiscard]] constexpr Path<N / 2 + 1> make_path(const char (&path)[N]) noexcept {
+    return Path<N / 2 + 1>{std::string_view{path, N - 1}};
+}
+
+namespace impl {
+template <class T> [[nodiscard]] std::optional<T> convert_path_value(std::optional<std::string_view> str) noexcept {
+    if constexpr (std::is_same_v<T, std::string_view>) {
+        return str;
+    } else {
+        static_assert(std::is_integral_v<T>, "T must be std::string_view or an integral type");
+        if (!str || str->empty())
+            return std::nullopt;
+        const auto base = integer_base(*str);
+        // Values point into the parsed buffer, where an attribute or text is always followed by a non-digit
+        char* end = nullptr;
+        errno = 0;
+        if constexpr (std::is_signed_v<T>) {
+            const auto ret = std::strtoll(str->data(), &end, base);
+            if (end != str->data() + str->size() || errno == ERANGE || ret < std::numeric_limits<T>::min() || ret > std::numeric_limits<T>::max())
+                return std::nullopt;
+            return static_cast<T>(ret);
+        } else {
+            // strtoull would wrap a negative value around
+            const auto sign = str->find_first_not_of(" \t\r\n");
+            if (sign != std::string_view::npos && (*str)[sign] == '-')
+                return std::nullopt;
+            const auto ret = std::strtoull(str->data(), &end, base);
+            if (end != str->data() + str->size() || errno == ERANGE || ret > std::numeric_limits<T>::max())
+                return std::nullopt;
+            return static_cast<T>(ret);
+        }
+    }
+}
+} // namespace impl
+
+/// Value at `path` below `view`, as a string or parsed as an integer (decimal or 0x-prefixed); nothing if the path is malformed
+template <class T = std::string_view, class View, std::size_t N>
+[[nodiscard]] std::optional<T> get(const View& view, const Path<N>& path) noexcept {
+    return impl::convert_path_value<T>(path.value(NodeAccess::of(view)));
+}
+
+/// View of type `V` bound to the element at `path` below `view`, null if absent or if the path is malformed
+template <class V, class View, std::size_t N> [[nodiscard]] V at(const View& view, const Path<N>& path) noexcept {
+    return V{path.resolve(NodeAccess::of(view))};
+}
+
+#if __cpp_nontype_template_args >= 201911L
+template <std::size_t N> struct PathLiteral {
+    char str[N];
+    constexpr PathLiteral(const char (&path)[N]) noexcept {
+        for (std::size_t i = 0; i < N; ++i)
+            str[i] = path[i];
+    }
+};
+
+/// `get<"devices/disk[2]/source@file">(dom)`; the path is checked when the call is compiled
+template <PathLiteral P, class T = std::string_view, class View> [[nodiscard]] std::optional<T> get(const View& view) noexcept {
+    static constexpr auto path = make_path(P.str);
+    static_assert(path.valid, "malformed path");
+    return get<T>(view, path);
+}
+template <PathLiteral P, class V, class View> [[nodiscard]] V at(const View& view) noexcept {
+    static constexpr auto path = make_path(P.str);
+    static_assert(path.valid, "malformed path");
+    return at<V>(view, path);
+}
+template <PathLiteral P> constexpr std::uint64_t path_id = make_path(P.str).hash;
+#endif
+
+} // namespace
+} // namespace virtxml
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <rapidxml_ns.hpp>
+#include "generic.hpp"
+#include "schema.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Incremental parser fed with arbitrary chunks of a document, e.g. as they arrive on the libvirt RPC stream
+/// Every complete markup token is turned into nodes as soon as it is received, so the document is ready right after the last chunk
+/// All state lives in the object: a coroutine can feed() between two co_awaits of its reads, on any thread
+/// Produces the same tree as parse<0> minus comments, processing instructions and the DOCTYPE; strings live in the document's pool
+class PushParser {
+  public:
+    enum class Status {
+        need_more, // the root element is not closed yet
+        complete,  // the root element is closed; only trailing comments or whitespace may follow
+        error,
+    };
+
+  private:
+    xml_document<> doc{};
+    std::string buf;      // unconsumed input: the partial token at the end of the previous chunk, then the new chunk
+    std::size_t pos = 0;  // start of the current token in buf
+    std::size_t scan = 0; // how far past pos the current token was already searched
+    char quote = 0;       // quote character open at `scan`, while searching for the end of a start tag
+    std::vector<xml_node<>*> open;
+    bool root_closed = false;
+    Status status = Status::need_more;
+    std::string message;
+    std::uint64_t consumed = 0; // bytes dropped from the front of buf, for error offsets
+    std::string scratch;
+    SchemaValidator* validator = nullptr;
+
+    Status fail(std::string_view what) {
+        message.assign(what).append(" at byte ").append(std::to_string(consumed + pos));
+        return status = Status::error;
+    }
+
+    [[nodiscard]] char* store(std::string_view str) {
+        const auto ret = doc.allocate_string(nullptr, str.size() + 1);
+        std::memcpy(ret, str.data(), str.size());
+        ret[str.size()] = '\0';
+        return ret;
+    }
+
+    [[nodiscard]] static bool is_space(char c) noexcept { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+    /// Decodes the predefined and numeric character references of `raw` into `scratch`
+    /// Like parse<0>, any other entity (e.g. `&nbsp;`) or a lone '&' is kept verbatim; only malformed numeric references fail
+    [[nodiscard]] bool decode(std::string_view raw) {
+        static constexpr std::pair<std::string_view, char> predefined[] = {{"lt;", '<'}, {"gt;", '>'}, {"amp;", '&'}, {"quot;", '"'}, {"apos;", '\''}};
+        scratch.clear();
+        for (std::size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] != '&') {
+                scratch.push_back(raw[i]);
+                continue;
+            }
+            const auto rest = raw.substr(i + 1);
+            if (rest.empty() || rest[0] != '#') {
+                const auto it = std::find_if(std::begin(predefined), std::end(predefined),
+                                             [&](const auto& entity) { return rest.substr(0, entity.first.size()) == entity.first; });
+                if (it == std::end(predefined)) {
+                    scratch.push_back('&');
+                    continue;
+                }
+                scratch.push_back(it->second);
+                i += it->first.size();
+                continue;
+            }
+            const auto semi = raw.find(';', i);
+            if (semi == std::string_view::npos)
+                return false;
+            const auto ref = raw.substr(i + 1, semi - i - 1);
+            i = semi;
+            const bool hex = ref.size() > 1 && ref[1] == 'x';
+            if (ref.size() == (hex ? 2u : 1u))
+                return false;
+            unsigned long code = 0;
+            for (const auto c : ref.substr(hex ? 2 : 1)) {
+                const unsigned digit = c >= '0' && c <= '9' ? c - '0' : hex && c >= 'a' && c <= 'f' ? c - 'a' + 10 : hex && c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+                if (digit >= (hex ? 16u : 10u) || code > 0x10FFFF)
+                    return false;
+                code = code * (hex ? 16 : 10) + digit;
+            }
+            if (code > 0x10FFFF)
+                return false;
+            // UTF-8
+            if (code < 0x80) {
+                scratch.push_back(static_cast<char>(code));
+            } else if (code < 0x800) {
+                scratch.push_back(static_cast<char>(0xC0 | code >> 6));
+                scratch.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            } else if (code < 0x10000) {
+                scratch.push_back(static_cast<char>(0xE0 | code >> 12));
+                scratch.push_back(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+                scratch.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            } else {
+                scratch.push_back(static_cast<char>(0xF0 | code >> 18));
+                scratch.push_back(static_cast<char>(0x80 | (code >> 12 & 0x3F)));
+                scratch.push_back(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+                scratch.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+        }
+        return true;
+    }
+
+    /// Position of `terminator` at or after the resumed scan, or npos after recording how far the search went
+    [[nodiscard]] std::size_t find_end(std::string_view terminator, std::size_t from) {
+        const auto at = buf.find(terminator, pos + std::max(scan, from));
+        if (at == std::string::npos)
+            scan = std::max(from, buf.size() - pos >= terminator.size() ? buf.size() - pos - terminator.size() + 1 : 0);
+        return at;
+    }
+
+    [[nodiscard]] bool text(std::string_view raw) {
+        if (open.empty()) {
+            for (const auto c : raw)
+                if (!is_space(c))
+                    return false;
+            return true;
+        }
+        if (!decode(raw))
+            return false;
+        const auto value = store(scratch);
+        const auto parent = open.back();
+        parent->append_node(doc.allocate_node(node_data, nullptr, value, 0, scratch.size()));
+        if (parent->value_size() == 0)
+            parent->value(value, scratch.size());
+        return true;
+    }
+
+    [[nodiscard]] bool start_tag(std::string_view tag) { // between '<' and '>'
+        const bool self_closing = !tag.empty() && tag.back() == '/';
+        if (self_closing)
+            tag.remove_suffix(1);
+        std::size_t i = 0;
+        while (i < tag.size() && !is_space(tag[i]))
+            ++i;
+        if (i == 0 || root_closed)
+            return false;
+        const auto element = doc.allocate_node(node_element, store(tag.substr(0, i)), nullptr, i);
+        while (true) {
+            while (i < tag.size() && is_space(tag[i]))
+                ++i;
+            if (i == tag.size())
+                break;
+            const auto name_start = i;
+            while (i < tag.size() && tag[i] != '=' && !is_space(tag[i]))
+                ++i;
+            const auto name = tag.substr(name_start, i - name_start);
+            while (i < tag.size() && is_space(tag[i]))
+                ++i;
+            if (name.empty() || i == tag.size() || tag[i] != '=')
+                return false;
+            ++i;
+            while (i < tag.size() && is_space(tag[i]))
+                ++i;
+            if (i == tag.size() || (tag[i] != '"' && tag[i] != '\''))
+                return false;
+            const auto close = tag.find(tag[i], i + 1);
+            if (close == std::string_view::npos || !decode(tag.substr(i + 1, close - i - 1)))
+                return false;
+            element->append_attribute(doc.allocate_attribute(store(name), store(scratch), name.size(), scratch.size()));
+            i = close + 1;
+        }
+        (open.empty() ? static_cast<xml_node<>*>(&doc) : open.back())->append_node(element);
+        if (validator != nullptr && validator->enter(element) && self_closing)
+            validator->leave(element);
+        if (self_closing)
+            root_closed = root_closed || open.empty();
+        else
+            open.push_back(element);
+        return true;
+    }
+
+    [[nodiscard]] bool end_tag(std::string_view tag) { // between "</" and '>'
+        while (!tag.empty() && is_space(tag.back()))
+            tag.remove_suffix(1);
+        if (open.empty() || tag != std::string_view{open.back()->name(), open.back()->name_size()})
+            return false;
+        if (validator != nullptr)
+            validator->leave(open.back());
+        open.pop_back();
+        root_closed = open.empty();
+        return true;
+    }
+
+    /// Consumes complete tokens from buf; false when the rest needs more input or is malformed (status tells which)
+    [[nodiscard]] bool step() {
+        const std::string_view rest{buf.data() + pos, buf.size() - pos};
+        if (rest.empty())
+            return false;
+        if (rest.front() != '<') {
+            const auto lt = rest.find('<');
+            if (lt == std::string_view::npos && !open.empty())
+                return false; // the text may go on
+            const auto raw = rest.substr(0, lt);
+            if (!text(raw))
+                return fail("malformed text"), false;
+            pos += raw.size();
+            return true;
+        }
+        const auto starts = [rest](std::string_view prefix) { return rest.substr(0, prefix.size()) == prefix; };
+        const auto maybe = [rest](std::string_view prefix) { return rest.size() < prefix.size() && prefix.substr(0, rest.size()) == rest; };
+        if (maybe("<!--") || maybe("<![CDATA[") || maybe("<!DOCTYPE") || rest.size() < 2)
+            return false;
+
+        std::size_t end;
+        if (starts("<!--")) {
+            if ((end = find_end("-->", 4)) == std::string::npos)
+                return false;
+            end += 3;
+        } else if (starts("<![CDATA[")) {
+            if ((end = find_end("]]>", 9)) == std::string::npos)
+                return false;
+            if (open.empty())
+                return fail("CDATA outside the root element"), false;
+            const auto value = std::string_view{buf.data() + pos + 9, end - pos - 9};
+            open.back()->append_node(doc.allocate_node(node_cdata, nullptr, store(value), 0, value.size()));
+            end += 3;
+        } else if (starts("<!DOCTYPE")) {
+            const auto bracket = rest.find('[');
+            const auto gt = rest.find('>');
+            if (gt == std::string_view::npos && bracket == std::string_view::npos)
+                return scan = rest.size(), false;
+            if (bracket != std::string_view::npos && (gt == std::string_view::npos || bracket < gt)) {
+                if ((end = find_end("]>", bracket)) == std::string::npos)
+                    return false;
+                end += 2;
+            } else {
+                end = pos + gt + 1;
+            }
+        } else if (starts("<?")) {
+            if ((end = find_end("?>", 2)) == std::string::npos)
+                return false;
+            end += 2;
+        } else if (starts("</")) {
+            if ((end = find_end(">", 2)) == std::string::npos)
+                return false;
+            if (!end_tag(std::string_view{buf.data() + pos + 2, end - pos - 2}))
+                return fail("mismatched end tag"), false;
+            end += 1;
+        } else {
+            // Start tag: '>' may appear inside quoted attribute values
+            auto i = std::max<std::size_t>(scan, 1);
+            for (; i < rest.size(); ++i) {
+                const auto c = rest[i];
+                if (quote != 0) {
+                    if (c == quote)
+                        quote = 0;
+                } else if (c == '"' || c == '\'') {
+                    quote = c;
+                } else if (c == '>') {
+                    break;
+                }
+            }
+            if (i == rest.size())
+                return scan = i, false;
+            if (!start_tag(rest.substr(1, i - 1)))
+                return fail("malformed start tag"), false;
+            end = pos + i + 1;
+        }
+        if (validator != nullptr && !validator->ok())
+            return fail("document does not match the schema"), false;
+        pos = end;
+        scan = 0;
+        quote = 0;
+        return true;
+    }
+
+  public:
+    PushParser() = default;
+    PushParser(const PushParser&) = delete;
+    PushParser& operator=(const PushParser&) = delete;
+
+    /// Parses whatever complete tokens `chunk` closes; the chunk may end anywhere, even inside a tag or a character reference
+    Status feed(std::string_view chunk) {
+        if (status == Status::error)
+            return status;
+        buf.append(chunk);
+        while (step())
+            ;
+        if (status == Status::error)
+            return status;
+        consumed += pos;
+        buf.erase(0, pos);
+        pos = 0;
+        return status = root_closed ? Status::complete : Status::need_more;
+    }
+
+    /// Signals the end of input; the document is usable if this returns complete
+    Status finish() {
+        if (status == Status::error)
+            return status;
+        if (!root_closed || (!buf.empty() && buf.find_first_not_of(" \t\r\n") != std::string::npos))
+            return fail("unexpected end of document");
+        if (validator != nullptr && !validator->finish())
+            return fail("document does not match the schema");
+        buf.clear();
+        return status = Status::complete;
+    }
+
+    /// Drops the document and the input received so far
+    void reset() {
+        doc.clear();
+        buf.clear();
+        pos = scan = 0;
+        quote = 0;
+        open.clear();
+        root_closed = false;
+        status = Status::need_more;
+        message.clear();
+        consumed = 0;
+        if (validator != nullptr)
+            validator->reset();
+    }
+
+    /// Checks each element against `schema_validator` as soon as it is parsed, so a feed() stops at the first violation
+    /// The validator must outlive the parse and is reset along with the parser; nullptr turns validation off
+    void validate_with(SchemaValidator* schema_validator) noexcept {
+        validator = schema_validator;
+        if (validator != nullptr)
+            validator->reset();
+    }
+
+    [[nodiscard]] inline Status state() const noexcept { return status; }
+    [[nodiscard]] inline std::string_view error() const noexcept { return message; }
+    [[nodiscard]] inline xml_document<>& document() noexcept { return doc; }
+    [[nodiscard]] inline xml_node<>* root() const noexcept { return doc.first_node(); }
+};
+
+} // namespace
+} // namespace virtxml
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <rapidxml_ns.hpp>
+#include "xmlval.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Validation automata compiled from RelaxNG schemas by tools/rng2tables, see schemas/<name>.hpp in the build tree
+/// Each element definition carries its attribute rules and a DFA over the names of its children; all tables are constant data
+namespace schema {
+struct StrRef {
+    std::uint32_t offset; // into Schema::strings
+    std::uint32_t size;
+};
+enum class ValueKind : std::uint8_t {
+    any,
+    enumeration, // one of the listed values
+    integer,
+    unsigned_integer,
+};
+struct Attribute {
+    StrRef name;
+    ValueKind kind;
+    bool required;
+    std::uint32_t first_value; // into Schema::values, for enumerations
+    std::uint32_t value_count;
+};
+enum Flags : std::uint8_t {
+    text = 1u << 0u,           // character data may appear between the children
+    any_attributes = 1u << 1u, // attributes not listed are accepted
+    any_content = 1u << 2u,    // nothing below the element is checked
+};
+struct Definition {
+    StrRef name; // for diagnostics; a definition may cover elements of the same name from several patterns
+    std::uint32_t first_attribute;
+    std::uint32_t attribute_count;
+    std::uint32_t required_count; // attributes with `required` set
+    std::uint32_t start;          // DFA state before the first child
+    std::uint8_t flags;
+    ValueKind text_kind; // of the text when the content is a single datatype or value
+    std::uint32_t first_value;
+    std::uint32_t value_count;
+};
+struct State {
+    std::uint32_t first_transition; // sorted by name; a "*" transition, if any, comes last and matches every other name
+    std::uint32_t transition_count;
+    bool accepting;
+};
+struct Transition {
+    StrRef name;
+    std::uint32_t target;
+    std::uint32_t definition; // of the child element
+};
+struct Schema {
+    const char* strings;
+    const Definition* definitions;
+    const Attribute* attributes;
+    const StrRef* values;
+    const State* states;
+    const Transition* transitions;
+    std::uint32_t start; // state whose transitions are the allowed root elements
+
+    [[nodiscard]] constexpr std::string_view str(StrRef ref) const noexcept { return {strings + ref.offset, ref.size}; }
+};
+} // namespace schema
+
+struct SchemaError {
+    enum class Problem {
+        unexpected_element,
+        incomplete_content, // a required child is missing
+        unknown_attribute,
+        missing_attribute,
+        bad_value,
+        unexpected_text,
+        too_deep,
+    };
+
+    Problem problem;
+    NodeRef element; // nullptr when the document has no root
+    std::string_view item;     // offending attribute or child name, if any
+};
+
+/// Runs a schema's automata over start and end of element events, as produced by a tree walk or a parser
+/// Keeps one level per open element in a fixed array: no allocation, and constant work per element and attribute besides name lookups
+class SchemaValidator {
+  public:
+    static constexpr std::size_t max_depth = 128;
+
+  private:
+    struct Level {
+        const schema::Definition* definition; // nullptr at document level
+        std::uint32_t state;
+    };
+
+    const schema::Schema* tables;
+    std::array<Level, max_depth + 1> levels{};
+    std::size_t depth = 0;
+    std::size_t unchecked = 0; // open elements below one with any_content
+    bool failed = false;
+    SchemaError err{};
+
+    bool fail(SchemaError::Problem problem, NodeRef element, std::string_view item = {}) noexcept {
+        failed = true;
+        err = SchemaError{problem, element, item};
+        return false;
+    }
+
+    [[nodiscard]] const schema::Transition* find_transition(std::uint32_t state, std::string_view name) const noexcept {
+        const auto& st = tables->states[state];
+        auto lo = tables->transitions + st.first_transition;
+        auto hi = lo + st.transition_count;
+        const auto wildcard = st.transition_count != 0 && tables->str(hi[-1].name) == "*" ? hi - 1 : nullptr;
+        if (wildcard != nullptr)
+            --hi;
+        while (lo < hi) {
+            const auto mid = lo + (hi - lo) / 2;
+            const auto cmp = tables->str(mid->name).compare(name);
+            if (cmp == 0)
+                return mid;
+            if (cmp < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return wildcard;
+    }
+
+    [[nodiscard]] bool valid_value(schema::ValueKind kind, std::uint32_t first_value, std::uint32_t value_count, std::string_view value) const noexcept {
+        switch (kind) {
+        case schema::ValueKind::any:
+            return true;
+        case schema::ValueKind::enumeration:
+            for (auto i = first_value; i < first_value + value_count; ++i)
+                if (tables->str(tables->values[i]) == value)
+                    return true;
+            return false;
+        case schema::ValueKind::integer:
+            return is_integer(value);
+        case schema::ValueKind::unsigned_integer:
+            return !value.empty() && value.front() != '-' && is_integer(value);
+        }
+        return false;
+    }
+
+    bool check_attributes(const schema::Definition& def, NodeRef element) noexcept {
+        std::uint32_t required = 0;
+        for (auto attr = element->first_attribute(); attr != nullptr; attr = attr->next_attribute()) {
+            const std::string_view name{attr->name(), attr->name_size()};
+            if (name.substr(0, 5) == "xmlns" && (name.size() == 5 || name[5] == ':'))
+                continue;
+            const schema::Attribute* rule = nullptr;
+            for (auto i = def.first_attribute; i < def.first_attribute + def.attribute_count && rule == nullptr; ++i)
+                if (tables->str(tables->attributes[i].name) == name)
+                    rule = &tables->attributes[i];
+            if (rule == nullptr) {
+                if ((def.flags & schema::any_attributes) == 0)
+                    return fail(SchemaError::Problem::unknown_attribute, element, name);
+                continue;
+            }
+            if (!valid_value(rule->kind, rule->first_value, rule->value_count, {attr->value(), attr->value_size()}))
+                return fail(SchemaError::Problem::bad_value, element, name);
+            required += rule->required ? 1 : 0;
+        }
+        if (required == def.required_count)
+            return true;
+        for (auto i = def.first_attribute; i < def.first_attribute + def.attribute_count; ++i) {
+            const auto& rule = tables->attributes[i];
+            const auto name = tables->str(rule.name);
+            if (rule.required && element->first_attribute(name.data(), name.size()) == nullptr)
+                return fail(SchemaError::Problem::missing_attribute, element, name);
+        }
+        return true;
+    }
+
+  public:
+    explicit SchemaValidator(const schema::Schema& tables) noexcept : tables(&tables) { reset(); }
+
+    void reset() noexcept {
+        depth = 0;
+        unchecked = 0;
+        failed = false;
+        err = SchemaError{};
+        levels[0] = Level{nullptr, tables->start};
+    }
+
+    /// Start of `element`, whose attributes must already be set
+    bool enter(NodeRef element) noexcept {
+        if (failed)
+            return false;
+        if (unchecked != 0) {
+            ++unchecked;
+            return true;
+        }
+        if (depth == max_depth)
+            return fail(SchemaError::Problem::too_deep, element);
+        auto& parent = levels[depth];
+        const std::string_view name{element->name(), element->name_size()};
+        const auto transition = find_transition(parent.state, name);
+        if (transition == nullptr)
+            return fail(SchemaError::Problem::unexpected_element, element, name);
+        parent.state = transition->target;
+        const auto& def = tables->definitions[transition->definition];
+        if (!check_attributes(def, element))
+            return false;
+        levels[++depth] = Level{&def, def.start};
+        if ((def.flags & schema::any_content) != 0)
+            unchecked = 1;
+        return true;
+    }
+
+    /// End of `element`, once its children and text are known
+    bool leave(NodeRef element) noexcept {
+        if (failed)
+            return false;
+        if (unchecked > 1) {
+            --unchecked;
+            return true;
+        }
+        const auto& level = levels[depth];
+        if (unchecked == 0) {
+            if (!tables->states[level.state].accepting)
+                return fail(SchemaError::Problem::incomplete_content, element);
+            // Indentation between children is not text, and datatypes ignore surrounding whitespace
+            const auto& def = *level.definition;
+            std::string_view text{element->value(), element->value_size()};
+            const auto first = text.find_first_not_of(" \t\r\n");
+            text = first == std::string_view::npos ? std::string_view{} : text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+            if ((def.flags & schema::text) == 0 && !text.empty())
+                return fail(SchemaError::Problem::unexpected_text, element);
+            if (!valid_value(def.text_kind, def.first_value, def.value_count, text))
+                return fail(SchemaError::Problem::bad_value, element);
+        }
+        unchecked = 0;
+        --depth;
+        return true;
+    }
+
+    /// End of the document: true if exactly one allowed root element was seen and nothing failed
+    bool finish() noexcept {
+        if (failed)
+            return false;
+        if (depth != 0 || !tables->states[levels[0].state].accepting)
+            return fail(SchemaError::Problem::incomplete_content, nullptr);
+        return true;
+    }
+
+    [[nodiscard]] inline bool ok() const noexcept { return !failed; }
+    [[nodiscard]] inline const SchemaError& error() const noexcept { return err; }
+};
+
+/// Validates the document rooted at `root` against `tables` in one walk, without recursion or allocation
+[[nodiscard]] inline bool validate(const schema::Schema& tables, NodeRef root, SchemaError* error = nullptr) noexcept {
+    SchemaValidator validator{tables};
+    const auto next_element = [](NodeRef node) {
+        while (node != nullptr && node->type() != node_element)
+            node = node->next_sibling();
+        return node;
+    };
+    for (auto element = root; element != nullptr;) {
+        if (!validator.enter(element))
+            break;
+        if (const auto child = next_element(element->first_node())) {
+            element = child;
+            continue;
+        }
+        for (;;) {
+            if (!validator.leave(element) || element == root) {
+                element = nullptr;
+                break;
+            }
+            if (const auto sibling = next_element(element->next_sibling())) {
+                element = sibling;
+                break;
+            }
+            element = element->parent();
+        }
+    }
+    const bool ret = validator.finish();
+    if (!ret && error != nullptr)
+        *error = validator.error();
+    return ret;
+}
+
+} // namespace
+} // namespace virtxml
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <magic_enum.hpp>
+#include <rapidxml_ns.hpp>
+#include "backing_chain.hpp"
+#include "domain.hpp"
+#include "secret.hpp"
+#include "xmlval.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// A parsed <secret> together with the text it was parsed from
+class SecretDocument {
+    std::string text;
+    xml_document<> doc{};
+
+  public:
+    /// Parses `xml` in place; rapidxml reports malformed input by throwing rapidxml_ns::parse_error
+    explicit SecretDocument(std::string xml) : text(std::move(xml)) { doc.parse<0>(text.data()); }
+    SecretDocument(const SecretDocument&) = delete;
+    SecretDocument& operator=(const SecretDocument&) = delete;
+
+    [[nodiscard]] inline Secret secret() const noexcept { return Secret{doc.first_node("secret")}; }
+};
+
+/// The secrets of a host, hashed by UUID and by usage, the way libvirt looks them up
+/// The usage id is what a secret is looked up by for its usage type: the volume path, the Ceph name, the iSCSI target or the TLS name
+/// The index refers to the secrets' documents, which must outlive it
+class SecretIndex {
+  public:
+    using Key = __uint128_t;
+    using UsageType = Secret::Usage::Type;
+    using Disk = Domain::Devices::Disk;
+
+    struct Entry {
+        Key uuid;
+        std::optional<UsageType> type; // absent for secrets without a usage
+        std::string_view usage;
+        Secret secret;
+    };
+
+    /// Inconsistencies found while indexing; the first of each duplicate stays indexed
+    struct Problems {
+        std::vector<Secret> missing_uuids;
+        std::vector<Key> duplicate_uuids;
+        std::vector<std::pair<UsageType, std::string_view>> duplicate_usages;
+    };
+
+    /// Where a disk refers to a secret
+    enum class Origin {
+        auth,       // <source><auth><secret>
+        encryption, // <source><encryption><secret>
+    };
+    enum class Failure {
+        unspecified,      // neither a UUID nor a usage
+        unknown_uuid,
+        unknown_usage,
+        wrong_usage_type, // the secret exists, but is not meant for this kind of reference
+        conflicting,      // the UUID and the usage name two different secrets
+    };
+    template <class DomainKey> struct Unresolved {
+        DomainKey domain;
+        Disk disk;
+        std::uint32_t layer; // position in the backing chain, 0 being the active image
+        Origin origin;
+        Failure failure;
+    };
+    template <class DomainKey> struct Resolution {
+        std::size_t references = 0;
+        std::vector<Unresolved<DomainKey>> unresolved;
+        std::vector<Secret> unused; // referenced by no disk, in the order they were added
+    };
+
+  private:
+    struct KeyHash {
+        [[nodiscard]] inline std::size_t operator()(Key key) const noexcept {
+            return std::hash<std::uint64_t>{}(static_cast<std::uint64_t>(key) ^ static_cast<std::uint64_t>(key >> 64u) * 0x9E3779B97F4A7C15u);
+        }
+    };
+    using UsageKey = std::pair<UsageType, std::string_view>;
+    struct UsageHash {
+        [[nodiscard]] inline std::size_t operator()(const UsageKey& key) const noexcept {
+            return std::hash<std::string_view>{}(key.second) ^ static_cast<std::size_t>(key.first) * 0x9E3779B97F4A7C15u;
+        }
+    };
+    static constexpr std::uint32_t npos = ~std::uint32_t{0};
+
+    std::vector<Entry> entries;
+    std::unordered_map<Key, std::uint32_t, KeyHash> by_uuid;
+    std::unordered_map<UsageKey, std::uint32_t, UsageHash> by_usage;
+    Problems found;
+
+    [[nodiscard]] static inline std::string_view text_of(NodeRef node) noexcept {
+        return node != nullptr ? std::string_view{node->value(), node->value_size()} : std::string_view{};
+    }
+    [[nodiscard]] static inline std::string_view attr_of(NodeRef node, const char* name) noexcept {
+        const auto attr = node->first_attribute(name);
+        return attr != nullptr ? std::string_view{attr->value(), attr->value_size()} : std::string_view{};
+    }
+
+    [[nodiscard]] inline std::uint32_t position(Key uuid) const noexcept {
+        const auto it = by_uuid.find(uuid);
+        return it != by_uuid.end() ? it->second : npos;
+    }
+    [[nodiscard]] inline std::uint32_t position(UsageType type, std::string_view usage) const noexcept {
+        const auto it = by_usage.find(UsageKey{type, usage});
+        return it != by_usage.end() ? it->second : npos;
+    }
+
+    /// Looks up one <secret> reference; `type` is the usage type the reference requires
+    /// Both kinds of reference are read directly, as their attributes are all optional in practice
+    [[nodiscard]] std::pair<std::uint32_t, std::optional<Failure>> lookup(NodeRef ref, UsageType type) const noexcept {
+        const auto uuid_text = attr_of(ref, "uuid");
+        const auto usage = attr_of(ref, "usage");
+        if (uuid_text.empty() && usage.empty())
+            return {npos, Failure::unspecified};
+        auto pos = npos;
+        if (!uuid_text.empty()) {
+            pos = position(static_cast<Key>(Uuid{ref->first_attribute("uuid")}));
+            if (pos == npos)
+                return {npos, Failure::unknown_uuid};
+            if (entries[pos].type != type)
+                return {pos, Failure::wrong_usage_type};
+        }
+        if (!usage.empty()) {
+            const auto by_name = position(type, usage);
+            if (by_name == npos)
+                return {pos, pos == npos ? Failure::unknown_usage : Failure::conflicting};
+            if (pos != npos && pos != by_name)
+                return {pos, Failure::conflicting};
+            pos = by_name;
+        }
+        return {pos, std::nullopt};
+    }
+
+  public:
+    SecretIndex() = default;
+    /// Indexes `secrets`, a range of Secret views
+    template <class Range> explicit SecretIndex(const Range& secrets) {
+        for (const auto secret : secrets)
+            add(secret);
+    }
+
+    /// Indexes `secret`; returns false, indexing nothing, if it has no UUID or its UUID is already indexed
+    /// A secret whose usage is taken is still indexed by UUID
+    bool add(Secret secret) {
+        const auto node = NodeAccess::of(secret);
+        if (node == nullptr || !secret.uuid()) {
+            found.missing_uuids.push_back(secret);
+            return false;
+        }
+        const auto uuid = static_cast<Key>(secret.uuid());
+        const auto index = static_cast<std::uint32_t>(entries.size());
+        if (!by_uuid.emplace(uuid, index).second) {
+            found.duplicate_uuids.push_back(uuid);
+            return false;
+        }
+        Entry entry{uuid, std::nullopt, {}, secret};
+        if (const auto usage = node->first_node("usage")) {
+            entry.type = magic_enum::enum_cast<UsageType>(attr_of(usage, "type"));
+            if (entry.type) {
+                switch (*entry.type) {
+                case UsageType::volume:
+                    entry.usage = text_of(usage->first_node("volume"));
+                    break;
+                case UsageType::iscsi:
+                    entry.usage = text_of(usage->first_node("target"));
+                    break;
+                case UsageType::ceph:
+                case UsageType::tls:
+                    entry.usage = text_of(usage->first_node("name"));
+                    break;
+                }
+                if (!entry.usage.empty() && !by_usage.emplace(UsageKey{*entry.type, entry.usage}, index).second)
+                    found.duplicate_usages.emplace_back(*entry.type, entry.usage);
+            }
+        }
+        entries.push_back(entry);
+        return true;
+    }
+
+    /// The secret with `uuid`, or a null view
+    [[nodiscard]] inline Secret find(Key uuid) const noexcept {
+        const auto pos = position(uuid);
+        return pos != npos ? entries[pos].secret : Secret{nullptr};
+    }
+    /// The secret of usage `type` with usage id `usage`, or a null view
+    [[nodiscard]] inline Secret find(UsageType type, std::string_view usage) const noexcept {
+        const auto pos = position(type, usage);
+        return pos != npos ? entries[pos].secret : Secret{nullptr};
+    }
+
+    [[nodiscard]] inline std::size_t size() const noexcept { return entries.size(); }
+    [[nodiscard]] inline const std::vector<Entry>& entry_list() const noexcept { return entries; }
+    [[nodiscard]] inline const Problems& problems() const noexcept { return found; }
+
+    /// Calls `fn(disk, layer, origin, secret_node)` for every secret reference of the disks of `dom`, through their backing chains
+    template <class F> static void for_each_reference(Domain dom, F&& fn) {
+        const auto devices = dom.devices();
+        if (!devices)
+            return;
+        for (const auto disk : devices.disks()) {
+            const BackingChain chain{disk};
+            for (std::uint32_t layer = 0; layer < chain.size(); ++layer) {
+                const auto source = chain[layer].source;
+                if (!source)
+                    continue;
+                if (const auto auth = source.auth())
+                    if (const auto ref = NodeAccess::of(auth)->first_node("secret"))
+                        fn(disk, layer, Origin::auth, ref);
+                if (const auto encryption = source.encryption())
+                    for (auto ref = NodeAccess::of(encryption)->first_node("secret"); ref != nullptr; ref = ref->next_sibling("secret"))
+                        fn(disk, layer, Origin::encryption, ref);
+            }
+        }
+    }
+
+    /// Checks every disk secret reference of `domains`, a range of (key, Domain) pairs, in a single pass
+    /// Each reference costs one or two hash lookups; encryption secrets must be of usage volume, auth secrets of their own type
+    template <class Range> [[nodiscard]] auto resolve(const Range& domains) const {
+        using DomainKey = std::decay_t<decltype(std::begin(domains)->first)>;
+        Resolution<DomainKey> ret;
+        std::vector<bool> used(entries.size());
+        for (const auto& [key, dom] : domains) {
+            for_each_reference(dom, [&](Disk disk, std::uint32_t layer, Origin origin, NodeRef ref) {
+                ++ret.references;
+                auto type = std::optional{UsageType::volume};
+                if (origin == Origin::auth)
+                    type = magic_enum::enum_cast<UsageType>(attr_of(ref, "type"));
+                if (!type) {
+                    ret.unresolved.push_back(Unresolved<DomainKey>{key, disk, layer, origin, Failure::wrong_usage_type});
+                    return;
+                }
+                const auto [pos, failure] = lookup(ref, *type);
+                if (pos != npos)
+                    used[pos] = true;
+                if (failure)
+                    ret.unresolved.push_back(Unresolved<DomainKey>{key, disk, layer, origin, *failure});
+            });
+        }
+        for (std::size_t i = 0; i < entries.size(); ++i)
+            if (!used[i])
+                ret.unused.push_back(entries[i].secret);
+        return ret;
+    }
+};
+
+} // namespace
+} // namespace virtxml
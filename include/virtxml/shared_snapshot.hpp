@@ -0,0 +1,352 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <rapidxml_ns.hpp>
+#include "generic.hpp"
+#include "node_ref.hpp"
+#include "snapshot.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Sets of documents published in POSIX shared memory as linked records, so that the processes of a host parse and hold each document once
+/// Under a name such as "/virtxml-qemu", a small control segment holds the current generation, and every generation is a segment
+/// of its own, "/virtxml-qemu.<generation>", never modified once published: a writer fills the next generation, then switches the
+/// control segment to it and unlinks the previous one, which readers still mapping it keep until they refresh
+/// There must be a single writer per name at a time; readers need no locking at all
+namespace shared_snapshot {
+constexpr std::uint32_t version = 2;
+constexpr char control_magic[8] = {'V', 'X', 'M', 'L', 'S', 'H', 'M', 'C'};
+constexpr char segment_magic[8] = {'V', 'X', 'M', 'L', 'S', 'H', 'M', 'S'};
+
+struct Control {
+    char magic[8];
+    std::atomic<std::uint64_t> generation; // 0 until the first publication
+};
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "the generation is shared between processes");
+
+/// Start of a generation segment, followed by the entries and the keys, then the element records, the attribute records and the
+/// strings of a single records::Tree holding every document, each part at the offset the header gives from the start of the segment
+/// Documents share their strings, and the records are read in place: a document is the index of its root element
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order; // 0x01020304 as written by the producing host
+    std::uint64_t generation;
+    std::uint64_t size;
+    std::uint32_t document_count;
+    std::uint32_t element_count;
+    std::uint32_t attribute_count;
+    std::uint32_t strings_size;
+    std::uint64_t elements_offset;
+    std::uint64_t attributes_offset;
+    std::uint64_t strings_offset;
+};
+struct Entry {
+    std::uint64_t key_offset;
+    std::uint32_t key_size;
+    std::uint32_t root; // records::none for a document without a root element
+};
+static_assert(sizeof(Header) % 8 == 0 && sizeof(Entry) % 8 == 0);
+
+[[nodiscard]] inline std::string segment_name(std::string_view name, std::uint64_t generation) {
+    return std::string{name}.append(".").append(std::to_string(generation));
+}
+[[nodiscard]] constexpr std::uint64_t align(std::uint64_t offset) noexcept { return (offset + 7) & ~std::uint64_t{7}; }
+
+/// A read-only or read-write shared mapping of a whole object
+class Mapping {
+    void* address = MAP_FAILED;
+    std::size_t length = 0;
+
+  public:
+    Mapping() = default;
+    Mapping(int fd, std::size_t size, bool writable) noexcept
+        : address(::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0)), length(size) {}
+    Mapping(Mapping&& other) noexcept : address(std::exchange(other.address, MAP_FAILED)), length(std::exchange(other.length, 0)) {}
+    Mapping& operator=(Mapping&& other) noexcept {
+        std::swap(address, other.address);
+        std::swap(length, other.length);
+        return *this;
+    }
+    ~Mapping() {
+        if (address != MAP_FAILED)
+            ::munmap(address, length);
+    }
+
+    [[nodiscard]] inline explicit operator bool() const noexcept { return address != MAP_FAILED; }
+    [[nodiscard]] inline char* data() const noexcept { return static_cast<char*>(address); }
+    [[nodiscard]] inline std::size_t size() const noexcept { return length; }
+};
+
+/// Maps the control segment of `name`, read-write and created with `mode` if missing for the writer, read-only for readers
+[[nodiscard]] inline Mapping map_control(const std::string& name, bool create, mode_t mode = 0) {
+    const int fd = ::shm_open(name.c_str(), create ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, mode);
+    if (fd < 0)
+        return {};
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || (static_cast<std::size_t>(st.st_size) < sizeof(Control) && (!create || ::ftruncate(fd, sizeof(Control)) != 0))) {
+        ::close(fd);
+        return {};
+    }
+    Mapping ret{fd, sizeof(Control), create};
+    ::close(fd);
+    if (!ret)
+        return ret;
+    const auto control = reinterpret_cast<Control*>(ret.data());
+    if (std::memcmp(control->magic, control_magic, sizeof(control_magic)) != 0) {
+        // A fresh segment is zero-filled, which is a valid atomic holding generation 0
+        if (!create || std::any_of(control->magic, control->magic + sizeof(control->magic), [](char c) { return c != 0; })) {
+            errno = EINVAL;
+            return {};
+        }
+        std::memcpy(control->magic, control_magic, sizeof(control_magic));
+    }
+    return ret;
+}
+} // namespace shared_snapshot
+
+/// Publishes generations of a set of documents under a shared memory name
+/// Documents are laid out as records as they are added, so their sources only need to live during add()
+class SharedSnapshotWriter {
+    std::string name;
+    mode_t mode;
+    records::Builder builder;
+    std::vector<std::pair<std::string, std::uint32_t>> documents; // key and root element
+
+  public:
+    /// `name` follows shm_open(3): a leading slash and no other
+    /// `mode` is given to the segments the writer creates, less the umask: only its own user may read the documents by default,
+    /// and readers running as other users need the segments shared with them, e.g. 0640 for a group
+    explicit SharedSnapshotWriter(std::string name, mode_t mode = 0600) : name(std::move(name)), mode(mode) {}
+
+    /// Adds the subtree of an element, or of the element behind a view, to the next generation under `key`
+    template <class View> void add(std::string key, const View& view) {
+        NodeRef root;
+        if constexpr (std::is_pointer_v<View> || std::is_same_v<View, NodeRef>)
+            root = view;
+        else
+            root = NodeAccess::of(view);
+        documents.emplace_back(std::move(key), root != nullptr ? builder.add(root) : records::none);
+    }
+    /// Adds an image made by write_snapshot(); returns false, adding nothing, if it is malformed
+    bool add_image(std::string key, const std::string& image) {
+        Snapshot snap;
+        if (!snap.load(image.data(), image.size()))
+            return false;
+        add(std::move(key), snap.root());
+        return true;
+    }
+    /// Forgets the documents added so far, to start the next generation afresh
+    void clear() noexcept {
+        builder = {};
+        documents.clear();
+    }
+    [[nodiscard]] inline std::size_t size() const noexcept { return documents.size(); }
+
+    /// Writes the documents added so far as the next generation and makes it current; returns its number, or nothing with errno set
+    std::optional<std::uint64_t> publish() {
+        using namespace shared_snapshot;
+        const auto control_map = map_control(name, true, mode);
+        if (!control_map)
+            return std::nullopt;
+        auto& control = *reinterpret_cast<Control*>(control_map.data());
+        const auto previous = control.generation.load(std::memory_order_acquire);
+        const auto generation = previous + 1;
+
+        std::vector<Entry> entries;
+        entries.reserve(documents.size());
+        std::uint64_t size = sizeof(Header) + documents.size() * sizeof(Entry);
+        for (const auto& [key, root] : documents) {
+            entries.push_back(Entry{size, static_cast<std::uint32_t>(key.size()), root});
+            size += key.size();
+        }
+        const auto elements_offset = align(size);
+        const auto attributes_offset = elements_offset + builder.elements.size() * sizeof(records::Element);
+        const auto strings_offset = attributes_offset + builder.attributes.size() * sizeof(records::Attribute);
+        size = align(strings_offset + builder.strings.size());
+
+        const auto segment = segment_name(name, generation);
+        ::shm_unlink(segment.c_str()); // left over by a writer that died before switching to it
+        const int fd = ::shm_open(segment.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+        if (fd < 0)
+            return std::nullopt;
+        Mapping map;
+        if (::ftruncate(fd, static_cast<off_t>(size)) == 0)
+            map = Mapping{fd, static_cast<std::size_t>(size), true};
+        ::close(fd);
+        if (!map) {
+            const auto error = errno;
+            ::shm_unlink(segment.c_str());
+            errno = error;
+            return std::nullopt;
+        }
+
+        const Header header{{segment_magic[0], segment_magic[1], segment_magic[2], segment_magic[3], segment_magic[4], segment_magic[5],
+                             segment_magic[6], segment_magic[7]},
+                            version,
+                            0x01020304u,
+                            generation,
+                            size,
+                            static_cast<std::uint32_t>(documents.size()),
+                            static_cast<std::uint32_t>(builder.elements.size()),
+                            static_cast<std::uint32_t>(builder.attributes.size()),
+                            static_cast<std::uint32_t>(builder.strings.size()),
+                            elements_offset,
+                            attributes_offset,
+                            strings_offset};
+        const auto place = [&](std::uint64_t offset, const void* from, std::size_t bytes) {
+            if (bytes != 0)
+                std::memcpy(map.data() + offset, from, bytes);
+        };
+        place(0, &header, sizeof(header));
+        place(sizeof(Header), entries.data(), entries.size() * sizeof(Entry));
+        for (std::size_t i = 0; i < documents.size(); ++i)
+            place(entries[i].key_offset, documents[i].first.data(), documents[i].first.size());
+        place(elements_offset, builder.elements.data(), builder.elements.size() * sizeof(records::Element));
+        place(attributes_offset, builder.attributes.data(), builder.attributes.size() * sizeof(records::Attribute));
+        place(strings_offset, builder.strings.data(), builder.strings.size());
+
+        control.generation.store(generation, std::memory_order_release);
+        if (previous != 0)
+            ::shm_unlink(segment_name(name, previous).c_str());
+        return generation;
+    }
+
+    /// Unlinks the control segment and the current generation of `name`; processes mapping them keep their mappings
+    static bool remove(const std::string& name) {
+        using namespace shared_snapshot;
+        if (const auto control_map = map_control(name, false)) {
+            const auto generation = reinterpret_cast<const Control*>(control_map.data())->generation.load(std::memory_order_acquire);
+            if (generation != 0)
+                ::shm_unlink(segment_name(name, generation).c_str());
+        }
+        return ::shm_unlink(name.c_str()) == 0;
+    }
+};
+
+/// Maps the current generation published under a shared memory name and exposes its documents to the regular views
+/// The records are read in place, in the segment every reader maps: loading a generation only checks them, and a document is its
+/// root element, e.g. `Domain{reader.find("vm1")}`
+/// Views obtained from a generation stay valid until refresh() moves to another one
+class SharedSnapshotReader {
+    std::string name;
+    shared_snapshot::Mapping control_map;
+    shared_snapshot::Mapping segment;
+    std::uint64_t current = 0;
+    records::Tree tree{};
+    std::unordered_map<std::string_view, std::uint32_t> keys; // to root elements
+
+    /// Maps and checks `generation`; false, keeping the current one, if it is gone or malformed
+    bool load(std::uint64_t generation) {
+        using namespace shared_snapshot;
+        const int fd = ::shm_open(segment_name(name, generation).c_str(), O_RDONLY | O_CLOEXEC, 0);
+        if (fd < 0)
+            return false;
+        struct stat st {};
+        Mapping map;
+        if (::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(Header))
+            map = Mapping{fd, static_cast<std::size_t>(st.st_size), false};
+        ::close(fd);
+        if (!map)
+            return false;
+
+        Header header;
+        std::memcpy(&header, map.data(), sizeof(header));
+        const auto fits = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t size) {
+            return offset <= map.size() && count <= (map.size() - offset) / size;
+        };
+        if (std::memcmp(header.magic, segment_magic, sizeof(segment_magic)) != 0 || header.version != version || header.byte_order != 0x01020304u ||
+            header.generation != generation || header.size != map.size() || !fits(sizeof(Header), header.document_count, sizeof(Entry)) ||
+            header.elements_offset % 8 != 0 || header.attributes_offset % 8 != 0 ||
+            !fits(header.elements_offset, header.element_count, sizeof(records::Element)) ||
+            !fits(header.attributes_offset, header.attribute_count, sizeof(records::Attribute)) || !fits(header.strings_offset, header.strings_size, 1)) {
+            errno = EINVAL;
+            return false;
+        }
+        const auto entries = reinterpret_cast<const Entry*>(map.data() + sizeof(Header));
+        const auto elements = reinterpret_cast<const records::Element*>(map.data() + header.elements_offset);
+        const auto attributes = reinterpret_cast<const records::Attribute*>(map.data() + header.attributes_offset);
+        const auto strings = map.data() + header.strings_offset;
+        if (!records::valid(elements, header.element_count, attributes, header.attribute_count, strings, header.strings_size)) {
+            errno = EINVAL;
+            return false;
+        }
+        std::unordered_map<std::string_view, std::uint32_t> loaded_keys;
+        loaded_keys.reserve(header.document_count);
+        for (std::uint32_t i = 0; i < header.document_count; ++i) {
+            const auto& entry = entries[i];
+            if (!fits(entry.key_offset, entry.key_size, 1) ||
+                (entry.root != records::none && (entry.root >= header.element_count || elements[entry.root].parent != records::none))) {
+                errno = EINVAL;
+                return false;
+            }
+            loaded_keys.insert_or_assign(std::string_view{map.data() + entry.key_offset, entry.key_size}, entry.root);
+        }
+
+        keys = std::move(loaded_keys);
+        tree = records::Tree{elements, attributes, strings};
+        segment = std::move(map);
+        current = generation;
+        return true;
+    }
+
+  public:
+    explicit SharedSnapshotReader(std::string name) : name(std::move(name)) {}
+    SharedSnapshotReader(const SharedSnapshotReader&) = delete;
+    SharedSnapshotReader& operator=(const SharedSnapshotReader&) = delete;
+
+    /// Moves to the current generation if it changed; returns whether it did
+    /// Returns false, keeping the generation in use, if nothing was published yet or the segments cannot be read; errno tells which
+    bool refresh() {
+        if (!control_map) {
+            control_map = shared_snapshot::map_control(name, false);
+            if (!control_map)
+                return false;
+        }
+        const auto& control = *reinterpret_cast<const shared_snapshot::Control*>(control_map.data());
+        // The writer may unlink a generation right after it was read here; the next one is current by then
+        for (int attempt = 0; attempt < 8; ++attempt) {
+            const auto generation = control.generation.load(std::memory_order_acquire);
+            if (generation == 0 || generation == current)
+                return false;
+            if (load(generation))
+                return true;
+            if (errno != ENOENT)
+                return false;
+        }
+        return false;
+    }
+
+    /// The generation in use, 0 if none
+    [[nodiscard]] inline std::uint64_t generation() const noexcept { return current; }
+    [[nodiscard]] inline std::size_t size() const noexcept { return keys.size(); }
+    /// The root element of the document published under `key`, or null
+    [[nodiscard]] inline NodeRef find(std::string_view key) const noexcept {
+        const auto it = keys.find(key);
+        return it != keys.end() ? NodeRef{tree, it->second} : nullptr;
+    }
+    /// Calls `fn(key, NodeRef)` for every document, with its root element
+    template <class F> void for_each(F&& fn) const {
+        for (const auto& [key, root] : keys)
+            fn(key, NodeRef{tree, root});
+    }
+};
+
+} // namespace
+} // namespace virtxml
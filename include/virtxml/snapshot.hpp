@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <gsl/gsl>
+#include <rapidxml_ns.hpp>
+#include "capabilities.hpp"
+#include "device.hpp"
+#include "domain.hpp"
+#include "generic.hpp"
+#include "node_ref.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Binary image of a parsed document: a header, then the element records, the attribute records and the strings of a records::Tree
+/// All references are 32-bit offsets or indices, so an image is position-independent and is read in place wherever it is mapped
+namespace snapshot {
+constexpr std::uint32_t version = 2;
+constexpr char magic[8] = {'V', 'X', 'M', 'L', 'S', 'N', 'A', 'P'};
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order; // 0x01020304 as written by the producing host
+    std::uint32_t element_count;
+    std::uint32_t attribute_count;
+    std::uint32_t strings_size;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(Header) % alignof(records::Element) == 0 && sizeof(records::Element) % alignof(records::Attribute) == 0);
+
+/// The image of the subtree of `root`, its root element being the first record
+/// Text and comment nodes are not kept, element values are
+[[nodiscard]] inline std::string write(NodeRef root) {
+    records::Builder builder;
+    if (root != nullptr)
+        builder.add(root);
+    const Header header{{magic[0], magic[1], magic[2], magic[3], magic[4], magic[5], magic[6], magic[7]},
+                        version,
+                        0x01020304u,
+                        static_cast<std::uint32_t>(builder.elements.size()),
+                        static_cast<std::uint32_t>(builder.attributes.size()),
+                        static_cast<std::uint32_t>(builder.strings.size()),
+                        0};
+    std::string ret;
+    ret.reserve(sizeof(Header) + builder.elements.size() * sizeof(records::Element) + builder.attributes.size() * sizeof(records::Attribute) +
+                builder.strings.size());
+    ret.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    ret.append(reinterpret_cast<const char*>(builder.elements.data()), builder.elements.size() * sizeof(records::Element));
+    ret.append(reinterpret_cast<const char*>(builder.attributes.data()), builder.attributes.size() * sizeof(records::Attribute));
+    ret.append(builder.strings);
+    return ret;
+}
+} // namespace snapshot
+
+[[nodiscard]] inline std::string write_snapshot(NodeRef root) { return snapshot::write(root); }
+[[nodiscard]] inline std::string write_snapshot(Domain dom) { return write_snapshot(NodeAccess::of(dom)); }
+[[nodiscard]] inline std::string write_snapshot(Device dev) { return write_snapshot(NodeAccess::of(dev)); }
+[[nodiscard]] inline std::string write_snapshot(const DriverCapabilities& caps) { return write_snapshot(NodeAccess::of(caps)); }
+
+/// Writes `image` to `path` atomically: to a temporary file next to it, synced, then renamed over it
+/// Readers, and a crash, see either the previous file or the whole new one; returns false with errno set, leaving `path` as it was
+[[nodiscard]] inline bool save_snapshot(gsl::czstring<> path, std::string_view image) {
+    static std::atomic<unsigned> counter{0};
+    const auto temp = std::string{path} + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(counter++);
+    const int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    if (fd < 0)
+        return false;
+    auto written = true;
+    for (std::size_t done = 0; written && done < image.size();) {
+        const auto size = ::write(fd, image.data() + done, image.size() - done);
+        written = size > 0 || (size < 0 && errno == EINTR);
+        done += size > 0 ? static_cast<std::size_t>(size) : 0;
+    }
+    written = written && ::fsync(fd) == 0;
+    written = ::close(fd) == 0 && written;
+    if (!written || ::rename(temp.c_str(), path) != 0) {
+        const auto error = errno;
+        ::unlink(temp.c_str());
+        errno = error;
+        return false;
+    }
+    // The rename itself is only durable once the directory is synced
+    const auto slash = std::string_view{path}.rfind('/');
+    const auto dir = slash == std::string_view::npos ? std::string{"."} : std::string{path, slash == 0 ? 1 : slash};
+    if (const int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+    return true;
+}
+
+/// A snapshot image, either mapped from a file or borrowed from memory, exposed through the regular views
+/// Loading only checks the records, which the views then walk in place: nothing is allocated or rebuilt
+class Snapshot {
+    records::Tree tree{};
+    std::uint32_t element_count = 0;
+    void* mapping = nullptr;
+    std::size_t mapping_size = 0;
+
+  public:
+    Snapshot() = default;
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+    ~Snapshot() { close(); }
+
+    /// Binds to `size` bytes at `data`, which must stay alive and unchanged and be aligned to 4 bytes
+    /// Returns false on a malformed or foreign image
+    bool load(const void* data, std::size_t size) noexcept {
+        using namespace snapshot;
+        tree = {};
+        element_count = 0;
+        if (size < sizeof(Header) || reinterpret_cast<std::uintptr_t>(data) % alignof(records::Element) != 0)
+            return false;
+        const auto bytes = static_cast<const char*>(data);
+        Header header;
+        std::memcpy(&header, bytes, sizeof(header));
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version || header.byte_order != 0x01020304u)
+            return false;
+        const auto elements_size = std::uint64_t{header.element_count} * sizeof(records::Element);
+        const auto attributes_size = std::uint64_t{header.attribute_count} * sizeof(records::Attribute);
+        if (sizeof(Header) + elements_size + attributes_size + header.strings_size != size)
+            return false;
+        const auto elements = reinterpret_cast<const records::Element*>(bytes + sizeof(Header));
+        const auto attributes = reinterpret_cast<const records::Attribute*>(bytes + sizeof(Header) + elements_size);
+        const auto strings = bytes + sizeof(Header) + elements_size + attributes_size;
+        if (!records::valid(elements, header.element_count, attributes, header.attribute_count, strings, header.strings_size) ||
+            (header.element_count != 0 && elements[0].parent != records::none))
+            return false;
+        tree = records::Tree{elements, attributes, strings};
+        element_count = header.element_count;
+        return true;
+    }
+
+    /// Maps the file at `path` privately and loads it
+    bool open(gsl::czstring<> path) {
+        close();
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        struct stat st {};
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        const auto size = static_cast<std::size_t>(st.st_size);
+        const auto map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+            return false;
+        mapping = map;
+        mapping_size = size;
+        if (!load(mapping, mapping_size)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() noexcept {
+        tree = {};
+        element_count = 0;
+        if (mapping != nullptr)
+            ::munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+    }
+
+    /// The root element, if it is named `name` when given
+    [[nodiscard]] inline NodeRef root(gsl::czstring<> name = nullptr) const noexcept {
+        if (element_count == 0 || !tree.named(tree.elements[0], name, name != nullptr ? std::strlen(name) : 0))
+            return nullptr;
+        return NodeRef{tree, 0};
+    }
+    [[nodiscard]] inline Domain domain() const noexcept { return Domain{root("domain")}; }
+    [[nodiscard]] inline Device device() const noexcept { return Device{root("device")}; }
+    [[nodiscard]] inline DriverCapabilities capabilities() const { return DriverCapabilities{root("capabilities")}; }
+    /// Number of elements in the image
+    [[nodiscard]] inline std::uint32_t size() const noexcept { return element_count; }
+};
+
+} // namespace
+} // namespace virtxml
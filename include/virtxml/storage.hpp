@@ -1,5 +1,7 @@
 #pragma once
 
+#include <optional>
+#include <string_view>
 #include <magic_enum.hpp>
 #include "generic.hpp"
 #include "xmlspan.hpp"
@@ -65,4 +67,110 @@ struct Encryption : public Node {
     [[nodiscard]] inline Optional<Cipher> cipher() const noexcept { return Cipher{node->first_node("cipher")}; }
     [[nodiscard]] inline Optional<IVGen> ivgen() const noexcept { return IVGen{node->first_node("ivgen")}; }
 };
+
+struct Permissions : public Node {
+    [[nodiscard]] inline Optional<Integral> mode() const noexcept { return Integral{node->first_node("mode")}; }
+    [[nodiscard]] inline Optional<Integral> owner() const noexcept { return Integral{node->first_node("owner")}; }
+    [[nodiscard]] inline Optional<Integral> group() const noexcept { return Integral{node->first_node("group")}; }
+    [[nodiscard]] inline Optional<String> label() const noexcept { return String{node->first_node("label")}; }
+};
+
+struct Timestamps : public Node {
+    [[nodiscard]] inline Optional<String> atime() const noexcept { return String{node->first_node("atime")}; }
+    [[nodiscard]] inline Optional<String> mtime() const noexcept { return String{node->first_node("mtime")}; }
+    [[nodiscard]] inline Optional<String> ctime() const noexcept { return String{node->first_node("ctime")}; }
+    [[nodiscard]] inline Optional<String> btime() const noexcept { return String{node->first_node("btime")}; }
+};
+
+/// <pool>, as returned by virStoragePoolGetXMLDesc
+struct Pool : public Node {
+    enum class Type {
+        dir,
+        fs,
+        netfs,
+        logical,
+        disk,
+        iscsi,
+        iscsi_direct,
+        scsi,
+        mpath,
+        rbd,
+        sheepdog,
+        gluster,
+        zfs,
+        vstorage,
+    };
+
+    struct Source : public Node {
+        struct Host : public Node {
+            [[nodiscard]] inline String name() const noexcept { return String{node->first_attribute("name")}; }
+            [[nodiscard]] inline Optional<Integral> port() const noexcept { return Integral{node->first_attribute("port")}; }
+        };
+        struct Device : public Node {
+            [[nodiscard]] inline String path() const noexcept { return String{node->first_attribute("path")}; }
+        };
+
+        [[nodiscard]] inline NamedSpan<Host> hosts() const noexcept { return NamedSpan<Host>{"host", node}; }
+        [[nodiscard]] inline NamedSpan<Device> devices() const noexcept { return NamedSpan<Device>{"device", node}; }
+        [[nodiscard]] inline Optional<String> dir() const noexcept {
+            const auto dir = node->first_node("dir");
+            return String{dir != nullptr ? dir->first_attribute("path") : nullptr};
+        }
+        [[nodiscard]] inline Optional<String> name() const noexcept { return String{node->first_node("name")}; }
+        /// Pool-type specific, e.g. "auto", "nfs", "ext4", "lvm2" or "gpt"
+        [[nodiscard]] inline Optional<String> format() const noexcept {
+            const auto format = node->first_node("format");
+            return String{format != nullptr ? format->first_attribute("type") : nullptr};
+        }
+    };
+
+    struct Target : public Node {
+        [[nodiscard]] inline Optional<String> path() const noexcept { return String{node->first_node("path")}; }
+        [[nodiscard]] inline Optional<Permissions> permissions() const noexcept { return Permissions{node->first_node("permissions")}; }
+    };
+
+    [[nodiscard]] inline Type type() const noexcept { return enum_wrap_attr<Type>(node, "type", true); }
+    [[nodiscard]] inline String name() const noexcept { return String{node->first_node("name")}; }
+    [[nodiscard]] inline Optional<Uuid> uuid() const noexcept { return Uuid{node->first_node("uuid")}; }
+    [[nodiscard]] inline Optional<ScaledIntegral> capacity() const noexcept { return ScaledIntegral{node->first_node("capacity")}; }
+    [[nodiscard]] inline Optional<ScaledIntegral> allocation() const noexcept { return ScaledIntegral{node->first_node("allocation")}; }
+    [[nodiscard]] inline Optional<ScaledIntegral> available() const noexcept { return ScaledIntegral{node->first_node("available")}; }
+    [[nodiscard]] inline Optional<Source> source() const noexcept { return Source{node->first_node("source")}; }
+    [[nodiscard]] inline Optional<Target> target() const noexcept { return Target{node->first_node("target")}; }
+};
+
+/// <volume>, as returned by virStorageVolGetXMLDesc
+struct Volume : public Node {
+    enum class Type {
+        file,
+        block,
+        dir,
+        network,
+        netdir,
+        ploop,
+    };
+
+    struct Target : public Node {
+        [[nodiscard]] inline Optional<String> path() const noexcept { return String{node->first_node("path")}; }
+        [[nodiscard]] inline std::optional<storage::Format> format() const noexcept {
+            const auto format = node->first_node("format");
+            const auto type = format != nullptr ? format->first_attribute("type") : nullptr;
+            return type != nullptr ? magic_enum::enum_cast<storage::Format>(std::string_view{type->value(), type->value_size()}) : std::nullopt;
+        }
+        [[nodiscard]] inline Optional<Permissions> permissions() const noexcept { return Permissions{node->first_node("permissions")}; }
+        [[nodiscard]] inline Optional<Timestamps> timestamps() const noexcept { return Timestamps{node->first_node("timestamps")}; }
+        [[nodiscard]] inline Optional<String> compat() const noexcept { return String{node->first_node("compat")}; }
+        [[nodiscard]] inline Optional<Encryption> encryption() const noexcept { return Encryption{node->first_node("encryption")}; }
+    };
+
+    [[nodiscard]] inline std::optional<Type> type() const noexcept { return enum_wrap_attr<Type, Optional>(node, "type"); }
+    [[nodiscard]] inline String name() const noexcept { return String{node->first_node("name")}; }
+    [[nodiscard]] inline Optional<String> key() const noexcept { return String{node->first_node("key")}; }
+    [[nodiscard]] inline Optional<ScaledIntegral> capacity() const noexcept { return ScaledIntegral{node->first_node("capacity")}; }
+    [[nodiscard]] inline Optional<ScaledIntegral> allocation() const noexcept { return ScaledIntegral{node->first_node("allocation")}; }
+    [[nodiscard]] inline Optional<ScaledIntegral> physical() const noexcept { return ScaledIntegral{node->first_node("physical")}; }
+    [[nodiscard]] inline Optional<Target> target() const noexcept { return Target{node->first_node("target")}; }
+    /// Shares the layout of the target: path, format and permissions
+    [[nodiscard]] inline Optional<Target> backing_store() const noexcept { return Target{node->first_node("backingStore")}; }
+};
 } // namespace virtxml::storage
\ No newline at end of file
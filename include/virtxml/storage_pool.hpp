@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <rapidxml_ns.hpp>
+#include "storage.hpp"
+#include "xmlspan.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// A parsed <volume> together with the text it was parsed from
+class StorageVolume {
+    std::string text;
+    xml_document<> doc{};
+
+  public:
+    /// Parses `xml` in place; rapidxml reports malformed input by throwing rapidxml_ns::parse_error
+    explicit StorageVolume(std::string xml) : text(std::move(xml)) { doc.parse<0>(text.data()); }
+    StorageVolume(const StorageVolume&) = delete;
+    StorageVolume& operator=(const StorageVolume&) = delete;
+
+    [[nodiscard]] inline storage::Volume volume() const noexcept { return storage::Volume{doc.first_node("volume")}; }
+};
+
+/// A parsed <pool> and the volumes parsed for it, all in one arena
+/// Each document is copied into the memory pool of a single xml_document and parsed there, and its root is then detached,
+/// so the nodes and text of tens of thousands of volumes take a few large blocks instead of two allocations per document,
+/// and are all freed at once with the pool
+class StoragePool {
+    xml_document<> doc{};
+    xml_node<>* root;    // <pool>
+    xml_node<>* volumes; // parent of every parsed <volume>, outside of the document so that parsing leaves it alone
+    std::unordered_map<std::string_view, xml_node<>*> keys;
+    std::size_t count = 0;
+
+    /// Copies `xml` into the arena and parses it, leaving its root element detached; throws rapidxml_ns::parse_error
+    xml_node<>* parse(std::string_view xml, const char* name) {
+        const auto text = doc.allocate_string(nullptr, xml.size() + 1);
+        std::copy(xml.begin(), xml.end(), text);
+        text[xml.size()] = '\0';
+        doc.parse<0>(text);
+        const auto element = doc.first_node(name);
+        if (element != nullptr)
+            doc.remove_node(element);
+        return element;
+    }
+
+  public:
+    /// Parses the output of virStoragePoolGetXMLDesc; rapidxml reports malformed input by throwing rapidxml_ns::parse_error
+    explicit StoragePool(std::string_view xml) : root(parse(xml, "pool")), volumes(doc.allocate_node(node_element, "volumes")) {}
+    StoragePool(const StoragePool&) = delete;
+    StoragePool& operator=(const StoragePool&) = delete;
+
+    [[nodiscard]] inline storage::Pool pool() const noexcept { return storage::Pool{root}; }
+
+    /// Parses the output of virStorageVolGetXMLDesc into the arena; returns false, adding nothing, if it is malformed or not a <volume>
+    /// The text of a rejected document stays in the arena until the pool is destroyed
+    bool add_volume(std::string_view xml) {
+        xml_node<>* element;
+        try {
+            element = parse(xml, "volume");
+        } catch (const rapidxml_ns::parse_error&) {
+            return false;
+        }
+        if (element == nullptr)
+            return false;
+        volumes->append_node(element);
+        ++count;
+        if (const auto key = element->first_node("key"))
+            keys.insert_or_assign(std::string_view{key->value(), key->value_size()}, element);
+        return true;
+    }
+    /// Adds every document of `xmls`, a range of strings; returns how many were rejected
+    template <class Range> std::size_t add_volumes(const Range& xmls) {
+        std::size_t rejected = 0;
+        for (const auto& xml : xmls)
+            rejected += add_volume(std::string_view{xml}) ? 0 : 1;
+        return rejected;
+    }
+
+    /// The volumes in the order they were added
+    [[nodiscard]] inline NamedSpan<storage::Volume> volume_list() const noexcept { return NamedSpan<storage::Volume>{"volume", volumes}; }
+    [[nodiscard]] inline std::size_t volume_count() const noexcept { return count; }
+    /// The volume last added with `key`, or a null view
+    [[nodiscard]] inline storage::Volume find_volume(std::string_view key) const noexcept {
+        const auto it = keys.find(key);
+        return storage::Volume{it != keys.end() ? it->second : nullptr};
+    }
+};
+
+} // namespace
+} // namespace virtxml
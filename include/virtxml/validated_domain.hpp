@@ -0,0 +1,306 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <magic_enum.hpp>
+#include <rapidxml_ns.hpp>
+#include "domain.hpp"
+#include "network.hpp"
+#include "xmlval.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// What a domain document lacks for one of the accessors that assume their input is well-formed
+struct ValidationError {
+    enum class Problem {
+        missing_attribute,
+        missing_element,
+        bad_value, // not a known enumerator, boolean or integer
+    };
+
+    NodeRef element;
+    std::string_view item; // "@attribute", the name of the missing child, or empty for the element text
+    Problem problem;
+};
+
+namespace impl {
+using ValueCheck = bool (*)(std::string_view);
+
+template <class E, bool Underscores = false> [[nodiscard]] bool is_enumerator(std::string_view str) {
+    return enum_cast_xml<E>(str, Underscores).has_value();
+}
+
+/// One precondition of an unchecked accessor
+struct ValidationRule {
+    std::string_view path; // element names from an ancestor down to the element checked, matched against the end of its path
+    std::string_view item; // "@attribute" that must exist, "@attribute?" checked only if present, a child element that must exist, or empty for the text
+    ValueCheck check;      // nullptr if only presence matters
+    bool (*applies)(NodeRef element) = nullptr;
+};
+
+[[nodiscard]] inline bool attribute_is(NodeRef element, const char* name, std::string_view value) noexcept {
+    const auto attr = element != nullptr ? element->first_attribute(name) : nullptr;
+    return attr != nullptr && std::string_view{attr->value(), attr->value_size()} == value;
+}
+
+[[nodiscard]] inline const std::vector<ValidationRule>& domain_validation_rules() {
+    using D = Domain::Devices;
+    static const std::vector<ValidationRule> rules{
+        {"domain", "@type", is_enumerator<Domain::Type>},
+        {"domain", "name", nullptr},
+        {"sysinfo/bios/entry", "@name", is_enumerator<Domain::Sysinfo::BiosEntry::Name>},
+        {"sysinfo/system/entry", "@name", is_enumerator<Domain::Sysinfo::SystemEntry::Name>},
+        {"sysinfo/baseBoard/entry", "@name", is_enumerator<Domain::Sysinfo::BaseboardEntry::Name>},
+        {"os/type", "", is_enumerator<Domain::Os::TypeValue>},
+        {"os/boot", "@dev", is_enumerator<Domain::Os::Boot::Device>},
+        {"os/bootmenu", "@enable", is_enumerator<YesNo>},
+        {"os/smbios", "@mode", is_enumerator<Domain::Os::HvmSMBIOS::Mode>},
+        {"clock", "@offset", is_enumerator<Domain::Clock::Offset>},
+        {"clock/timer", "@name", is_enumerator<Domain::Clock::Timer::Name>},
+        {"perf/event", "@name", is_enumerator<Domain::Perf::Event::Name>},
+        {"perf/event", "@enabled", is_enumerator<YesNo>},
+        {"idmap/uid", "@start", is_integer},
+        {"idmap/uid", "@target", is_integer},
+        {"idmap/uid", "@count", is_integer},
+        {"idmap/gid", "@start", is_integer},
+        {"idmap/gid", "@target", is_integer},
+        {"idmap/gid", "@count", is_integer},
+        {"keywrap/cipher", "@name", is_enumerator<Domain::Keywrap::Cipher::Name>},
+        {"keywrap/cipher", "@state", is_enumerator<OnOff>},
+        {"boot", "@order", is_integer, [](NodeRef boot) { return std::string_view{boot->parent()->name(), boot->parent()->name_size()} != "os"; }},
+        {"reconnect", "@enabled", is_enumerator<YesNo>},
+        {"auth/secret", "@type", is_enumerator<D::Disk::Auth::Secret::Type>},
+        {"devices/controller", "@type", is_enumerator<D::Controller::Type>},
+        {"devices/interface", "@type", is_enumerator<D::Interface::Type>},
+        {"interface/source/address", "@type", is_enumerator<D::Interface::Source::HostdevAddress::Type>},
+        {"source/vendor", "@id", is_integer},
+        {"source/product", "@id", is_integer},
+        {"interface/link", "@state", is_enumerator<D::Interface::Link::State>},
+        {"interface/mtu", "@size", is_integer},
+        {"interface/vlan/tag", "@id", is_integer},
+        {"devices/input", "@type", is_enumerator<D::Input::Type>},
+        {"devices/input", "@bus", is_enumerator<D::Input::Bus>},
+        {"devices/sound", "@model", is_enumerator<D::Sound::Model>},
+        {"sound/codec", "@type", is_enumerator<D::Sound::Codec::Type>},
+        {"devices/hostdev", "@type", is_enumerator<D::HostDev::Type>},
+        {"hostdev/driver", "@name", is_enumerator<D::HostDev::Driver::Name>},
+        {"hostdev/source/address", "@type", is_enumerator<D::HostDev::Source::UsbScsiAddress::Type>,
+         [](NodeRef address) {
+             const auto hostdev = address->parent()->parent();
+             return attribute_is(hostdev, "type", "usb") || attribute_is(hostdev, "type", "scsi");
+         }},
+        {"devices/graphics", "@type", is_enumerator<D::Graphics::Type>},
+        {"graphics/listen", "@type", is_enumerator<D::Graphics::Listen::Type>},
+        {"graphics/channel", "@name", is_enumerator<D::Graphics::Channel::Name>},
+        {"graphics/channel", "@mode", is_enumerator<D::Graphics::Mode>},
+        {"graphics/image", "@compression", is_enumerator<D::Graphics::Image::Compression>},
+        {"graphics/jpeg", "@compression", is_enumerator<D::Graphics::JpegZlib::Compression>},
+        {"graphics/zlib", "@compression", is_enumerator<D::Graphics::JpegZlib::Compression>},
+        {"graphics/playback", "@compression", is_enumerator<OnOff>},
+        {"graphics/streaming", "@mode", is_enumerator<D::Graphics::Streaming::Mode>},
+        {"graphics/clipboard", "@copypaste", is_enumerator<OnOff>},
+        {"graphics/mouse", "@mode", is_enumerator<D::Graphics::Mouse::Mode>},
+        {"graphics/filetransfer", "@enable", is_enumerator<YesNo>},
+        {"graphics/gl", "@enable", is_enumerator<YesNo>},
+        {"video/model", "@type", is_enumerator<D::Video::Model::Type>},
+        {"devices/channel", "@type", is_enumerator<D::QemuCharDevType>},
+        {"devices/channel/target", "@type", is_enumerator<D::Channel::Target::Type>},
+        {"devices/smartcard", "@mode", is_enumerator<D::Smartcard::Mode, true>},
+        {"devices/hub", "@type", is_enumerator<D::Hub::Type>},
+        {"devices/redirdev", "@bus", is_enumerator<D::RedirDev::Bus>},
+        {"redirfilter/usbdev", "@allow", is_enumerator<YesNo>},
+        {"devices/rng", "@model", is_enumerator<D::Rng::Model>},
+        {"devices/rng", "backend", nullptr},
+        {"rng/backend", "@model", is_enumerator<D::Rng::Backend::Model>},
+        {"rng/rate", "@bytes", is_integer},
+        {"devices/tpm", "backend", nullptr},
+        {"tpm/backend", "@type", is_enumerator<D::Tpm::Backend::Type>},
+        {"shmem/model", "@type", is_enumerator<D::ShMem::Model::Type, true>},
+        {"devices/memorydev", "target", nullptr},
+        {"memorydev/target", "size", is_integer},
+        {"memorydev/target/label", "size", is_integer},
+        {"devices/watchdog", "@model", is_enumerator<D::Watchdog::Model>},
+        {"devices/memballoon", "@model", is_enumerator<D::MemBalloon::Model>},
+        {"memballoon/stats", "@period", is_integer},
+        {"devices/panic", "@model", is_enumerator<D::Panic::Model>},
+        {"devices/iommu", "@model", is_enumerator<D::Iommu::Model>},
+        {"devices/serial", "@type", is_enumerator<D::QemuCharDevType>},
+        {"devices/console", "@type", is_enumerator<D::QemuCharDevType>},
+        {"devices/parallel", "@type", is_enumerator<D::QemuCharDevType>},
+        {"serial/target/model", "@name", is_enumerator<D::QemuCharDev::Target::Model::Name, true>},
+        {"console/target/model", "@name", is_enumerator<D::QemuCharDev::Target::Model::Name, true>},
+        {"parallel/target/model", "@name", is_enumerator<D::QemuCharDev::Target::Model::Name, true>},
+        {"serial/protocol", "@type", is_enumerator<D::QemuCharDev::Protocol::Type>},
+        {"console/protocol", "@type", is_enumerator<D::QemuCharDev::Protocol::Type>},
+        {"parallel/protocol", "@type", is_enumerator<D::QemuCharDev::Protocol::Type>},
+
+        // Optional attributes whose accessors still assume a valid value when present
+        {"os/type", "@arch?", is_enumerator<cpu::Arch>},
+        {"os/loader", "@type?", is_enumerator<Domain::Os::HvmLoader::Type>},
+        {"os/loader", "@readonly?", is_enumerator<YesNo>},
+        {"os/loader", "@secure?", is_enumerator<YesNo>},
+        {"os/bios", "@useserial?", is_enumerator<YesNo>},
+        {"clock/timer", "@present?", is_enumerator<YesNo>},
+        {"pm/suspend-to-mem", "@enabled?", is_enumerator<YesNo>},
+        {"pm/suspend-to-disk", "@enabled?", is_enumerator<YesNo>},
+        {"seclabel", "@relabel?", is_enumerator<YesNo>},
+        {"rom", "@bar?", is_enumerator<OnOff>},
+        {"address", "@multifunction?", is_enumerator<OnOff>},
+        {"source", "@tls?", is_enumerator<YesNo>},
+        {"source", "@append?", is_enumerator<OnOff>},
+        {"log", "@append?", is_enumerator<OnOff>},
+        {"driver", "@iommu?", is_enumerator<OnOff>},
+        {"driver", "@ats?", is_enumerator<OnOff>},
+        {"driver", "@ioeventfd?", is_enumerator<OnOff>},
+        {"driver", "@event_idx?", is_enumerator<OnOff>},
+        {"devices/disk", "@raw_io?", is_enumerator<YesNo>},
+        {"interface/source", "@missing?", is_enumerator<YesNo>},
+        {"devices/interface", "@managed?", is_enumerator<YesNo>},
+        {"devices/interface", "@trustGuestRxFilters?", is_enumerator<YesNo>},
+        {"interface/driver/guest", "@csum?", is_enumerator<OnOff>},
+        {"interface/driver/guest", "@tso4?", is_enumerator<OnOff>},
+        {"interface/driver/guest", "@tso6?", is_enumerator<OnOff>},
+        {"interface/driver/guest", "@ecn?", is_enumerator<OnOff>},
+        {"interface/driver/guest", "@ufo?", is_enumerator<OnOff>},
+        {"interface/driver/host", "@gso?", is_enumerator<OnOff>},
+        {"interface/driver/host", "@mrg_rxbuf?", is_enumerator<OnOff>},
+        {"devices/hostdev", "@managed?", is_enumerator<YesNo>},
+        {"devices/hostdev", "@raw_io?", is_enumerator<YesNo>},
+        {"devices/graphics", "@fullscreen?", is_enumerator<YesNo>},
+        {"devices/graphics", "@autoport?", is_enumerator<YesNo>},
+        {"devices/graphics", "@replaceUser?", is_enumerator<YesNo>},
+        {"devices/graphics", "@multiUser?", is_enumerator<YesNo>},
+        {"video/model", "@primary?", is_enumerator<YesNo>},
+        {"video/model/acceleration", "@accel3d?", is_enumerator<YesNo>},
+        {"video/model/acceleration", "@accel2d?", is_enumerator<YesNo>},
+        {"shmem/msi", "@ioeventfd?", is_enumerator<OnOff>},
+        {"devices/memballoon", "@autodeflate?", is_enumerator<OnOff>},
+        {"iommu/driver", "@intremap?", is_enumerator<OnOff>},
+        {"iommu/driver", "@caching_mode?", is_enumerator<OnOff>},
+        {"iommu/driver", "@eim?", is_enumerator<OnOff>},
+        {"iommu/driver", "@iotlb?", is_enumerator<OnOff>},
+        // Device addresses; the <address> of a host device source is a different element
+        {"address", "@type", is_enumerator<Address::Type, true>,
+         [](NodeRef address) { return std::string_view{address->parent()->name(), address->parent()->name_size()} != "source"; }},
+    };
+    return rules;
+}
+
+/// Rules by the name of the element they check, so each element of the document is looked up once
+class DomainValidator {
+    struct Compiled {
+        const ValidationRule* rule;
+        std::vector<std::string_view> ancestors; // innermost first, the element itself excluded
+    };
+    std::unordered_map<std::string_view, std::vector<Compiled>> by_name;
+
+    DomainValidator() {
+        for (const auto& rule : domain_validation_rules()) {
+            std::vector<std::string_view> steps;
+            for (auto path = rule.path; !path.empty();) {
+                const auto slash = path.find('/');
+                steps.push_back(path.substr(0, slash));
+                path = slash == std::string_view::npos ? std::string_view{} : path.substr(slash + 1);
+            }
+            const auto name = steps.back();
+            steps.pop_back();
+            by_name[name].push_back(Compiled{&rule, std::vector<std::string_view>(steps.rbegin(), steps.rend())});
+        }
+    }
+
+    [[nodiscard]] static bool ancestors_match(NodeRef element, const std::vector<std::string_view>& ancestors) noexcept {
+        for (const auto name : ancestors) {
+            element = element->parent();
+            if (element == nullptr || element->type() != node_element || std::string_view{element->name(), element->name_size()} != name)
+                return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] static bool check(NodeRef element, const ValidationRule& rule, std::vector<ValidationError>* errors) {
+        using Problem = ValidationError::Problem;
+        const auto fail = [&](Problem problem) {
+            if (errors != nullptr)
+                errors->push_back(ValidationError{element, rule.item.substr(0, rule.item.find('?')), problem});
+            return false;
+        };
+        const auto valid = [&](const char* value, std::size_t size) { return rule.check == nullptr || rule.check({value, size}) || fail(Problem::bad_value); };
+        if (rule.item.empty())
+            return valid(element->value(), element->value_size());
+        if (rule.item.front() == '@') {
+            const bool optional = rule.item.back() == '?';
+            const auto name = rule.item.substr(1, rule.item.size() - (optional ? 2 : 1));
+            const auto attr = element->first_attribute(name.data(), name.size());
+            if (attr == nullptr)
+                return optional || fail(Problem::missing_attribute);
+            return valid(attr->value(), attr->value_size());
+        }
+        const auto child = element->first_node(rule.item.data(), rule.item.size());
+        if (child == nullptr)
+            return fail(Problem::missing_element);
+        return valid(child->value(), child->value_size());
+    }
+
+  public:
+    [[nodiscard]] static const DomainValidator& instance() {
+        static const DomainValidator validator;
+        return validator;
+    }
+
+    /// Checks every element below and including `root` in one depth-first walk; true if nothing was wrong
+    [[nodiscard]] bool run(NodeRef root, std::vector<ValidationError>* errors) const {
+        bool ok = true;
+        for (auto element = root; element != nullptr;) {
+            if (const auto it = by_name.find({element->name(), element->name_size()}); it != by_name.end()) {
+                for (const auto& compiled : it->second) {
+                    if (!ancestors_match(element, compiled.ancestors) || (compiled.rule->applies != nullptr && !compiled.rule->applies(element)))
+                        continue;
+                    if (check(element, *compiled.rule, errors))
+                        continue;
+                    if (errors == nullptr)
+                        return false;
+                    ok = false;
+                }
+            }
+            // Next element in document order, without recursion
+            auto next = element->first_node();
+            while (next != nullptr && next->type() != node_element)
+                next = next->next_sibling();
+            for (auto up = element; next == nullptr && up != root; up = up->parent()) {
+                next = up->next_sibling();
+                while (next != nullptr && next->type() != node_element)
+                    next = next->next_sibling();
+            }
+            element = next;
+        }
+        return ok;
+    }
+};
+} // namespace impl
+
+/// A domain whose unchecked accessors are known to be safe: every attribute they dereference exists and holds a value they can convert
+/// Only obtainable through validate(), which checks the whole document once, so the accessors never have to check again
+class ValidatedDomain : public Domain {
+    explicit ValidatedDomain(Domain dom) noexcept : Domain(dom) {}
+
+  public:
+    [[nodiscard]] static std::optional<ValidatedDomain> validate(Domain dom, std::vector<ValidationError>* errors = nullptr) {
+        const auto root = NodeAccess::of(dom);
+        if (root == nullptr)
+            return std::nullopt;
+        if (!impl::DomainValidator::instance().run(root, errors))
+            return std::nullopt;
+        return ValidatedDomain{dom};
+    }
+};
+
+/// Validates `dom` in a single pass; stops at the first problem unless `errors` is given, in which case all of them are appended to it
+[[nodiscard]] inline std::optional<ValidatedDomain> validate(Domain dom, std::vector<ValidationError>* errors = nullptr) {
+    return ValidatedDomain::validate(dom, errors);
+}
+
+} // namespace
+} // namespace virtxml
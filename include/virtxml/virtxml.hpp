@@ -1,10 +1,35 @@
 #pragma once
 
+#include "address_index.hpp"
+#include "assignability.hpp"
+#include "backing_chain.hpp"
+#include "bandwidth_aggregator.hpp"
 #include "basic.hpp"
 #include "capabilities.hpp"
+#include "catalog.hpp"
+#include "compact_document.hpp"
 #include "device.hpp"
+#include "device_graph.hpp"
+#include "disk_conflicts.hpp"
 #include "domain.hpp"
+#include "domain_capabilities.hpp"
+#include "fleet.hpp"
+#include "frozen.hpp"
 #include "generic.hpp"
+#include "intern.hpp"
+#include "json.hpp"
+#include "mac_index.hpp"
+#include "network_index.hpp"
+#include "node_ref.hpp"
+#include "path.hpp"
+#include "push_parser.hpp"
+#include "schema.hpp"
 #include "secret.hpp"
+#include "secret_index.hpp"
+#include "shared_snapshot.hpp"
+#include "snapshot.hpp"
+#include "storage_pool.hpp"
+#include "validated_domain.hpp"
+#include "watcher.hpp"
 #include "xmlspan.hpp"
 #include "xmlval.hpp"
\ No newline at end of file
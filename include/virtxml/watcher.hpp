@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <rapidxml_ns.hpp>
+#include "catalog.hpp"
+
+namespace virtxml {
+inline namespace {
+
+/// Keeps DomainCatalogs in sync with directories of libvirt XML files, such as /etc/libvirt/qemu or /var/run/libvirt/qemu
+/// Uses inotify to learn which files changed; a file is only re-read once it has been quiet for the debounce delay,
+/// so the rename-over and rewrite sequences libvirt performs cost one parse, and at most `max_batch` files are parsed per poll()
+/// Linux only; not thread-safe itself, but the catalogs it publishes to may be read from any thread meanwhile
+class DomainDirectoryWatcher {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /// What a poll() applied to the catalogs
+    struct Changes {
+        std::size_t published = 0;
+        std::size_t erased = 0;
+        std::size_t failed = 0; // unreadable, malformed or UUID-less files; the catalog keeps their previous version
+    };
+
+  private:
+    static constexpr std::uint32_t events = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR;
+
+    struct Directory {
+        std::string path;
+        DomainCatalog* catalog;
+        std::unordered_map<std::string, DomainCatalog::Key> files; // as last published
+        std::map<DomainCatalog::Key, std::size_t> backing;         // number of files last published with each UUID
+    };
+
+    int fd;
+    std::chrono::milliseconds debounce;
+    std::size_t max_batch;
+    std::unordered_map<int, Directory> directories; // by watch descriptor
+    std::map<std::pair<int, std::string>, Clock::time_point> pending; // file to the time it may be applied
+
+    [[nodiscard]] static inline bool is_xml(std::string_view name) noexcept {
+        return name.size() > 4 && name.substr(name.size() - 4) == ".xml" && name.front() != '.';
+    }
+
+    void schedule(int wd, std::string name, Clock::time_point when) { pending.insert_or_assign({wd, std::move(name)}, when); }
+
+    /// Schedules every file of the directory, present or previously published, so that the next poll reconciles it
+    void rescan(int wd, const Directory& dir, Clock::time_point when) {
+        for (const auto& [name, uuid] : dir.files)
+            schedule(wd, name, when);
+        const auto stream = opendir(dir.path.c_str());
+        if (stream == nullptr)
+            return;
+        while (const auto entry = readdir(stream))
+            if (is_xml(entry->d_name))
+                schedule(wd, entry->d_name, when);
+        closedir(stream);
+    }
+
+    /// Drops a file's claim on `uuid`: the catalog entry goes with the last file backing it,
+    /// and is otherwise republished from one of the remaining files, as it may hold the version of the file that went
+    void release(Directory& dir, DomainCatalog::Key uuid, Changes& changes) {
+        const auto count = dir.backing.find(uuid);
+        if (--count->second == 0) {
+            dir.backing.erase(count);
+            dir.catalog->erase(uuid);
+            ++changes.erased;
+            return;
+        }
+        const auto other = std::find_if(dir.files.begin(), dir.files.end(), [&](const auto& file) { return file.second == uuid; });
+        apply(dir, std::string{other->first}, changes);
+    }
+
+    void forget(Directory& dir, const std::string& name, Changes& changes) {
+        const auto it = dir.files.find(name);
+        if (it == dir.files.end())
+            return;
+        const auto uuid = it->second;
+        dir.files.erase(it);
+        release(dir, uuid, changes);
+    }
+
+    void apply(Directory& dir, const std::string& name, Changes& changes) {
+        std::ifstream file{dir.path + '/' + name, std::ios::binary};
+        if (!file) {
+            forget(dir, name, changes);
+            return;
+        }
+        std::ostringstream text;
+        text << file.rdbuf();
+        std::unique_ptr<const DomainDocument> doc;
+        try {
+            doc = std::make_unique<const DomainDocument>(std::move(text).str());
+        } catch (const rapidxml_ns::parse_error&) {
+            ++changes.failed;
+            return;
+        }
+        const auto uuid = doc->uuid();
+        if (uuid == 0 || !dir.catalog->publish(std::move(doc))) {
+            ++changes.failed;
+            return;
+        }
+        ++changes.published;
+        const auto [it, added] = dir.files.try_emplace(name, uuid);
+        if (!added && it->second == uuid)
+            return;
+        ++dir.backing[uuid];
+        if (!added)
+            release(dir, std::exchange(it->second, uuid), changes);
+    }
+
+    /// Drains the inotify queue without blocking
+    void read_events(Clock::time_point now) {
+        alignas(inotify_event) char buffer[16 * 1024];
+        for (;;) {
+            const auto size = ::read(fd, buffer, sizeof(buffer));
+            if (size <= 0)
+                return;
+            for (auto ptr = buffer; ptr < buffer + size;) {
+                const auto& event = *reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event) + event.len;
+                if ((event.mask & IN_Q_OVERFLOW) != 0) {
+                    for (const auto& [wd, dir] : directories)
+                        rescan(wd, dir, now + debounce);
+                    continue;
+                }
+                if ((event.mask & IN_IGNORED) != 0) {
+                    // The directory itself went away; so did everything published from it
+                    if (const auto it = directories.find(event.wd); it != directories.end()) {
+                        for (const auto& [name, uuid] : it->second.files)
+                            it->second.catalog->erase(uuid);
+                        directories.erase(it);
+                    }
+                    continue;
+                }
+                if (event.len != 0 && directories.count(event.wd) != 0 && is_xml(event.name))
+                    schedule(event.wd, event.name, now + debounce);
+            }
+        }
+    }
+
+  public:
+    explicit DomainDirectoryWatcher(std::chrono::milliseconds debounce = std::chrono::milliseconds{200}, std::size_t max_batch = 64) noexcept
+        : fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)), debounce(debounce), max_batch(std::max<std::size_t>(1, max_batch)) {}
+    DomainDirectoryWatcher(const DomainDirectoryWatcher&) = delete;
+    DomainDirectoryWatcher& operator=(const DomainDirectoryWatcher&) = delete;
+    ~DomainDirectoryWatcher() {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    /// False if inotify could not be initialized; errno tells why
+    [[nodiscard]] inline bool valid() const noexcept { return fd >= 0; }
+    /// Readable when events are queued, for use with an external poll or epoll loop
+    [[nodiscard]] inline int native_handle() const noexcept { return fd; }
+    /// Files waiting for their debounce delay or for a batch
+    [[nodiscard]] inline std::size_t backlog() const noexcept { return pending.size(); }
+
+    /// Starts watching `path`, whose *.xml files are published to `catalog` by the next poll()
+    /// Returns false, with errno set, if the directory cannot be watched
+    bool watch(const std::string& path, DomainCatalog& catalog) {
+        if (fd < 0)
+            return false;
+        const auto wd = inotify_add_watch(fd, path.c_str(), events);
+        if (wd < 0)
+            return false;
+        const auto [it, added] = directories.try_emplace(wd, Directory{path, &catalog, {}});
+        if (!added) {
+            errno = EEXIST;
+            return false;
+        }
+        rescan(wd, it->second, Clock::now());
+        return true;
+    }
+
+    /// Waits up to `timeout` for changes, then applies those whose files have been quiet long enough
+    /// Returns as soon as a batch was applied, or once the timeout elapsed
+    Changes poll(std::chrono::milliseconds timeout) {
+        const auto deadline = Clock::now() + timeout;
+        Changes changes;
+        for (;;) {
+            auto now = Clock::now();
+            auto wake = deadline;
+            for (const auto& [file, when] : pending)
+                wake = std::min(wake, when);
+            if (wake > now) {
+                pollfd pfd{fd, POLLIN, 0};
+                const auto wait = std::chrono::ceil<std::chrono::milliseconds>(wake - now).count();
+                ::poll(&pfd, 1, static_cast<int>(std::min<decltype(wait)>(wait, 1 << 30)));
+                now = Clock::now();
+            }
+            read_events(now);
+
+            std::size_t batch = 0;
+            for (auto it = pending.begin(); it != pending.end() && batch < max_batch;) {
+                if (it->second > now) {
+                    ++it;
+                    continue;
+                }
+                if (const auto dir = directories.find(it->first.first); dir != directories.end())
+                    apply(dir->second, it->first.second, changes);
+                it = pending.erase(it);
+                ++batch;
+            }
+            if (batch != 0 || now >= deadline)
+                return changes;
+        }
+    }
+};
+
+} // namespace
+} // namespace virtxml
@@ -7,13 +7,19 @@
 namespace virtxml {
 using namespace rapidxml_ns;
 template <typename C, typename T> class NamedSpan;
+template <typename C, typename T> class ChildSpan;
 
 namespace impl {
 template <typename C, typename T> class NamedSpanIt {
     friend NamedSpan<C, T>;
-    xml_node<T>* node;
+    NodeRef node;
 
   public:
+    constexpr explicit NamedSpanIt(NodeRef node) noexcept : node(node) {}
+
+    constexpr bool operator==(const NamedSpanIt& oth) const noexcept { return node == oth.node; }
+    constexpr bool operator!=(const NamedSpanIt& oth) const noexcept { return node != oth.node; }
+
     auto& operator++() noexcept {
         node = node->next_sibling(node->name(), node->name_size());
         return *this;
@@ -45,8 +51,36 @@ template <typename C, typename T> class NamedSpanIt {
     using operator*() = C{node};
 
 #endif
+};
+
+template <typename C, typename T> class ChildSpanIt {
+    friend ChildSpan<C, T>;
+    NodeRef node;
+
+    static NodeRef skip(NodeRef node) noexcept {
+        while (node != nullptr && node->type() != node_element)
+            node = node->next_sibling();
+        return node;
+    }
+
+  public:
+    explicit ChildSpanIt(NodeRef node) noexcept : node(skip(node)) {}
+
+    constexpr bool operator==(const ChildSpanIt& oth) const noexcept { return node == oth.node; }
+    constexpr bool operator!=(const ChildSpanIt& oth) const noexcept { return node != oth.node; }
+
+    auto& operator++() noexcept {
+        node = skip(node->next_sibling());
+        return *this;
+    }
+
+    const auto operator++(int) noexcept {
+        const auto old = ChildSpanIt{node};
+        node = skip(node->next_sibling());
+        return old;
+    }
 
-    constexpr static NamedSpanIt end = {nullptr};
+    C operator*() const { return C{node}; }
 };
 
 } // namespace impl
@@ -56,22 +90,31 @@ template <typename C, typename T = char> class NamedSpan : public Node {
     gsl::czstring<> name;
 
   public:
-    constexpr explicit NamedSpan(gsl::czstring<> name, xml_node<T>* node) : name(name), Node(node){};
+    constexpr explicit NamedSpan(gsl::czstring<> name, NodeRef node) : name(name), Node(node){};
 
 #if 1 /* With functions */
 
-    auto begin() const { return impl::NamedSpanIt<C, T>{node->first_node(name)}; }
-    auto begin() { return impl::NamedSpanIt<C, T>{node->first_node(name)}; }
-    auto rbegin() const { return std::make_reverse_iterator(impl::NamedSpanIt<C, T>{node->last_node(name)}); }
-    auto rbegin() { return std::make_reverse_iterator(impl::NamedSpanIt<C, T>{node->last_node(name)}); }
-    constexpr auto end() const noexcept { return impl::NamedSpanIt<C, T>::end; }
-    constexpr auto rend() const noexcept { return impl::NamedSpanIt<C, T>::end; }
+    auto begin() const { return impl::NamedSpanIt<C, T>{node != nullptr ? node->first_node(name) : nullptr}; }
+    auto begin() { return impl::NamedSpanIt<C, T>{node != nullptr ? node->first_node(name) : nullptr}; }
+    auto rbegin() const { return std::make_reverse_iterator(impl::NamedSpanIt<C, T>{node != nullptr ? node->last_node(name) : nullptr}); }
+    auto rbegin() { return std::make_reverse_iterator(impl::NamedSpanIt<C, T>{node != nullptr ? node->last_node(name) : nullptr}); }
+    constexpr auto end() const noexcept { return impl::NamedSpanIt<C, T>{nullptr}; }
+    constexpr auto rend() const noexcept { return impl::NamedSpanIt<C, T>{nullptr}; }
 
 #else /* With paramexpr */
 
     using begin(this s) = node != nullptr ? impl::NamedSpanIt<C, T>{s.node->first_node(name)} : end();
-    using end() = impl::NamedSpanIt<C, T>::end;
+    using end() = impl::NamedSpanIt<C, T>{nullptr};
 
 #endif
 };
+
+/// Span over every element child of a node, whatever its name
+template <typename C, typename T = char> class ChildSpan : public Node {
+  public:
+    constexpr explicit ChildSpan(NodeRef node) : Node(node){};
+
+    auto begin() const { return impl::ChildSpanIt<C, T>{node != nullptr ? node->first_node() : nullptr}; }
+    constexpr auto end() const noexcept { return impl::ChildSpanIt<C, T>{nullptr}; }
+};
 } // namespace virtxml
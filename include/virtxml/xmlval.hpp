@@ -1,5 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <string>
 #include <string_view>
 #include <gsl/gsl>
 #include <magic_enum.hpp>
@@ -11,20 +16,26 @@ using namespace rapidxml_ns;
 
 struct Value {
     constexpr Value(xml_base<>* item) : item(item) {}
+    constexpr Value(NodeRef item) : item(item) {}
+    constexpr Value(AttributeRef item) : item(item) {}
 #if 1 /* With functions */
     constexpr explicit operator bool() const noexcept { return item != nullptr; }
 #else /* With paramexpr */
     using operator bool(this s) = s.item != nullptr;
 #endif
   protected:
-    xml_base<>* item;
+    ValueRef item;
 };
 
 struct String : public Value {
 #if 1 /* With functions */
     inline explicit operator std::string_view() const noexcept { return {item->value(), item->value_size()}; }
+    [[nodiscard]] inline std::string_view value_or(std::string_view def) const noexcept {
+        return item != nullptr ? std::string_view{item->value(), item->value_size()} : def;
+    }
 #else /* With paramexpr */
     using operator std::string_view(this s) = std::string_view{item->value(), item->value_size()};
+    using value_or(this s, std::string_view def) = s.item != nullptr ? std::string_view{s.item->value(), s.item->value_size()} : def;
 #endif
 };
 
@@ -40,10 +51,23 @@ struct StringNode : public Node {
 #endif
 };
 
+/// Base to read the integer starting `str` in, after any leading space and sign: 16 if 0x-prefixed, else 10
+/// libvirt numbers are decimal unless 0x-prefixed; base 0 would take "010" for octal
+[[nodiscard]] constexpr int integer_base(std::string_view str) noexcept {
+    str.remove_prefix(std::min(str.find_first_not_of(" \t\r\n"), str.size()));
+    if (!str.empty() && (str.front() == '-' || str.front() == '+'))
+        str.remove_prefix(1);
+    return str.size() > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X') ? 16 : 10;
+}
+
 struct Integral : public Value {
 #if 1 /* With functions */
-    inline explicit operator signed long long() const noexcept { return std::strtol(item->value(), nullptr, 0); }
-    inline explicit operator unsigned long long() const noexcept { return std::strtoul(item->value(), nullptr, 0); }
+    inline explicit operator signed long long() const noexcept {
+        return std::strtoll(item->value(), nullptr, integer_base({item->value(), item->value_size()}));
+    }
+    inline explicit operator unsigned long long() const noexcept {
+        return std::strtoull(item->value(), nullptr, integer_base({item->value(), item->value_size()}));
+    }
     inline explicit operator int() const noexcept { return static_cast<signed long long>(*this); }
     inline explicit operator unsigned() const noexcept { return static_cast<unsigned long long>(*this); }
 #else /* With paramexpr */
@@ -52,6 +76,52 @@ struct Integral : public Value {
 #endif
 };
 
+/// Multiplier of a libvirt scaled-integer unit: "b" or "bytes", then k, M, G, T, P or E (any case) alone or followed by "iB" for powers of 1024,
+/// or followed by "B" for powers of 1000; empty for anything else
+[[nodiscard]] constexpr std::optional<std::uint64_t> unit_scale(std::string_view unit) noexcept {
+    const auto lower = [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+    if (unit.size() == 1 && lower(unit[0]) == 'b')
+        return 1;
+    if (unit.size() == 5 && lower(unit[0]) == 'b' && lower(unit[1]) == 'y' && lower(unit[2]) == 't' && lower(unit[3]) == 'e' && lower(unit[4]) == 's')
+        return 1;
+    if (unit.empty())
+        return std::nullopt;
+    constexpr std::string_view prefixes = "kmgtpe";
+    const auto power = prefixes.find(lower(unit[0]));
+    if (power == std::string_view::npos)
+        return std::nullopt;
+    std::uint64_t base = 1024;
+    if (unit.size() == 2 && lower(unit[1]) == 'b')
+        base = 1000;
+    else if (unit.size() != 1 && !(unit.size() == 3 && lower(unit[1]) == 'i' && lower(unit[2]) == 'b'))
+        return std::nullopt;
+    std::uint64_t ret = 1;
+    for (std::size_t i = 0; i <= power; ++i)
+        ret *= base;
+    return ret;
+}
+
+/// An integral element scaled by its `unit` attribute, as used for memory and storage sizes
+struct ScaledIntegral : public Integral {
+#if 1 /* With functions */
+    [[nodiscard]] inline Optional<String> unit() const noexcept { return String{item.node()->first_attribute("unit")}; }
+    /// The value in bytes, `default_scale` applying without a unit; empty if the value is negative, the unit is unknown or the result overflows
+    [[nodiscard]] inline std::optional<std::uint64_t> bytes(std::uint64_t default_scale = 1) const noexcept {
+        const auto text = std::string_view{item->value(), item->value_size()};
+        if (const auto first = text.find_first_not_of(" \t\r\n"); first != std::string_view::npos && text[first] == '-')
+            return std::nullopt; // strtoull would wrap it around
+        const auto unit_attr = item.node()->first_attribute("unit");
+        const auto scale = unit_attr ? unit_scale({unit_attr->value(), unit_attr->value_size()}) : std::optional{default_scale};
+        const auto value = static_cast<unsigned long long>(*this);
+        if (!scale || (*scale != 0 && value > ~std::uint64_t{0} / *scale))
+            return std::nullopt;
+        return value * *scale;
+    }
+#else /* With paramexpr */
+    using unit(this s) = String{s.item.node()->first_attribute("unit")};
+#endif
+};
+
 enum class YesNo : bool {
     no = false,
     yes = true,
@@ -69,62 +139,216 @@ struct Uuid : public String {
 #else
     using form(this s) = item->value_size() == 32u ? Form::Packed : Form::Dashed;
 #endif
+    /// The 32 hex digits, first digit most significant; dashes are skipped
     inline explicit operator __uint128_t() const noexcept {
         __uint128_t ret{};
-        const auto sv = static_cast<std::string_view>(*this);
-        if (form() == Form::Packed) {
-            for (auto i = 0u; i < 32u; ++i)
-                ret |= hexc2b(sv[i]) << (i * 4u);
-        } else {
-            unsigned quadbit_off = 0;
-            for (auto i = 0ull; i < sv.size(); ++i) {
-                if (sv[i] == '-')
-                    ++quadbit_off;
-                else
-                    ret |= hexc2b(sv[i - quadbit_off]) << (i * 4u);
-            }
-        }
+        for (const auto c : static_cast<std::string_view>(*this))
+            if (c != '-')
+                ret = ret << 4u | hexc2b(c);
         return ret;
     }
 
   private:
     [[nodiscard]] inline constexpr unsigned char hexc2b(char hexc) const noexcept {
         if (hexc >= 'a' && hexc <= 'f')
-            return 'a' - hexc + 0xa;
+            return hexc - 'a' + 0xa;
         if (hexc >= 'A' && hexc <= 'F')
-            return 'A' - hexc + 0xA;
-        return '0' - hexc;
+            return hexc - 'A' + 0xA;
+        return hexc - '0';
+    }
+};
+
+namespace impl {
+// SWAR decoding of 8 ASCII hex digits, first digit in the lowest byte; 4 octets out, or nothing on a non-hex digit
+[[nodiscard]] constexpr std::optional<std::uint32_t> hex8_to_octets(std::uint64_t w) noexcept {
+    constexpr std::uint64_t ones = 0x0101010101010101u;
+    if ((w & ones * 0x80u) != 0)
+        return std::nullopt;
+    const auto lower = w | ones * 0x20u; // folds 'A'-'F' onto 'a'-'f', but also 0x10-0x19 onto the digits, so these are checked unfolded
+    const auto in_range = [](std::uint64_t v, unsigned lo, unsigned hi) { return (v + ones * (0x80u - lo)) & ~(v + ones * (0x7Fu - hi)); };
+    if (((in_range(w, '0', '9') | in_range(lower, 'a', 'f')) & ones * 0x80u) != ones * 0x80u)
+        return std::nullopt;
+    const auto nibbles = (lower & ones * 0x0Fu) + ((lower >> 6u) & ones) * 9u;
+    const auto octets = ((nibbles << 4u) | (nibbles >> 8u)) & 0x00FF00FF00FF00FFu;
+    return static_cast<std::uint32_t>((octets & 0xFFu) << 24u | (octets >> 16u & 0xFFu) << 16u | (octets >> 32u & 0xFFu) << 8u | (octets >> 48u & 0xFFu));
+}
+} // namespace impl
+
+/// Parses "xx:xx:xx:xx:xx:xx" (':' or '-' separated) into a 48-bit integer, first octet most significant
+[[nodiscard]] constexpr std::optional<std::uint64_t> parse_mac_address(std::string_view str) noexcept {
+    if (str.size() != 17)
+        return std::nullopt;
+    const char sep = str[2];
+    if (sep != ':' && sep != '-')
+        return std::nullopt;
+    std::uint64_t high = 0;
+    std::uint64_t low = 0x3030303030303030u; // padded with '0' digits
+    for (unsigned octet = 0; octet < 6; ++octet) {
+        if (octet != 0 && str[octet * 3 - 1] != sep)
+            return std::nullopt;
+        const auto pair = static_cast<std::uint64_t>(static_cast<unsigned char>(str[octet * 3])) |
+                          static_cast<std::uint64_t>(static_cast<unsigned char>(str[octet * 3 + 1])) << 8u;
+        if (octet < 4)
+            high |= pair << (octet * 16u);
+        else
+            low = (low & ~(0xFFFFull << ((octet - 4) * 16u))) | pair << ((octet - 4) * 16u);
+    }
+    const auto first = impl::hex8_to_octets(high);
+    const auto last = impl::hex8_to_octets(low);
+    if (!first || !last)
+        return std::nullopt;
+    return static_cast<std::uint64_t>(*first) << 16u | *last >> 16u;
+}
+
+struct MacAddress : public String {
+    [[nodiscard]] inline std::optional<std::uint64_t> packed() const noexcept {
+        return item != nullptr ? parse_mac_address(static_cast<std::string_view>(*this)) : std::nullopt;
     }
 };
 
+namespace impl {
+[[nodiscard]] constexpr std::optional<std::uint32_t> parse_ipv4(std::string_view str) noexcept {
+    std::uint32_t ret = 0;
+    for (unsigned part = 0; part < 4; ++part) {
+        if (part != 0) {
+            if (str.empty() || str.front() != '.')
+                return std::nullopt;
+            str.remove_prefix(1);
+        }
+        std::size_t digits = 0;
+        unsigned value = 0;
+        while (digits < str.size() && digits < 4 && str[digits] >= '0' && str[digits] <= '9')
+            value = value * 10 + static_cast<unsigned>(str[digits++] - '0');
+        if (digits == 0 || digits > 3 || value > 255)
+            return std::nullopt;
+        ret = ret << 8u | value;
+        str.remove_prefix(digits);
+    }
+    return str.empty() ? std::optional{ret} : std::nullopt;
+}
+
+/// Appends the colon-separated hex groups of `str` to `groups`; the last one may be a dotted IPv4 address if `ipv4_tail`
+[[nodiscard]] constexpr bool parse_ipv6_groups(std::string_view str, std::uint16_t (&groups)[8], std::size_t& count, bool ipv4_tail) noexcept {
+    while (!str.empty()) {
+        const auto colon = str.find(':');
+        const auto group = str.substr(0, colon);
+        if (colon == std::string_view::npos && ipv4_tail && group.find('.') != std::string_view::npos) {
+            const auto v4 = parse_ipv4(group);
+            if (!v4 || count > 6)
+                return false;
+            groups[count++] = static_cast<std::uint16_t>(*v4 >> 16u);
+            groups[count++] = static_cast<std::uint16_t>(*v4 & 0xFFFFu);
+            return true;
+        }
+        if (group.empty() || group.size() > 4 || count == 8)
+            return false;
+        std::uint16_t value = 0;
+        for (const auto c : group) {
+            const unsigned digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+            if (digit == 16)
+                return false;
+            value = static_cast<std::uint16_t>(value << 4u | digit);
+        }
+        groups[count++] = value;
+        if (colon == std::string_view::npos)
+            return true;
+        str.remove_prefix(colon + 1);
+        if (str.empty()) // trailing colon
+            return false;
+    }
+    return true;
+}
+} // namespace impl
+
+/// Parses a dotted IPv4 or a textual IPv6 address into 128 bits, first byte most significant
+/// IPv4 addresses take their IPv4-mapped form ::ffff:a.b.c.d, so that both families share one key space
+[[nodiscard]] constexpr std::optional<__uint128_t> parse_ip_address(std::string_view str) noexcept {
+    if (str.find(':') == std::string_view::npos) {
+        const auto v4 = impl::parse_ipv4(str);
+        return v4 ? std::optional{__uint128_t{0xFFFFu} << 32u | *v4} : std::nullopt;
+    }
+    std::uint16_t head[8]{};
+    std::uint16_t tail[8]{};
+    std::size_t heads = 0;
+    std::size_t tails = 0;
+    const auto gap = str.find("::");
+    if (gap == std::string_view::npos) {
+        if (!impl::parse_ipv6_groups(str, head, heads, true) || heads != 8)
+            return std::nullopt;
+    } else if (!impl::parse_ipv6_groups(str.substr(0, gap), head, heads, false) || !impl::parse_ipv6_groups(str.substr(gap + 2), tail, tails, true) ||
+               heads + tails > 7) {
+        return std::nullopt;
+    }
+    __uint128_t ret = 0;
+    for (std::size_t i = 0; i < heads; ++i)
+        ret = ret << 16u | head[i];
+    for (auto i = heads + tails; i < 8; ++i) // the groups elided by "::"
+        ret <<= 16u;
+    for (std::size_t i = 0; i < tails; ++i)
+        ret = ret << 16u | tail[i];
+    return ret;
+}
+
+/// Whether `address` is in the IPv4-mapped range, i.e. was parsed from an IPv4 address
+[[nodiscard]] constexpr bool is_ipv4_mapped(__uint128_t address) noexcept { return address >> 32u == 0xFFFFu; }
+
+struct IpAddress : public String {
+    [[nodiscard]] inline std::optional<__uint128_t> packed() const noexcept {
+        return item != nullptr ? parse_ip_address(static_cast<std::string_view>(*this)) : std::nullopt;
+    }
+};
+
+[[nodiscard]] constexpr std::uint32_t pack_pci_address(unsigned domain, unsigned bus, unsigned slot, unsigned function) noexcept {
+    return (domain & 0xFFFFu) << 16u | (bus & 0xFFu) << 8u | (slot & 0x1Fu) << 3u | (function & 0x7u);
+}
+
+/// Whether `str` is an integer Integral reads in full: decimal or 0x-prefixed hexadecimal, optionally signed
+[[nodiscard]] inline bool is_integer(std::string_view str) noexcept {
+    if (!str.empty() && (str.front() == '-' || str.front() == '+'))
+        str.remove_prefix(1);
+    const auto base = static_cast<unsigned>(integer_base(str));
+    if (base == 16)
+        str.remove_prefix(2);
+    if (str.empty())
+        return false;
+    for (const auto c : str) {
+        const unsigned digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+        if (digit >= base)
+            return false;
+    }
+    return true;
+}
+
+/// Enumerator spelled `str` in XML; dashes map to underscores if `underscores`
+/// Enumerators named after C++ keywords carry a trailing underscore, which the bundled magic_enum leaves out of their names
+/// Spellings are rewritten in a buffer on the stack: this is called from noexcept accessors
+template <class E> [[nodiscard]] std::optional<E> enum_cast_xml(std::string_view str, bool underscores = false) noexcept {
+    if (!underscores)
+        return magic_enum::enum_cast<E>(str);
+    char in[64];
+    if (str.size() > sizeof(in))
+        return std::nullopt; // longer than any enumerator
+    std::replace_copy(str.begin(), str.end(), in, '-', '_');
+    return magic_enum::enum_cast<E>(std::string_view{in, str.size()});
+}
+
 template <class T> using void_once = std::void_t<T>;
 
 template <class E, template <class> class O = void_once>
-auto enum_wrap_attr(const xml_node<char>* node, gsl::czstring<> name, bool underscores = false) {
+auto enum_wrap_attr(NodeRef node, gsl::czstring<> name, bool underscores = false) {
     static_assert(std::is_enum_v<E>, "E must be an enum");
     if constexpr (std::is_void_v<O<E>>) {
-        if (underscores) {
-            std::string in{node->first_attribute(name)->value()};
-            std::replace(in.begin(), in.end(), '-', '_');
-            return *magic_enum::enum_cast<E>(in);
-        }
-        return *magic_enum::enum_cast<E>(node->first_attribute(name)->value());
+        const auto attr = node->first_attribute(name);
+        return *enum_cast_xml<E>({attr->value(), attr->value_size()}, underscores);
     } else if constexpr (std::is_same_v<Optional<E>, O<E>>) {
         const auto attr = node->first_attribute(name);
-        if (underscores) {
-            if (!attr)
-                return std::optional<E>{std::nullopt};
-            std::string in{attr->value()};
-            std::replace(in.begin(), in.end(), '-', '_');
-            return magic_enum::enum_cast<E>(in);
-        }
-        return attr ? magic_enum::enum_cast<E>(attr->value()) : std::nullopt;
+        return attr ? enum_cast_xml<E>({attr->value(), attr->value_size()}, underscores) : std::nullopt;
     } else {
         static_assert(!std::is_void_v<E>, "O shall be default or Optional"); // always fail
     }
 }
 
-template <class E, template <class> class O = void_once> auto bool_wrap_attr(const xml_node<char>* node, gsl::czstring<> name) {
+template <class E, template <class> class O = void_once> auto bool_wrap_attr(NodeRef node, gsl::czstring<> name) {
     static_assert(std::is_same_v<std::underlying_type_t<E>, bool>, "Enum type must be have bool as its underlying type");
     if constexpr (std::is_void_v<O<bool>>) {
         return static_cast<bool>(*magic_enum::enum_cast<E>(node->first_attribute(name)->value()));
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <virtxml/address_index.hpp>
+#include <virtxml/catalog.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+DomainDocument domain_with(const char* devices) { return DomainDocument{test::DomainXml{}.uuid(1).devices(devices).str()}; }
+} // namespace
+
+TEST(AddressIndex, SeparatesDrivesOfDistinctControllerTypes) {
+    const auto doc = domain_with(R"(
+      <disk type='file' device='cdrom'><target dev='hda' bus='ide'/><address type='drive' controller='0' bus='0' target='0' unit='0'/></disk>
+      <disk type='file' device='disk'><target dev='sda' bus='scsi'/><address type='drive' controller='0' bus='0' target='0' unit='0'/></disk>
+      <disk type='file' device='disk'><target dev='sdb' bus='sata'/><address type='drive' controller='0' bus='0' target='0' unit='0'/></disk>
+      <hostdev mode='subsystem' type='scsi'><address type='drive' controller='0' bus='0' target='0' unit='1'/></hostdev>)");
+    const auto index = index_guest_addresses(doc.domain());
+    EXPECT_EQ(index.size(), 4u);
+    EXPECT_TRUE(index.conflicts().empty());
+    EXPECT_TRUE(index.find(PackedAddress::drive(PackedAddress::DriveController::ide, 0, 0, 0, 0)));
+    EXPECT_TRUE(index.find(PackedAddress::drive(PackedAddress::DriveController::scsi, 0, 0, 0, 1)));
+    EXPECT_FALSE(index.find(PackedAddress::drive(PackedAddress::DriveController::fdc, 0, 0, 0, 0)));
+}
+
+TEST(AddressIndex, ReportsDrivesSharingAController) {
+    // The second disk has no bus, which libvirt infers from its target name
+    const auto doc = domain_with(R"(
+      <disk type='file' device='disk'><target dev='sda' bus='scsi'/><address type='drive' controller='0' bus='0' target='0' unit='0'/></disk>
+      <disk type='file' device='disk'><target dev='sdb'/><address type='drive' controller='0' bus='0' target='0' unit='0'/></disk>
+      <hostdev mode='subsystem' type='scsi'><address type='drive' controller='0' bus='0' target='0' unit='0'/></hostdev>)");
+    const auto index = index_guest_addresses(doc.domain());
+    EXPECT_EQ(index.size(), 1u);
+    EXPECT_EQ(index.conflicts().size(), 2u);
+}
+
+TEST(AddressIndex, PinsPciAddressesGivingABusAndSlot) {
+    // Both pin 0000:00:00.0 explicitly; the others leave their slot to libvirt, as does one lacking its bus
+    const auto doc = domain_with(R"(
+      <interface type='network'><source network='default'/><address type='pci' domain='0' bus='0' slot='0' function='0'/></interface>
+      <interface type='network'><source network='default'/><address type='pci' domain='0x0000' bus='0x00' slot='0x00' function='0x0'/></interface>
+      <interface type='network'><source network='default'/><address type='pci'/></interface>
+      <interface type='network'><source network='default'/><address type='pci'/></interface>
+      <interface type='network'><source network='default'/><address type='pci' slot='0'/></interface>)");
+    const auto index = index_guest_addresses(doc.domain());
+    EXPECT_EQ(index.size(), 1u);
+    ASSERT_EQ(index.conflicts().size(), 1u);
+    EXPECT_EQ(index.conflicts().front().address, PackedAddress::pci(0, 0, 0, 0));
+}
+
+TEST(PackedAddress, UnpacksDriveFields) {
+    const auto addr = PackedAddress::drive(PackedAddress::DriveController::sata, 2, 0, 3, 5);
+    EXPECT_EQ(addr.drive_controller_type(), PackedAddress::DriveController::sata);
+    EXPECT_EQ(addr.drive_controller(), 2u);
+    EXPECT_EQ(addr.drive_bus(), 0u);
+    EXPECT_EQ(addr.drive_target(), 3u);
+    EXPECT_EQ(addr.drive_unit(), 5u);
+}
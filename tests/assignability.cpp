@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <virtxml/assignability.hpp>
+#include <virtxml/catalog.hpp>
+#include <virtxml/device.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+std::string pci_device(const char* name, const char* address, unsigned group, const char* driver) {
+    return std::string{"<device><name>"} + name + "</name><parent>computer</parent><driver><name>" + driver +
+           "</name></driver><capability type='pci'>" + address + "<iommuGroup number='" + std::to_string(group) + "'/></capability></device>";
+}
+
+std::string hostdev_domain(const char* name, const char* slot) {
+    const auto hostdev = std::string{"<hostdev mode='subsystem' type='pci'><source><address domain='0' bus='0' slot='"} + slot +
+                         "' function='0'/></source></hostdev>";
+    return test::DomainXml{name}.uuid(1).devices(hostdev).str();
+}
+
+constexpr auto at_zero = "<domain>0</domain><bus>0</bus><slot>0</slot><function>0</function>";
+constexpr auto at_two = "<domain>0</domain><bus>0</bus><slot>2</slot><function>0</function>";
+constexpr auto no_function = "<domain>0</domain><bus>0</bus><slot>3</slot>";
+} // namespace
+
+class AssignabilityTest : public ::testing::Test {
+  protected:
+    // 0000:00:00.0 alone in group 1; 0000:00:02.0 in group 2 with a member whose address is incomplete
+    std::vector<std::string> texts{pci_device("pci_0000_00_00_0", at_zero, 1, "vfio-pci"), pci_device("pci_0000_00_02_0", at_two, 2, "vfio-pci"),
+                                   pci_device("pci_0000_00_03_x", no_function, 2, "vfio-pci")};
+    std::vector<std::unique_ptr<xml_document<>>> docs;
+    std::vector<Device> devices;
+    std::unique_ptr<DeviceGraph> graph;
+
+    void SetUp() override {
+        for (auto& text : texts) {
+            docs.push_back(std::make_unique<xml_document<>>());
+            docs.back()->parse<0>(text.data());
+            devices.push_back(Device{docs.back()->first_node("device")});
+        }
+        graph = std::make_unique<DeviceGraph>(devices);
+    }
+};
+
+TEST_F(AssignabilityTest, IgnoresMembersWithoutPciAddress) {
+    const DomainDocument a{hostdev_domain("a", "0")};
+    const DomainDocument b{hostdev_domain("b", "0")};
+    AssignabilityChecker<> checker{*graph};
+    checker.add_domain("a", a.domain());
+    // The member without an address used to stand for 0000:00:00.0, which "a" holds
+    EXPECT_TRUE(checker.can_assign(pack_pci_address(0, 0, 2, 0), "c"));
+
+    checker.add_domain("b", b.domain());
+    const DomainDocument c{hostdev_domain("c", "2")};
+    checker.add_domain("c", c.domain());
+    // 0000:00:00.0 is shared, which splits group 1, but group 2 is whole
+    const auto conflicts = checker.conflicts();
+    EXPECT_EQ(conflicts.size(), 2u);
+    for (const auto& conflict : conflicts)
+        EXPECT_EQ(conflict.iommu_group, 1u);
+}
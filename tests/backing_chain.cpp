@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <virtxml/backing_chain.hpp>
+#include <virtxml/catalog.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+std::string backing_store(std::string_view index, std::string_view format, std::string_view file, std::string_view next) {
+    return "<backingStore type='file' index='" + std::string{index} + "'><format type='" + std::string{format} + "'/><source file='" +
+           std::string{file} + "'/>" + std::string{next} + "</backingStore>";
+}
+std::string qcow2_disk(std::string_view target, std::string_view backing) {
+    return "<disk type='file' device='disk'><driver name='qemu' type='qcow2'/><source file='/" + std::string{target} + ".qcow2'/>" +
+           std::string{backing} + "<target dev='" + std::string{target} + "'/></disk>";
+}
+
+/// vda has a chain ended by an empty <backingStore/>, vdb one whose index is too large to look up, vdc none
+std::string domain_xml() {
+    const auto vda = backing_store("3", "qcow2", "/mid.qcow2", backing_store("1", "raw", "/base.img", "<backingStore/>"));
+    const auto vdb = backing_store("70000", "qcow2", "/far.qcow2", "");
+    return test::DomainXml{}.uuid(1).devices(qcow2_disk("vda", vda)).devices(qcow2_disk("vdb", vdb)).devices(qcow2_disk("vdc", "")).str();
+}
+
+std::string_view file_of(const BackingChain::Layer& layer) { return static_cast<std::string_view>(layer.source.file()); }
+} // namespace
+
+class BackingChainTest : public ::testing::Test {
+  protected:
+    DomainDocument doc{domain_xml()};
+    std::vector<BackingChain> chains;
+
+    void SetUp() override {
+        for (const auto disk : doc.domain().devices().disks())
+            chains.emplace_back(disk);
+    }
+};
+
+TEST_F(BackingChainTest, StopsAtAnEmptyBackingStore) {
+    ASSERT_EQ(chains.size(), 3u);
+    const auto& chain = chains[0];
+    ASSERT_EQ(chain.size(), 3u);
+    EXPECT_EQ(chain.depth(), 2u);
+    EXPECT_EQ(file_of(chain.leaf()), "/vda.qcow2");
+    EXPECT_FALSE(chain.leaf().index);
+    EXPECT_EQ(chain.leaf().format, storage::Format::qcow2);
+    EXPECT_EQ(file_of(chain[1]), "/mid.qcow2");
+    EXPECT_EQ(chain[1].index, 3u);
+    EXPECT_EQ(file_of(chain.base()), "/base.img");
+    EXPECT_EQ(chain.base().format, storage::Format::raw);
+    EXPECT_EQ(chain.base().type, Domain::Devices::Disk::Type::file);
+}
+
+TEST_F(BackingChainTest, FindsLayersByIndex) {
+    const auto& chain = chains[0];
+    ASSERT_NE(chain.find_index(3), nullptr);
+    EXPECT_EQ(file_of(*chain.find_index(3)), "/mid.qcow2");
+    EXPECT_EQ(chain.find_index(1), &chain.base());
+    EXPECT_EQ(chain.find_index(0), nullptr);
+    EXPECT_EQ(chain.find_index(2), nullptr);
+    EXPECT_EQ(chain.find_index(4), nullptr);
+
+    // An index past the largest one kept is still walked, but cannot be looked up
+    EXPECT_EQ(chains[1].depth(), 1u);
+    EXPECT_EQ(chains[1].base().index, 70000u);
+    EXPECT_EQ(chains[1].find_index(70000), nullptr);
+}
+
+TEST_F(BackingChainTest, HasNoDepthWithoutBackingStores) {
+    const auto& chain = chains[2];
+    EXPECT_EQ(chain.size(), 1u);
+    EXPECT_EQ(chain.depth(), 0u);
+    EXPECT_EQ(&chain.base(), &chain.leaf());
+    EXPECT_EQ(file_of(chain.base()), "/vdc.qcow2");
+    EXPECT_EQ(chain.find_index(0), nullptr);
+    EXPECT_EQ(chain.begin() + 1, chain.end());
+}
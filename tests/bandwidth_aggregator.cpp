@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <optional>
+#include <string>
+#include <vector>
+#include <virtxml/bandwidth_aggregator.hpp>
+#include <virtxml/catalog.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+/// Interface on the network `network`, carrying `vlans` and reserving `floor` KiB/s each way
+std::string network_iface(const char* network, const char* vlans, unsigned floor) {
+    return std::string{"<interface type='network'><source network='"} + network + "'/><vlan trunk='yes'>" + vlans +
+           "</vlan><bandwidth><inbound average='1000' floor='" + std::to_string(floor) + "'/><outbound average='500' floor='" +
+           std::to_string(floor) + "'/></bandwidth></interface>";
+}
+
+Domain::Devices::Interface first_interface(const DomainDocument& doc) { return *doc.domain().devices().interfaces().begin(); }
+
+const Uplink default_net{Uplink::Kind::network, "default"};
+} // namespace
+
+TEST(Uplink, SkipsInterfacesOfUnknownOrMissingType) {
+    const DomainDocument doc{test::DomainXml{}
+                                 .uuid(1)
+                                 .devices("<interface type='vdpa'><source dev='/dev/vhost-vdpa-0'/></interface>"
+                                          "<interface><source network='default'/></interface>"
+                                          "<interface type='bridge'><source bridge='br0'/></interface>"
+                                          "<interface type='direct'><source dev='eth0' mode='vepa'/></interface>"
+                                          "<interface type='user'/>")
+                                 .str()};
+    std::vector<std::optional<Uplink>> uplinks;
+    for (const auto iface : doc.domain().devices().interfaces())
+        uplinks.push_back(Uplink::of(iface));
+    ASSERT_EQ(uplinks.size(), 5u);
+    EXPECT_FALSE(uplinks[0]);
+    EXPECT_FALSE(uplinks[1]);
+    EXPECT_EQ(uplinks[2], (Uplink{Uplink::Kind::bridge, "br0"}));
+    EXPECT_EQ(uplinks[3], (Uplink{Uplink::Kind::direct, "eth0"}));
+    EXPECT_FALSE(uplinks[4]);
+
+    BandwidthAggregator<> aggregator;
+    aggregator.add_domain("d", doc.domain());
+    EXPECT_EQ(aggregator.all().size(), 2u);
+    EXPECT_TRUE(aggregator.admits(first_interface(doc)));
+}
+
+TEST(BandwidthAggregator, CountsVlansUntilTheirLastInterfaceGoes) {
+    const DomainDocument a{test::DomainXml{"a"}.uuid(1).devices(network_iface("default", "<tag id='10'/><tag id='20'/>", 100)).str()};
+    const DomainDocument b{test::DomainXml{"b"}.uuid(2).devices(network_iface("default", "<tag id='10'/><tag id='4096'/>", 50)).str()};
+    BandwidthAggregator<> aggregator;
+    aggregator.add_domain("a", a.domain());
+    aggregator.add_domain("b", b.domain());
+    aggregator.add_domain("b", b.domain()); // replaces rather than adds again
+
+    auto totals = aggregator.find(default_net);
+    ASSERT_NE(totals, nullptr);
+    EXPECT_EQ(totals->interfaces, 2u);
+    EXPECT_EQ(totals->inbound.average, 2000u);
+    EXPECT_EQ(totals->inbound.floor, 150u);
+    EXPECT_EQ(totals->outbound.floor, 150u);
+    EXPECT_EQ(totals->vlans.count(), 2u); // 4096 is out of range
+    EXPECT_TRUE(totals->vlans.test(10));
+    EXPECT_TRUE(totals->vlans.test(20));
+
+    aggregator.remove_domain("a");
+    totals = aggregator.find(default_net);
+    EXPECT_EQ(totals->interfaces, 1u);
+    EXPECT_EQ(totals->inbound.floor, 50u);
+    EXPECT_TRUE(totals->vlans.test(10));
+    EXPECT_FALSE(totals->vlans.test(20));
+
+    aggregator.remove_domain("b");
+    aggregator.remove_domain("b");
+    EXPECT_EQ(totals->interfaces, 0u);
+    EXPECT_TRUE(totals->vlans.none());
+}
+
+TEST(BandwidthAggregator, AdmitsFloorsWithinCapacity) {
+    const DomainDocument running{test::DomainXml{"running"}.uuid(1).devices(network_iface("default", "", 600)).str()};
+    const DomainDocument small{test::DomainXml{"small"}.uuid(2).devices(network_iface("default", "", 400)).str()};
+    const DomainDocument large{test::DomainXml{"large"}.uuid(3).devices(network_iface("default", "", 401)).str()};
+    const DomainDocument other{test::DomainXml{"other"}.uuid(4).devices(network_iface("isolated", "", 5000)).str()};
+    BandwidthAggregator<> aggregator;
+    aggregator.add_domain("running", running.domain());
+    EXPECT_TRUE(aggregator.admits(first_interface(large))); // no capacity set yet
+
+    aggregator.set_capacity(default_net, {1000, 1000});
+    EXPECT_TRUE(aggregator.admits(first_interface(small)));
+    EXPECT_FALSE(aggregator.admits(first_interface(large)));
+    EXPECT_TRUE(aggregator.admits(first_interface(other)));
+
+    aggregator.remove_domain("running");
+    EXPECT_TRUE(aggregator.admits(first_interface(large)));
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <virtxml/capabilities.hpp>
+#include <virtxml/catalog.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+constexpr auto xen_caps = R"(<capabilities>
+  <host><uuid>00000000-0000-0000-0000-000000000001</uuid></host>
+  <guest>
+    <os_type>xen</os_type>
+    <arch name='x86_64'>
+      <wordsize>64</wordsize>
+      <emulator>/usr/lib/xen/bin/qemu-system-i386</emulator>
+      <machine>xenpv</machine>
+      <domain type='xen'/>
+    </arch>
+  </guest>
+  <guest>
+    <os_type>hvm</os_type>
+    <arch name='x86_64'>
+      <wordsize>64</wordsize>
+      <emulator>/usr/lib/xen/bin/qemu-system-i386</emulator>
+      <machine>xenfv</machine>
+      <domain type='xen'/>
+    </arch>
+  </guest>
+</capabilities>)";
+
+std::string domain_xml(const char* os) { return test::DomainXml{"d", "xen"}.uuid(2).os(os).str(); }
+} // namespace
+
+class GuestTableTest : public ::testing::Test {
+  protected:
+    std::string text = xen_caps;
+    DriverCapabilities caps{text.data()};
+    GuestTable table{caps};
+};
+
+TEST_F(GuestTableTest, KeysDefaultMachinesByOsType) {
+    ASSERT_EQ(table.size(), 2u);
+    const auto pv = table.find(Domain::Os::TypeValue::xen, cpu::Arch::x86_64, Domain::Type::xen);
+    const auto hvm = table.find(Domain::Os::TypeValue::hvm, cpu::Arch::x86_64, Domain::Type::xen);
+    ASSERT_NE(pv, nullptr);
+    ASSERT_NE(hvm, nullptr);
+    EXPECT_EQ(pv->machine, "xenpv");
+    EXPECT_EQ(hvm->machine, "xenfv");
+    EXPECT_EQ(table.find(Domain::Os::TypeValue::hvm, cpu::Arch::x86_64, Domain::Type::xen, "xenpv"), nullptr);
+    EXPECT_FALSE(table.supports(Domain::Os::TypeValue::hvm, cpu::Arch::x86_64, Domain::Type::kvm));
+}
+
+TEST_F(GuestTableTest, FindsHvmXenDomains) {
+    const DomainDocument hvm{domain_xml("<type arch='x86_64'>hvm</type>")};
+    const auto entry = table.find(hvm.domain());
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->os_type, Domain::Os::TypeValue::hvm);
+    EXPECT_EQ(entry->machine, "xenfv");
+
+    const DomainDocument pv{domain_xml("<type arch='x86_64' machine='xenpv'>xen</type>")};
+    ASSERT_NE(table.find(pv.domain()), nullptr);
+    EXPECT_EQ(table.find(pv.domain())->os_type, Domain::Os::TypeValue::xen);
+
+    const DomainDocument mismatched{domain_xml("<type arch='x86_64' machine='xenpv'>hvm</type>")};
+    EXPECT_EQ(table.find(mismatched.domain()), nullptr);
+}
+
+TEST(GuestTable, SkipsIncompleteGuests) {
+    std::string text = R"(<capabilities>
+  <host><uuid>00000000-0000-0000-0000-000000000001</uuid></host>
+  <guest><arch name='x86_64'><machine>pc</machine><domain type='kvm'/></arch></guest>
+  <guest><os_type>hvm</os_type></guest>
+  <guest><os_type>hvm</os_type><arch><machine>pc</machine><domain type='kvm'/></arch></guest>
+  <guest><os_type>hvm</os_type><arch name='x86_64'><machine>pc</machine><domain/><domain type='qemu'/></arch></guest>
+</capabilities>)";
+    const DriverCapabilities caps{text.data()};
+    auto guest = caps.guest_list().begin();
+    EXPECT_FALSE((*guest).os_type());
+    EXPECT_FALSE((*++guest).arch().name()); // no <arch> at all
+    EXPECT_FALSE((*++guest).arch().name());
+    const auto domain = (*++guest).arch().domains().begin();
+    EXPECT_FALSE((*domain).type());
+
+    const GuestTable table{caps};
+    EXPECT_EQ(table.size(), 1u);
+    EXPECT_TRUE(table.supports(Domain::Os::TypeValue::hvm, cpu::Arch::x86_64, Domain::Type::qemu));
+}
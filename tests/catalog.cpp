@@ -0,0 +1,112 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <virtxml/catalog.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+/// Domain whose UUID is the number `id`, named after it and `version`
+std::string domain_xml(unsigned id, unsigned version) {
+    return test::DomainXml{"d" + std::to_string(id) + "-" + std::to_string(version)}.uuid(id).str();
+}
+
+std::string_view name_of(const DomainDocument* doc) { return static_cast<std::string_view>(doc->domain().name()); }
+} // namespace
+
+TEST(DomainCatalog, PublishesReplacesAndErases) {
+    DomainCatalog catalog{4};
+    EXPECT_TRUE(catalog.publish(domain_xml(1, 0)));
+    EXPECT_TRUE(catalog.publish(domain_xml(2, 0)));
+    EXPECT_FALSE(catalog.publish("<domain type='kvm'><name>no-uuid</name></domain>"));
+    {
+        const auto guard = catalog.read();
+        EXPECT_EQ(guard.size(), 2u);
+        ASSERT_NE(guard.find(1), nullptr);
+        EXPECT_EQ(name_of(guard.find(1)), "d1-0");
+        EXPECT_EQ(guard.find(3), nullptr);
+    }
+    EXPECT_TRUE(catalog.publish(domain_xml(1, 1)));
+    EXPECT_TRUE(catalog.erase(2));
+    EXPECT_FALSE(catalog.erase(2));
+    const auto guard = catalog.read();
+    EXPECT_EQ(guard.size(), 1u);
+    EXPECT_EQ(name_of(guard.find(1)), "d1-1");
+    std::size_t seen = 0;
+    guard.for_each([&](DomainCatalog::Key key, const DomainDocument& doc) {
+        EXPECT_EQ(key, 1u);
+        EXPECT_EQ(doc.uuid(), 1u);
+        ++seen;
+    });
+    EXPECT_EQ(seen, 1u);
+}
+
+TEST(DomainCatalog, KeepsWhatAGuardReadUntilItIsReleased) {
+    // Under AddressSanitizer, reading a document reclaimed too early fails the test
+    DomainCatalog catalog{4};
+    catalog.publish(domain_xml(1, 0));
+    catalog.publish(domain_xml(2, 0));
+    const auto pinned = catalog.read();
+    const auto old_version = pinned.find(1);
+    const auto erased = pinned.find(2);
+    for (unsigned version = 1; version < 50; ++version) {
+        catalog.publish(domain_xml(1, version));
+        catalog.publish(domain_xml(100 + version, 0)); // copies and retires the index the guard reads
+    }
+    catalog.erase(2);
+    catalog.collect();
+    EXPECT_EQ(name_of(old_version), "d1-0");
+    EXPECT_EQ(name_of(erased), "d2-0");
+    EXPECT_EQ(pinned.size(), 2u);
+    EXPECT_EQ(name_of(catalog.read().find(1)), "d1-49");
+    EXPECT_EQ(catalog.read().find(2), nullptr);
+}
+
+TEST(DomainCatalog, ReadersRunConcurrentlyWithWriters) {
+    constexpr unsigned domains = 16;
+    DomainCatalog catalog{8};
+    for (unsigned id = 1; id <= domains; ++id)
+        catalog.publish(domain_xml(id, 0));
+
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> reads{0};
+    std::vector<std::thread> readers;
+    for (unsigned t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                const auto guard = catalog.read();
+                for (unsigned id = 1; id <= domains; ++id) {
+                    const auto doc = guard.find(id);
+                    // Even ids are erased and republished by the writer
+                    if (doc == nullptr) {
+                        EXPECT_EQ(id % 2, 0u);
+                        continue;
+                    }
+                    const auto name = name_of(doc);
+                    EXPECT_EQ(name.substr(0, name.find('-')), "d" + std::to_string(id));
+                    reads.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+    for (unsigned version = 1; version < 300; ++version) {
+        for (unsigned id = 1; id <= domains; ++id) {
+            if (id % 2 == 0 && version % 3 == 0)
+                catalog.erase(id);
+            else
+                catalog.publish(domain_xml(id, version));
+        }
+    }
+    done = true;
+    for (auto& reader : readers)
+        reader.join();
+    EXPECT_GT(reads.load(), 0u);
+    const auto guard = catalog.read();
+    EXPECT_EQ(guard.size(), domains);
+    EXPECT_EQ(name_of(guard.find(1)), "d1-299");
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <virtxml/compact_document.hpp>
+#include <virtxml/domain.hpp>
+#include <virtxml/secret.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+constexpr auto secret_xml = R"(<secret ephemeral='no' private='yes'>
+  <uuid>c1f11a6d-8c5d-4a3e-ac7a-4e171c5e0d4a</uuid>
+  <description>Passphrase for the iSCSI target</description>
+  <usage type='iscsi'><target>libvirtiscsi</target></usage>
+</secret>)";
+} // namespace
+
+TEST(CompactDocument, ViewsWorkOverTheCopiedTree) {
+    const CompactDocument secret_doc{secret_xml};
+    const auto secret = secret_doc.root_as<Secret>("secret");
+    ASSERT_TRUE(secret);
+    EXPECT_TRUE(secret.ephemeral());
+    EXPECT_TRUE(secret.private_());
+    EXPECT_EQ(static_cast<std::string_view>(secret.uuid()), "c1f11a6d-8c5d-4a3e-ac7a-4e171c5e0d4a");
+    EXPECT_EQ(static_cast<std::string_view>(secret.description()), "Passphrase for the iSCSI target");
+    const Secret::Usage usage{NodeAccess::of(secret)->first_node("usage")};
+    EXPECT_EQ(usage.type(), Secret::Usage::Type::iscsi);
+    EXPECT_EQ(static_cast<std::string_view>(usage.target()), "libvirtiscsi");
+    EXPECT_FALSE(secret_doc.root_as<Secret>("volume"));
+
+    const CompactDocument domain_doc{test::DomainXml{"vm"}.uuid(7).disk("/a.img", "vda").disk("/b.img").str()};
+    const auto domain = domain_doc.root_as<Domain>("domain");
+    ASSERT_TRUE(domain);
+    EXPECT_EQ(static_cast<std::string_view>(domain.name()), "vm");
+    EXPECT_EQ(domain.type(), Domain::Type::kvm);
+    std::size_t disks = 0;
+    for (const auto disk : domain.devices().disks()) {
+        EXPECT_TRUE(disk.source());
+        ++disks;
+    }
+    EXPECT_EQ(disks, 2u);
+}
+
+TEST(CompactDocument, HoldsOnlyWhatTheTreeNeeds) {
+    const CompactDocument doc{secret_xml};
+    EXPECT_GT(doc.memory_usage(), 0u);
+    EXPECT_LT(doc.memory_usage(), 4096u); // an xml_document embeds a 64 KiB pool
+}
+
+TEST(CompactDocument, ParseErrorsLeaveTheScratchReusable) {
+    EXPECT_THROW(CompactDocument{"<secret><uuid>"}, rapidxml_ns::parse_error);
+    EXPECT_THROW(CompactDocument{"<secret"}, rapidxml_ns::parse_error);
+    const CompactDocument doc{secret_xml};
+    const auto secret = doc.root_as<Secret>("secret");
+    ASSERT_TRUE(secret);
+    EXPECT_EQ(static_cast<std::string_view>(secret.description()), "Passphrase for the iSCSI target");
+    EXPECT_EQ(NodeAccess::of(secret)->next_sibling(), nullptr); // nothing left over from the failed parses
+}
+
+TEST(CompactDocument, MovedFromDocumentsAreEmpty) {
+    CompactDocument doc{secret_xml};
+    const auto usage = doc.memory_usage();
+    CompactDocument moved{std::move(doc)};
+    EXPECT_EQ(moved.memory_usage(), usage);
+    EXPECT_TRUE(moved.root_as<Secret>("secret"));
+    EXPECT_EQ(doc.document(), nullptr);
+    EXPECT_EQ(doc.memory_usage(), 0u); 
+    EXPECT_FALSE(doc.root_as<Secret>("secret"));
+
+    doc = CompactDocument{"<secret/>"};
+    EXPECT_TRUE(doc.root_as<Secret>("secret"));
+}
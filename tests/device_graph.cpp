@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <virtxml/compact_document.hpp>
+#include <virtxml/device_graph.hpp>
+
+using namespace virtxml;
+
+namespace {
+std::string device_xml(std::string_view name, std::string_view parent, std::string_view capability) {
+    std::string ret = "<device><name>" + std::string{name} + "</name>";
+    if (!parent.empty())
+        ret += "<parent>" + std::string{parent} + "</parent>";
+    return ret + "<capability " + std::string{capability} + "</capability></device>";
+}
+std::string pci_capability(unsigned bus, unsigned function, unsigned group) {
+    return "type='pci'><domain>0x0000</domain><bus>0x" + std::to_string(bus) + "</bus><slot>0x00</slot><function>0x" + std::to_string(function) +
+           "</function><iommuGroup number='" + std::to_string(group) + "'/>";
+}
+} // namespace
+
+class DeviceGraphTest : public ::testing::Test {
+  protected:
+    std::vector<CompactDocument> docs;
+    std::vector<Device> devices;
+    DeviceGraph graph;
+
+    void SetUp() override {
+        // Children come before their parents, as nothing orders the devices libvirt lists
+        docs.emplace_back(device_xml("net_eth0_52_54_00_aa_bb_cc", "pci_0000_05_00_0", "type='net'><interface>eth0</interface>"));
+        docs.emplace_back(device_xml("pci_0000_05_00_0", "pci_0000_00_1c_0", pci_capability(5, 0, 12)));
+        docs.emplace_back(device_xml("pci_0000_05_00_1", "pci_0000_00_1c_0", pci_capability(5, 1, 12)));
+        docs.emplace_back(device_xml("block_sda", "pci_0000_05_00_1", "type='storage'><block>/dev/sda</block>"));
+        docs.emplace_back(device_xml("pci_0000_00_1c_0", "computer", pci_capability(0, 0, 3)));
+        docs.emplace_back(device_xml("computer", "", "type='system'>"));
+        docs.emplace_back(device_xml("orphan", "missing", "type='usb_device'>"));
+        for (const auto& doc : docs)
+            devices.push_back(doc.root_as<Device>("device"));
+        graph = DeviceGraph{devices};
+    }
+
+    DeviceGraph::Index index_of(std::string_view name) const { return *graph.find(name); }
+};
+
+TEST_F(DeviceGraphTest, LinksChildrenListedBeforeTheirParents) {
+    ASSERT_EQ(graph.size(), 7u);
+    const auto root_port = index_of("pci_0000_00_1c_0");
+    EXPECT_EQ(graph.parent(index_of("pci_0000_05_00_0")), root_port);
+    EXPECT_EQ(graph.parent(index_of("net_eth0_52_54_00_aa_bb_cc")), index_of("pci_0000_05_00_0"));
+    EXPECT_EQ(graph.parent(root_port), index_of("computer"));
+    EXPECT_FALSE(graph.parent(index_of("computer")));
+    EXPECT_FALSE(graph.parent(index_of("orphan")));
+
+    const auto children = graph.children(root_port);
+    EXPECT_EQ(std::vector<DeviceGraph::Index>(children.begin(), children.end()),
+              (std::vector<DeviceGraph::Index>{index_of("pci_0000_05_00_0"), index_of("pci_0000_05_00_1")}));
+    EXPECT_EQ(graph.children(index_of("computer")).size(), 1u);
+    EXPECT_TRUE(graph.children(index_of("block_sda")).empty());
+}
+
+TEST_F(DeviceGraphTest, FindsDevicesByNamePciIommuGroupInterfaceAndBlock) {
+    EXPECT_EQ(static_cast<std::string_view>(graph[index_of("block_sda")].name()), "block_sda");
+    EXPECT_FALSE(graph.find("pci_0000_06_00_0"));
+
+    EXPECT_EQ(graph.find_pci(0, 5, 0, 1), index_of("pci_0000_05_00_1"));
+    EXPECT_EQ(graph.find_pci(pack_pci_address(0, 0, 0, 0)), index_of("pci_0000_00_1c_0"));
+    EXPECT_FALSE(graph.find_pci(0, 5, 0, 2));
+    EXPECT_EQ(graph.pci_address(index_of("pci_0000_05_00_0")), pack_pci_address(0, 5, 0, 0));
+    EXPECT_FALSE(graph.pci_address(index_of("computer")));
+
+    EXPECT_EQ(graph.iommu_group(12), (DeviceGraph::IndexList{index_of("pci_0000_05_00_0"), index_of("pci_0000_05_00_1")}));
+    EXPECT_EQ(graph.iommu_group_of(index_of("pci_0000_00_1c_0")), 3u);
+    EXPECT_TRUE(graph.iommu_group(7).empty());
+    EXPECT_FALSE(graph.iommu_group_of(index_of("block_sda")));
+
+    EXPECT_EQ(graph.find_net_interface("eth0"), index_of("net_eth0_52_54_00_aa_bb_cc"));
+    EXPECT_FALSE(graph.find_net_interface("eth1"));
+    EXPECT_EQ(graph.find_block("/dev/sda"), index_of("block_sda"));
+    EXPECT_FALSE(graph.find_block("/dev/sdb"));
+}
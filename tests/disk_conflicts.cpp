@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <virtxml/catalog.hpp>
+#include <virtxml/disk_conflicts.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+constexpr auto writer = "<disk type='file' device='disk'><source file='/var/lib/images/shared.qcow2'/><target dev='vda'/></disk>";
+constexpr auto reader = "<disk type='file' device='disk'><source file='/var/lib/images//shared.qcow2'/><target dev='vda'/><readonly/></disk>";
+
+/// Random-access range of (name, Domain) pairs whose element `fail` cannot be read
+struct FailingRange {
+    const std::vector<std::pair<std::string, Domain>>* domains;
+    std::size_t fail;
+
+    [[nodiscard]] std::size_t size() const noexcept { return domains->size(); }
+    [[nodiscard]] const std::pair<std::string, Domain>& operator[](std::size_t i) const {
+        if (i == fail)
+            throw std::runtime_error{"unreadable domain"};
+        return (*domains)[i];
+    }
+};
+} // namespace
+
+class DiskConflictTest : public ::testing::Test {
+  protected:
+    DomainDocument a{test::DomainXml{"a"}.uuid(1).devices(writer).str()};
+    DomainDocument b{test::DomainXml{"b"}.uuid(1).devices(reader).str()};
+    DomainDocument c{test::DomainXml{"c"}.uuid(1).str()};
+    std::vector<std::pair<std::string, Domain>> domains{{"a", a.domain()}, {"b", b.domain()}, {"c", c.domain()}};
+};
+
+TEST_F(DiskConflictTest, FindsWritersSharedWithOtherDomains) {
+    DiskConflictDetector<> detector{2};
+    detector.build(domains);
+    ASSERT_EQ(detector.conflicts().size(), 1u);
+    EXPECT_EQ(detector.conflicts()[0].uses->size(), 2u);
+    detector.remove_domain("b");
+    EXPECT_TRUE(detector.conflicts().empty());
+}
+
+TEST_F(DiskConflictTest, RebuildReplacesThePreviousIndex) {
+    DiskConflictDetector<> detector{2};
+    detector.build(domains);
+    detector.build(domains);
+    ASSERT_EQ(detector.conflicts().size(), 1u);
+    EXPECT_EQ(detector.conflicts()[0].uses->size(), 2u);
+
+    detector.build(std::vector<std::pair<std::string, Domain>>{{"a", a.domain()}});
+    EXPECT_TRUE(detector.conflicts().empty());
+    ASSERT_NE(detector.find(DiskSourceKey{"path:/var/lib/images/shared.qcow2"}), nullptr);
+    EXPECT_EQ(detector.find(DiskSourceKey{"path:/var/lib/images/shared.qcow2"})->size(), 1u);
+}
+
+TEST_F(DiskConflictTest, RethrowsWorkerExceptions) {
+    DiskConflictDetector<> detector{3};
+    detector.build(domains);
+    EXPECT_THROW(detector.build(FailingRange{&domains, 2}), std::runtime_error);
+    EXPECT_TRUE(detector.conflicts().empty());
+    EXPECT_EQ(detector.find(DiskSourceKey{"path:/var/lib/images/shared.qcow2"}), nullptr);
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <virtxml/catalog.hpp>
+#include <virtxml/domain_capabilities.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+constexpr auto caps_xml = R"(<domainCapabilities>
+  <path>/usr/bin/qemu-system-x86_64</path>
+  <domain>kvm</domain>
+  <machine>pc-q35-6.2</machine>
+  <arch>x86_64</arch>
+  <devices>
+    <disk supported='yes'><enum name='diskDevice'><value>disk</value><value>cdrom</value></enum></disk>
+    <graphics supported='yes'><enum name='type'><value>vnc</value><value>spice</value></enum></graphics>
+    <video supported='yes'><enum name='modelType'><value>vga</value><value>virtio</value></enum></video>
+    <tpm supported='yes'>
+      <enum name='model'><value>tpm-tis</value></enum>
+      <enum name='backendModel'><value>passthrough</value></enum>
+    </tpm>
+  </devices>
+</domainCapabilities>)";
+
+CapabilitySet needs(const char* devices) {
+    const DomainDocument doc{test::DomainXml{}.uuid(1).devices(devices).str()};
+    return requirements(doc.domain());
+}
+} // namespace
+
+class DomainCapabilitiesTest : public ::testing::Test {
+  protected:
+    std::string text = caps_xml;
+    DomainCapabilities caps{text.data()};
+    CapabilitySet offered = caps.offered();
+};
+
+TEST_F(DomainCapabilitiesTest, CoversWhatItOffers) {
+    EXPECT_TRUE(offered.covers(needs("<disk type='file' device='cdrom'/><graphics type='vnc'/><video><model type='virtio'/></video>"
+                                     "<tpm model='tpm-tis'><backend type='passthrough'/></tpm>")));
+    EXPECT_TRUE(offered.covers(needs("<disk type='file'/><tpm><backend type='passthrough'/></tpm>")));
+}
+
+TEST_F(DomainCapabilitiesTest, RejectsKnownValuesItDoesNotOffer) {
+    const auto needed = needs("<tpm model='tpm-crb'><backend type='emulator'/></tpm>");
+    EXPECT_FALSE(needed.unknown);
+    EXPECT_TRUE(needed.tpm_models.contains(Domain::Devices::Tpm::Model::tpm_crb));
+    EXPECT_FALSE(offered.covers(needed));
+    EXPECT_FALSE(offered.covers(needs("<graphics type='rdp'/>")));
+}
+
+TEST_F(DomainCapabilitiesTest, UnknownValuesAreUnsatisfiable) {
+    EXPECT_TRUE(needs("<graphics type='egl-headless'/>").unknown);
+    EXPECT_TRUE(needs("<video><model type='bochs'/></video>").unknown);
+    EXPECT_TRUE(needs("<tpm model='tpm-future'><backend type='passthrough'/></tpm>").unknown);
+    EXPECT_TRUE(needs("<tpm model='tpm-tis'/>").unknown); // no backend
+    EXPECT_FALSE(offered.covers(needs("<graphics type='egl-headless'/>")));
+    EXPECT_FALSE(offered.missing(needs("<graphics type='egl-headless'/>")).empty());
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace virtxml::test {
+
+/// UUID whose last group is the number `id`
+inline std::string uuid(unsigned id) {
+    char ret[37];
+    std::snprintf(ret, sizeof(ret), "00000000-0000-0000-0000-%012x", id);
+    return ret;
+}
+
+/// Text of a domain for the tests: a name, then only the parts that were set, in schema order
+class DomainXml {
+  public:
+    explicit DomainXml(std::string_view name = "d", std::string_view type = "kvm") : name(name), type(type) {}
+
+    DomainXml& uuid(unsigned id) {
+        uuid_text = test::uuid(id);
+        return *this;
+    }
+    /// Children of <os>
+    DomainXml& os(std::string_view children) {
+        os_children = children;
+        return *this;
+    }
+    DomainXml& vcpu(std::string_view count) {
+        vcpu_count = count;
+        return *this;
+    }
+    DomainXml& memory_mib(std::string_view size) {
+        memory_size = size;
+        return *this;
+    }
+    /// Appends `children` to <devices>
+    DomainXml& devices(std::string_view children) {
+        device_children.append(children);
+        return *this;
+    }
+    /// Appends a file-backed disk, with a target if `target` is not empty
+    DomainXml& disk(std::string_view file, std::string_view target = {}) {
+        device_children.append("<disk type='file' device='disk'><source file='").append(file).append("'/>");
+        if (!target.empty())
+            device_children.append("<target dev='").append(target).append("'/>");
+        device_children.append("</disk>");
+        return *this;
+    }
+
+    [[nodiscard]] std::string str() const {
+        std::string ret = "<domain type='" + type + "'><name>" + name + "</name>";
+        if (!uuid_text.empty())
+            ret += "<uuid>" + uuid_text + "</uuid>";
+        if (!os_children.empty())
+            ret += "<os>" + os_children + "</os>";
+        if (!vcpu_count.empty())
+            ret += "<vcpu>" + vcpu_count + "</vcpu>";
+        if (!memory_size.empty())
+            ret += "<memory unit='MiB'>" + memory_size + "</memory>";
+        if (!device_children.empty())
+            ret += "<devices>" + device_children + "</devices>";
+        return ret + "</domain>";
+    }
+
+  private:
+    std::string name;
+    std::string type;
+    std::string uuid_text;
+    std::string os_children;
+    std::string vcpu_count;
+    std::string memory_size;
+    std::string device_children;
+};
+
+} // namespace virtxml::test
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <virtxml/catalog.hpp>
+#include <virtxml/fleet.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+std::string domain_xml(const char* name, const char* vcpu) { return test::DomainXml{name}.uuid(1).vcpu(vcpu).memory_mib("1024").str(); }
+} // namespace
+
+/// Eight domains, with a host kept outside the XML that two of them lack
+class FleetTest : public ::testing::Test {
+  protected:
+    static constexpr const char* types[] = {"xen", "kvm", "qemu", "kvm", "xen", "kvm", "lxc", "qemu"};
+    static constexpr const char* vcpus[] = {"4", "2", "8", "2", "8", "1", "4", "8"};
+    static constexpr const char* hosts[] = {"h2", nullptr, "h1", "h2", nullptr, "h1", "h1", "h3"};
+
+    std::vector<std::unique_ptr<const DomainDocument>> docs;
+    std::vector<Domain> domains;
+    fleet::Builder builder;
+    fleet::Snapshot snapshot;
+
+    void SetUp() override {
+        for (unsigned i = 0; i < std::size(types); ++i) {
+            const auto name = "vm" + std::to_string(i);
+            docs.push_back(std::make_unique<const DomainDocument>(test::DomainXml{name, types[i]}.uuid(i + 1).vcpu(vcpus[i]).str()));
+            domains.push_back(docs.back()->domain());
+        }
+        builder.integer("vcpus", fleet::fields::vcpus)
+            .string("name", fleet::fields::name)
+            .string("type", fleet::fields::type)
+            .string("host", [](std::size_t row, Domain) -> std::optional<std::string_view> {
+                if (hosts[row] == nullptr)
+                    return std::nullopt;
+                return hosts[row];
+            });
+        snapshot = builder.build(domains, 3);
+    }
+
+    const fleet::IntegerColumn& integer(std::string_view name) const { return *snapshot.integer(name); }
+    const fleet::StringColumn& string(std::string_view name) const { return *snapshot.string(name); }
+};
+
+TEST(Fleet, ReadsIntegerFieldsAsDecimalUnlessHexPrefixed) {
+    const DomainDocument a{domain_xml("a", "010")};
+    const DomainDocument b{domain_xml("b", "0x10")};
+    const DomainDocument c{domain_xml("c", " 4")};
+    const std::vector<Domain> domains{a.domain(), b.domain(), c.domain()};
+    const auto snapshot = fleet::Builder{}.integer("vcpus", fleet::fields::vcpus).integer("memory", fleet::fields::memory_kib).build(domains, 2);
+    ASSERT_NE(snapshot.integer("vcpus"), nullptr);
+    EXPECT_EQ(snapshot.integer("vcpus")->values, (std::vector<std::int64_t>{10, 16, 4}));
+    EXPECT_EQ(snapshot.integer("memory")->values, (std::vector<std::int64_t>{1048576, 1048576, 1048576}));
+}
+
+TEST_F(FleetTest, MergesDictionariesAcrossThreadsLikeASingleThread) {
+    const auto single = builder.build(domains, 1);
+    for (const auto threads : {2u, 3u, 8u, 64u}) {
+        const auto multi = builder.build(domains, threads);
+        ASSERT_EQ(multi.rows, single.rows);
+        EXPECT_EQ(multi.integer("vcpus")->values, single.integer("vcpus")->values);
+        for (const auto column : {"name", "type", "host"}) {
+            EXPECT_EQ(multi.string(column)->dictionary, single.string(column)->dictionary) << column << " with " << threads << " threads";
+            EXPECT_EQ(multi.string(column)->codes, single.string(column)->codes) << column << " with " << threads << " threads";
+        }
+    }
+    const auto& type = *single.string("type");
+    EXPECT_EQ(type.dictionary, (std::vector<std::string>{"kvm", "lxc", "qemu", "xen"}));
+    EXPECT_TRUE(std::is_sorted(single.string("name")->dictionary.begin(), single.string("name")->dictionary.end()));
+    for (fleet::Row row = 0; row < single.rows; ++row)
+        EXPECT_EQ(type[row], types[row]);
+    EXPECT_EQ(single.string("host")->codes[1], fleet::null_code);
+    EXPECT_EQ((*single.string("host"))[4], "");
+}
+
+TEST_F(FleetTest, SelectsRows) {
+    const auto& vcpu = integer("vcpus");
+    EXPECT_EQ(fleet::rows(fleet::where(vcpu, fleet::Compare::eq, 8)), (std::vector<fleet::Row>{2, 4, 7}));
+    EXPECT_EQ(fleet::rows(fleet::where(vcpu, fleet::Compare::ne, 8)), (std::vector<fleet::Row>{0, 1, 3, 5, 6}));
+    EXPECT_EQ(fleet::rows(fleet::where(vcpu, fleet::Compare::lt, 2)), (std::vector<fleet::Row>{5}));
+    EXPECT_EQ(fleet::rows(fleet::where(vcpu, fleet::Compare::le, 2)), (std::vector<fleet::Row>{1, 3, 5}));
+    EXPECT_EQ(fleet::rows(fleet::where(vcpu, fleet::Compare::gt, 4)), (std::vector<fleet::Row>{2, 4, 7}));
+    EXPECT_EQ(fleet::rows(fleet::where(vcpu, fleet::Compare::ge, 4)), (std::vector<fleet::Row>{0, 2, 4, 6, 7}));
+
+    EXPECT_EQ(fleet::rows(fleet::where(string("type"), "xen")), (std::vector<fleet::Row>{0, 4}));
+    EXPECT_EQ(fleet::count(fleet::where(string("type"), "bhyve")), 0u);
+    EXPECT_EQ(fleet::rows(fleet::present(string("host"))), (std::vector<fleet::Row>{0, 2, 3, 5, 6, 7}));
+
+    auto mask = fleet::where(vcpu, fleet::Compare::ge, 4);
+    EXPECT_EQ(fleet::rows(fleet::intersect(mask, fleet::present(string("host")))), (std::vector<fleet::Row>{0, 2, 6, 7}));
+    EXPECT_EQ(fleet::rows(fleet::unite(mask, fleet::where(string("type"), "kvm"))), (std::vector<fleet::Row>{0, 1, 2, 3, 5, 6, 7}));
+    EXPECT_EQ(fleet::rows(fleet::invert(mask)), (std::vector<fleet::Row>{4}));
+    EXPECT_EQ(fleet::sum(vcpu), 37);
+    EXPECT_EQ(fleet::sum(vcpu, &mask), 8);
+}
+
+TEST_F(FleetTest, GroupsLeaveOutRowsWithoutAKey) {
+    const auto& host = string("host");
+    ASSERT_EQ(host.dictionary, (std::vector<std::string>{"h1", "h2", "h3"}));
+    auto groups = fleet::group_sum(host, integer("vcpus"));
+    EXPECT_EQ(groups.sums, (std::vector<std::int64_t>{13, 6, 8}));
+    EXPECT_EQ(groups.counts, (std::vector<std::uint64_t>{3, 2, 1}));
+
+    const auto kvm = fleet::where(string("type"), "kvm");
+    groups = fleet::group_sum(host, integer("vcpus"), &kvm);
+    EXPECT_EQ(groups.sums, (std::vector<std::int64_t>{1, 2, 0}));
+    EXPECT_EQ(groups.counts, (std::vector<std::uint64_t>{1, 1, 0}));
+}
+
+TEST_F(FleetTest, TopKeepsRowOrderOnTies) {
+    const auto& vcpu = integer("vcpus");
+    EXPECT_EQ(fleet::top(vcpu, 4), (std::vector<fleet::Row>{2, 4, 7, 0}));
+    EXPECT_EQ(fleet::top(vcpu, 100), (std::vector<fleet::Row>{2, 4, 7, 0, 6, 1, 3, 5}));
+    EXPECT_TRUE(fleet::top(vcpu, 0).empty());
+    const auto kvm = fleet::where(string("type"), "kvm");
+    EXPECT_EQ(fleet::top(vcpu, 5, &kvm), (std::vector<fleet::Row>{1, 3, 5}));
+}
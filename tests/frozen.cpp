@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <virtxml/catalog.hpp>
+#include <virtxml/frozen.hpp>
+#include <virtxml/snapshot.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+/// Domain with an emulator, `disks` disks, then an interface
+std::string domain_xml(const char* name, int disks) {
+    test::DomainXml ret{name};
+    ret.devices("<emulator>/usr/bin/qemu-system-x86_64</emulator>");
+    for (int i = 0; i < disks; ++i)
+        ret.disk("/var/lib/" + std::to_string(i) + ".qcow2", "vd" + std::to_string(i));
+    return ret.devices("<interface type='network'><source network='default'/></interface>").str();
+}
+
+std::vector<std::string_view> disk_files(Domain dom) {
+    std::vector<std::string_view> ret;
+    for (const auto disk : dom.devices().disks())
+        ret.push_back(static_cast<std::string_view>(disk.source().file()));
+    return ret;
+}
+} // namespace
+
+TEST(FrozenDocument, ViewsReadTheRecords) {
+    const DomainDocument doc{domain_xml("a", 3)};
+    const auto frozen = freeze(doc.domain());
+    const auto dom = frozen.root_as<Domain>("domain");
+    ASSERT_TRUE(dom);
+    EXPECT_FALSE(frozen.root_as<Domain>("device"));
+    EXPECT_EQ(NodeAccess::of(dom).xml(), nullptr);
+    EXPECT_EQ(static_cast<std::string_view>(dom.name()), "a");
+    EXPECT_EQ(disk_files(dom), disk_files(doc.domain()));
+    EXPECT_EQ(frozen.element_count(), 15u);
+    EXPECT_EQ(frozen.index_of(NodeAccess::of(dom.devices())), 2u);
+    EXPECT_FALSE(frozen.index_of(NodeAccess::of(doc.domain())));
+}
+
+TEST(FrozenDocument, ScansByName) {
+    const DomainDocument doc{domain_xml("a", 3)};
+    const auto frozen = freeze(doc.domain());
+    std::vector<std::string_view> sources;
+    frozen.for_each<Node>("source", [&](Node) { sources.emplace_back(); });
+    EXPECT_EQ(sources.size(), 4u);
+
+    std::vector<std::string_view> files;
+    const auto devices = NodeAccess::of(frozen.root_as<Domain>("domain").devices());
+    frozen.for_each_in<Domain::Devices::Disk>(devices, "disk", [&](Domain::Devices::Disk disk) {
+        files.push_back(static_cast<std::string_view>(disk.source().file()));
+    });
+    EXPECT_EQ(files, disk_files(doc.domain()));
+    // The last disk ends where the interface starts
+    const auto last = *frozen.index_of(devices->last_node("disk"));
+    EXPECT_EQ(frozen.name_of(frozen.symbol_of(last)), "disk");
+    std::size_t in_last = 0;
+    frozen.for_each_in<Node>(frozen.element(last), "source", [&](Node) { ++in_last; });
+    EXPECT_EQ(in_last, 1u);
+    EXPECT_FALSE(frozen.symbol("nothing"));
+}
+
+TEST(FrozenDocument, HoldsNoRapidxmlNodes) {
+    const DomainDocument doc{domain_xml("a", 200)};
+    const auto frozen = freeze(doc.domain());
+    EXPECT_EQ(frozen.element_count(), 606u);
+    EXPECT_LT(frozen.memory_usage(), frozen.element_count() * sizeof(xml_node<>));
+}
+
+TEST(FrozenDocument, ViewsSurviveMoves) {
+    const DomainDocument doc{domain_xml("a", 2)};
+    std::vector<FrozenDocument> documents;
+    documents.push_back(freeze(doc.domain()));
+    const auto dom = documents.front().root_as<Domain>("domain");
+    for (int i = 0; i < 16; ++i)
+        documents.push_back(freeze(doc.domain()));
+    EXPECT_EQ(disk_files(dom), disk_files(doc.domain()));
+}
+
+TEST(FrozenDocument, SharesInternedStrings) {
+    InternTable strings;
+    const DomainDocument first{domain_xml("a", 2)};
+    const DomainDocument second{domain_xml("b", 2)};
+    const auto a = freeze(first.domain(), &strings);
+    const auto distinct = strings.size();
+    const auto b = freeze(second.domain(), &strings);
+    EXPECT_EQ(strings.size(), distinct + 1); // only the name differs
+    const auto local = freeze(first.domain());
+
+    EXPECT_EQ(a.name_of(*a.symbol("disk")).data(), b.name_of(*b.symbol("disk")).data());
+    const auto emulator = [](const FrozenDocument& doc) {
+        return NodeAccess::of(doc.root_as<Domain>("domain").devices())->first_node("emulator")->value();
+    };
+    EXPECT_EQ(emulator(a), emulator(b));
+    EXPECT_NE(emulator(a), emulator(local));
+    EXPECT_EQ(std::string_view{emulator(a)}, "/usr/bin/qemu-system-x86_64");
+    EXPECT_EQ(disk_files(a.root_as<Domain>("domain")), disk_files(first.domain()));
+    EXPECT_EQ(static_cast<std::string_view>(b.root_as<Domain>("domain").name()), "b");
+}
+
+TEST(FrozenDocument, FreezesSnapshots) {
+    const DomainDocument doc{domain_xml("a", 2)};
+    const auto image = write_snapshot(doc.domain());
+    Snapshot snap;
+    ASSERT_TRUE(snap.load(image.data(), image.size()));
+    const auto frozen = freeze(snap.domain());
+    EXPECT_EQ(frozen.element_count(), snap.size());
+    EXPECT_EQ(disk_files(frozen.root_as<Domain>("domain")), disk_files(doc.domain()));
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <virtxml/json.hpp>
+
+using namespace virtxml;
+
+namespace {
+std::string transcode(std::string xml, const JsonSchema* schema, const JsonProjection* projection = nullptr) {
+    xml_document<> doc;
+    doc.parse<0>(xml.data());
+    std::string out;
+    to_json(doc.first_node(), out, schema, projection);
+    return out;
+}
+} // namespace
+
+TEST(Json, ReadsNumbersAsDecimalUnlessHexPrefixed) {
+    JsonSchema schema;
+    schema.root.attribute("slot", JsonSchema::Kind::number).attribute("bus", JsonSchema::Kind::number).text(JsonSchema::Kind::number);
+    EXPECT_EQ(transcode("<address slot='0x1f' bus='010'>0012</address>", &schema), R"({"slot":31,"bus":10,"#text":12})");
+}
+
+TEST(Json, KeepsNonNumbersAsStrings) {
+    JsonSchema schema;
+    schema.root.attribute("slot", JsonSchema::Kind::number);
+    EXPECT_NE(transcode("<address slot='08z'/>", &schema).find("\"08z\""), std::string::npos);
+}
+
+TEST(Json, ReadsNegativeNumbersSigned) {
+    JsonSchema schema;
+    schema.root.attribute("a", JsonSchema::Kind::number).attribute("b", JsonSchema::Kind::number).attribute("c", JsonSchema::Kind::number);
+    EXPECT_EQ(transcode("<n a='-012' b='-0x10' c=' -3'/>", &schema), R"({"a":-12,"b":-16,"c":-3})");
+}
+
+TEST(Json, KeepsNumbersOutOfRangeAsStrings) {
+    JsonSchema schema;
+    schema.root.attribute("a", JsonSchema::Kind::number).attribute("b", JsonSchema::Kind::number).attribute("c", JsonSchema::Kind::number);
+    EXPECT_EQ(transcode("<n a='18446744073709551615' b='18446744073709551616' c='-9223372036854775809'/>", &schema),
+              R"({"a":18446744073709551615,"b":"18446744073709551616","c":"-9223372036854775809"})");
+}
+
+TEST(Json, EscapesQuotesAndControlCharacters) {
+    EXPECT_EQ(transcode("<t a='say &quot;hi&quot;\\'>x&#9;y&#10;z&#1;&#31;</t>", nullptr), R"({"a":"say \"hi\"\\","#text":"x\ty\nz\u0001\u001f"})");
+}
+
+TEST(Json, GroupsRepeatedChildrenIntoArrays) {
+    JsonSchema schema;
+    schema.root.child("boot", true).attribute("dev", JsonSchema::Kind::string);
+    EXPECT_EQ(transcode("<os><boot dev='hd'/><type>hvm</type></os>", &schema), R"({"boot":[{"dev":"hd"}],"type":"hvm"})");
+    EXPECT_EQ(transcode("<os><boot dev='hd'/><type>hvm</type><boot dev='cdrom'/></os>", nullptr),
+              R"({"boot":[{"dev":"hd"},{"dev":"cdrom"}],"type":"hvm"})");
+}
+
+TEST(Json, EmitsOnlyTheProjection) {
+    const JsonProjection projection{"name", "devices/disk/target/dev"};
+    EXPECT_EQ(transcode("<domain type='kvm'><name>vm</name><memory>1024</memory><devices><disk type='file'><target dev='vda' bus='virtio'/></disk>"
+                        "<interface type='network'/></devices></domain>",
+                        nullptr, &projection),
+              R"({"name":"vm","devices":{"disk":{"target":{"dev":"vda"}}}})");
+}
+
+TEST(Json, TypesDomainsWithTheDomainSchema) {
+    EXPECT_EQ(transcode("<domain type='kvm' id='7'><name>123</name><memory unit='KiB'>0100</memory><vcpu current='2'>4</vcpu>"
+                        "<os><type arch='x86_64'>hvm</type><boot dev='hd'/></os><devices>"
+                        "<disk type='file'><target dev='vda'/><address type='pci' bus='0x00' slot='0x04' multifunction='on'/></disk>"
+                        "<interface type='network'><vlan><tag id='010'/></vlan></interface></devices></domain>",
+                        &domain_json_schema()),
+              R"({"type":"kvm","id":7,"name":"123","memory":{"unit":"KiB","#text":100},"vcpu":{"current":2,"#text":4},)"
+              R"("os":{"type":{"arch":"x86_64","#text":"hvm"},"boot":[{"dev":"hd"}]},"devices":{)"
+              R"("disk":[{"type":"file","target":{"dev":"vda"},"address":{"type":"pci","bus":0,"slot":4,"multifunction":true}}],)"
+              R"("interface":[{"type":"network","vlan":{"tag":[{"id":10}]}}]}})");
+}
@@ -0,0 +1,146 @@
+#include <cstdint>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <map>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <virtxml/catalog.hpp>
+#include <virtxml/mac_index.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+/// One character at a time, to check the word-at-a-time parser against
+std::optional<std::uint64_t> reference_mac(const std::string& str) {
+    if (str.size() != 17 || (str[2] != ':' && str[2] != '-'))
+        return std::nullopt;
+    std::uint64_t ret = 0;
+    for (std::size_t i = 0; i < 17; ++i) {
+        const auto c = str[i];
+        if (i % 3 == 2) {
+            if (c != str[2])
+                return std::nullopt;
+            continue;
+        }
+        const int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (digit < 0)
+            return std::nullopt;
+        ret = ret << 4u | static_cast<unsigned>(digit);
+    }
+    return ret;
+}
+
+std::string format_mac(std::uint64_t mac) {
+    char buf[18];
+    std::snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x", unsigned(mac >> 40u & 0xFF), unsigned(mac >> 32u & 0xFF), unsigned(mac >> 24u & 0xFF),
+                  unsigned(mac >> 16u & 0xFF), unsigned(mac >> 8u & 0xFF), unsigned(mac & 0xFF));
+    return buf;
+}
+
+const Domain::Devices::Interface no_interface{nullptr};
+} // namespace
+
+TEST(ParseMacAddress, PacksFirstOctetMostSignificant) {
+    EXPECT_EQ(parse_mac_address("52:54:00:12:34:56"), 0x525400123456u);
+    EXPECT_EQ(parse_mac_address("AA-bb-CC-dd-EE-ff"), 0xAABBCCDDEEFFu);
+    EXPECT_EQ(parse_mac_address("00:00:00:00:00:00"), 0u);
+    EXPECT_EQ(parse_mac_address("ff:ff:ff:ff:ff:ff"), 0xFFFFFFFFFFFFu);
+    EXPECT_FALSE(parse_mac_address("52:54:00:12:34:5"));
+    EXPECT_FALSE(parse_mac_address("52:54:00-12:34:56"));
+    EXPECT_FALSE(parse_mac_address("52:54:00:12:34:56:"));
+}
+
+TEST(ParseMacAddress, AgreesWithACharacterwiseParserOnEveryCharacter) {
+    // Every byte value in every position, including the neighbours of the digit ranges the SWAR masks must exclude
+    std::string mac = "52:54:00:12:34:56";
+    for (std::size_t pos = 0; pos < mac.size(); ++pos) {
+        const auto saved = mac[pos];
+        for (int c = 0; c < 256; ++c) {
+            mac[pos] = static_cast<char>(c);
+            ASSERT_EQ(parse_mac_address(mac), reference_mac(mac)) << "byte " << c << " at " << pos;
+        }
+        mac[pos] = saved;
+    }
+    std::mt19937_64 rng{42};
+    for (int i = 0; i < 10000; ++i) {
+        const auto value = rng() & 0xFFFFFFFFFFFFu;
+        ASSERT_EQ(parse_mac_address(format_mac(value)), value);
+    }
+}
+
+TEST(MacIndex, ChainsAndReportsSharedMacs) {
+    MacIndex<int> index;
+    EXPECT_TRUE(index.insert(1, 0x525400000001u, no_interface));
+    EXPECT_TRUE(index.insert(2, 0x525400000002u, no_interface));
+    EXPECT_FALSE(index.insert(3, 0x525400000001u, no_interface));
+    EXPECT_EQ(index.size(), 2u);
+    EXPECT_TRUE(index.is_duplicated(0x525400000001u));
+    EXPECT_EQ(index.find(0x525400000001u)->domain, 3);
+    std::set<int> owners;
+    index.for_each_owner(0x525400000001u, [&](const auto& owner) { owners.insert(owner.domain); });
+    EXPECT_EQ(owners, (std::set<int>{1, 3}));
+
+    index.remove_domain(3);
+    EXPECT_FALSE(index.is_duplicated(0x525400000001u));
+    EXPECT_EQ(index.find(0x525400000001u)->domain, 1);
+    index.remove_domain(1);
+    EXPECT_EQ(index.find(0x525400000001u), nullptr);
+    EXPECT_EQ(index.size(), 1u);
+}
+
+TEST(MacIndex, StaysConsistentThroughGrowthAndBackwardShiftDeletion) {
+    // Few distinct MACs per domain and many removals, so that deletions keep punching holes into probe sequences
+    std::mt19937_64 rng{7};
+    std::map<int, std::set<std::uint64_t>> model;
+    MacIndex<int> index;
+    for (int round = 0; round < 4000; ++round) {
+        const auto key = static_cast<int>(rng() % 300);
+        if (rng() % 3 == 0) {
+            index.remove_domain(key);
+            model.erase(key);
+            continue;
+        }
+        if (model.count(key) != 0)
+            continue;
+        auto& macs = model[key];
+        for (int i = 0; i < 3; ++i) {
+            // Values spread over a small range, so that some are shared between domains
+            const auto mac = 0x525400000000u + rng() % 2000;
+            if (macs.insert(mac).second)
+                index.insert(key, mac, no_interface);
+        }
+
+        if (round % 100 != 0)
+            continue;
+        std::map<std::uint64_t, std::set<int>> owners;
+        for (const auto& [k, list] : model)
+            for (const auto mac : list)
+                owners[mac].insert(k);
+        ASSERT_EQ(index.size(), owners.size());
+        for (const auto& [mac, expected] : owners) {
+            std::set<int> found;
+            index.for_each_owner(mac, [&](const auto& owner) { found.insert(owner.domain); });
+            ASSERT_EQ(found, expected);
+            ASSERT_EQ(index.is_duplicated(mac), expected.size() > 1);
+        }
+        for (std::uint64_t mac = 0x525400000000u; mac < 0x525400000000u + 2000; ++mac)
+            ASSERT_EQ(index.find(mac) != nullptr, owners.count(mac) != 0);
+    }
+}
+
+TEST(MacIndex, IndexesTheInterfacesOfADomain) {
+    const DomainDocument doc{test::DomainXml{}
+                                 .uuid(1)
+                                 .devices("<interface type='network'><mac address='52:54:00:aa:bb:cc'/><source network='default'/></interface>"
+                                          "<interface type='network'><mac address='52:54:00:AA:BB:CC'/><source network='default'/></interface>"
+                                          "<interface type='network'><mac address='not-a-mac'/><source network='default'/></interface>")
+                                 .str()};
+    MacIndex<> index;
+    EXPECT_EQ(index.add_domain("d", doc.domain()), 1u);
+    EXPECT_EQ(index.size(), 1u);
+    EXPECT_TRUE(index.is_duplicated(0x525400AABBCCu));
+}
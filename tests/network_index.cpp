@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <virtxml/network_index.hpp>
+
+using namespace virtxml;
+
+namespace {
+constexpr auto nested = R"(<network>
+  <name>default</name>
+  <ip address='10.0.0.1' netmask='255.255.255.0'>
+    <dhcp>
+      <range start='10.0.0.10' end='10.0.0.100'/>
+      <range start='10.0.0.20' end='10.0.0.30'/>
+      <range start='10.0.0.40' end='10.0.0.50'/>
+      <host mac='52:54:00:00:00:01' name='a' ip='10.0.0.200'/>
+      <host mac='52:54:00:00:00:02' name='b' ip='10.0.0.201'/>
+    </dhcp>
+  </ip>
+</network>)";
+
+NetworkIndex::Address v4(const char* text) { return *parse_ip_address(text); }
+} // namespace
+
+TEST(NetworkIndex, ReportsEveryRangeOverlappingAnEarlierOne) {
+    const NetworkDocument doc{nested};
+    const NetworkIndex index{doc.network()};
+    EXPECT_EQ(index.problems().overlapping_ranges.size(), 2u);
+    EXPECT_FALSE(index.consistent());
+}
+
+TEST(NetworkIndex, FindsAddressesInsideNestedRanges) {
+    const NetworkDocument doc{nested};
+    const NetworkIndex index{doc.network()};
+    ASSERT_NE(index.range_of(v4("10.0.0.60")), nullptr);
+    EXPECT_EQ(index.range_of(v4("10.0.0.60"))->start, v4("10.0.0.10"));
+    EXPECT_NE(index.range_of(v4("10.0.0.25")), nullptr);
+    EXPECT_NE(index.range_of(v4("10.0.0.100")), nullptr);
+    EXPECT_EQ(index.range_of(v4("10.0.0.101")), nullptr);
+    EXPECT_EQ(index.range_of(v4("10.0.0.9")), nullptr);
+    EXPECT_FALSE(index.is_free(v4("10.0.0.60")));
+    EXPECT_TRUE(index.is_free(v4("10.0.0.150")));
+}
+
+TEST(NetworkIndex, IndexesStaticHosts) {
+    const NetworkDocument doc{nested};
+    const NetworkIndex index{doc.network()};
+    EXPECT_EQ(index.host_count(), 2u);
+    const auto host = index.host_by_ip(v4("10.0.0.201"));
+    ASSERT_TRUE(host);
+    EXPECT_EQ(static_cast<std::string_view>(host.name()), "b");
+    EXPECT_FALSE(index.host_by_ip(v4("10.0.0.202")));
+    EXPECT_FALSE(index.is_free(v4("10.0.0.200")));
+    EXPECT_FALSE(index.is_free(v4("10.0.0.1")));   // the network's own address
+    EXPECT_FALSE(index.is_free(v4("10.0.0.255"))); // broadcast
+    EXPECT_FALSE(index.is_free(v4("10.0.1.5")));   // outside the subnet
+}
+
+TEST(NetworkIndex, DisjointRangesAreConsistent) {
+    const NetworkDocument doc{R"(<network><name>n</name><ip address='192.168.1.1' prefix='24'><dhcp>
+      <range start='192.168.1.10' end='192.168.1.19'/><range start='192.168.1.20' end='192.168.1.29'/>
+    </dhcp></ip></network>)"};
+    const NetworkIndex index{doc.network()};
+    EXPECT_TRUE(index.consistent());
+    EXPECT_EQ(index.range_of(v4("192.168.1.20"))->start, v4("192.168.1.20"));
+    EXPECT_EQ(index.range_of(v4("192.168.1.19"))->start, v4("192.168.1.10"));
+}
@@ -0,0 +1,63 @@
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <string>
+#include <virtxml/catalog.hpp>
+#include <virtxml/path.hpp>
+
+using namespace virtxml;
+
+namespace {
+constexpr auto domain_xml = R"(<domain type='kvm'>
+  <name>d</name>
+  <uuid>00000000-0000-0000-0000-000000000001</uuid>
+  <vcpu>010</vcpu>
+  <memory unit='KiB'>4294967296</memory>
+  <currentMemory unit='KiB'>18446744073709551616</currentMemory>
+  <iothreads>-2</iothreads>
+  <devices>
+    <disk type='file' device='disk'><source file='/a.img'/><target dev='vda'/></disk>
+    <disk type='file' device='disk'><source file='/b.img'/><target dev='vdb'/></disk>
+    <controller type='pci' index='0x1f'/>
+  </devices>
+</domain>)";
+} // namespace
+
+class PathTest : public ::testing::Test {
+  protected:
+    DomainDocument doc{domain_xml};
+    Domain dom = doc.domain();
+};
+
+TEST_F(PathTest, ReadsValuesAndElements) {
+    EXPECT_EQ(get(dom, make_path("devices/disk[2]/source@file")), "/b.img");
+    EXPECT_EQ(get(dom, make_path("@type")), "kvm");
+    EXPECT_FALSE(get(dom, make_path("devices/disk[3]/source@file")));
+    EXPECT_TRUE(at<Domain::Devices::Disk>(dom, make_path("devices/disk[1]")));
+}
+
+TEST_F(PathTest, ParsesIntegersAsDecimalUnlessHexPrefixed) {
+    EXPECT_EQ(get<unsigned>(dom, make_path("vcpu")), 10u);
+    EXPECT_EQ(get<std::int64_t>(dom, make_path("vcpu")), 10);
+    EXPECT_EQ(get<unsigned>(dom, make_path("devices/controller@index")), 0x1Fu);
+    EXPECT_FALSE(get<unsigned>(dom, make_path("name")));
+}
+
+TEST_F(PathTest, RejectsIntegersOutOfRange) {
+    EXPECT_EQ(get<std::uint64_t>(dom, make_path("memory")), 4294967296u);
+    EXPECT_FALSE(get<unsigned>(dom, make_path("memory")));
+    EXPECT_FALSE(get<std::int32_t>(dom, make_path("memory")));
+    EXPECT_FALSE(get<std::uint64_t>(dom, make_path("currentMemory")));
+    EXPECT_FALSE(get<std::int64_t>(dom, make_path("currentMemory")));
+    EXPECT_EQ(get<std::int8_t>(dom, make_path("iothreads")), -2);
+    EXPECT_FALSE(get<unsigned>(dom, make_path("iothreads")));
+    EXPECT_FALSE(get<std::uint64_t>(dom, make_path("iothreads")));
+}
+
+TEST_F(PathTest, MalformedPathsResolveToNothing) {
+    // A malformed step stops parsing, so without the check the valid prefix would be resolved
+    constexpr auto malformed = make_path("devices/disk[0]/source@file");
+    static_assert(!malformed.valid);
+    EXPECT_FALSE(get(dom, malformed));
+    EXPECT_FALSE(at<Domain::Devices::Disk>(dom, make_path("devices//disk")));
+    EXPECT_FALSE(get(dom, make_path("devices@")));
+}
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <virtxml/push_parser.hpp>
+
+using namespace virtxml;
+
+namespace {
+/// Feeds `xml` to a push parser `chunk` bytes at a time
+PushParser::Status push(PushParser& parser, std::string_view xml, std::size_t chunk) {
+    auto status = PushParser::Status::need_more;
+    for (std::size_t i = 0; i < xml.size(); i += chunk)
+        status = parser.feed(xml.substr(i, chunk));
+    return status;
+}
+
+std::string_view value_of(const xml_node<>* node) { return {node->value(), node->value_size()}; }
+std::string_view attribute_of(const xml_node<>* node, const char* name) {
+    const auto attr = node->first_attribute(name);
+    return {attr->value(), attr->value_size()};
+}
+} // namespace
+
+TEST(PushParser, DecodesReferencesLikeParse) {
+    constexpr std::string_view xml = "<domain type='a&amp;b&#x41;'><title>&lt;x&gt; &#233; &quot;&apos;</title></domain>";
+    for (const std::size_t chunk : {1u, 3u, 64u}) {
+        PushParser parser;
+        ASSERT_EQ(push(parser, xml, chunk), PushParser::Status::complete) << parser.error();
+        EXPECT_EQ(attribute_of(parser.root(), "type"), "a&bA");
+        EXPECT_EQ(value_of(parser.root()->first_node("title")), "<x> \xC3\xA9 \"'");
+    }
+}
+
+TEST(PushParser, KeepsUnknownEntitiesVerbatim) {
+    std::string xml = "<domain name='R&amp;D &copy;'><description>a&nbsp;b & c &amp d</description></domain>";
+    PushParser parser;
+    ASSERT_EQ(push(parser, xml, 5), PushParser::Status::complete) << parser.error();
+
+    xml_document<> doc;
+    doc.parse<0>(xml.data());
+    EXPECT_EQ(attribute_of(parser.root(), "name"), attribute_of(doc.first_node(), "name"));
+    EXPECT_EQ(value_of(parser.root()->first_node("description")), value_of(doc.first_node()->first_node("description")));
+    EXPECT_EQ(value_of(parser.root()->first_node("description")), "a&nbsp;b & c &amp d");
+}
+
+TEST(PushParser, RejectsMalformedNumericReferences) {
+    for (const std::string_view xml : {"<a>&#;</a>", "<a>&#x;</a>", "<a>&#12</a>", "<a>&#xZZ;</a>", "<a>&#1114112;</a>"}) {
+        PushParser parser;
+        EXPECT_EQ(push(parser, xml, 2), PushParser::Status::error) << xml;
+    }
+}
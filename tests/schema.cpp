@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <virtxml/push_parser.hpp>
+#include <virtxml/schema.hpp>
+#include <virtxml/schemas/guest.hpp>
+
+using namespace virtxml;
+
+namespace {
+using Problem = SchemaError::Problem;
+
+constexpr auto valid_guest = R"(<guest type='kvm' id='3'>
+  <name>g</name>
+  <vcpu> 4 </vcpu>
+  <metadata><app:info xmlns:app='urn:app' any='thing'><nested>text</nested></app:info></metadata>
+  <description>interleaved after metadata</description>
+  <devices>
+    <disk device='cdrom'><target dev='hdc'/><readonly/></disk>
+    <interface type='network'><mtu size='-1'/></interface>
+    <disk device='disk'><target dev='vda'/></disk>
+  </devices>
+</guest>)";
+
+/// Validates `xml` after a regular parse; returns the problem found, if any
+std::optional<Problem> check(std::string xml) {
+    xml_document<> doc;
+    doc.parse<0>(xml.data());
+    SchemaError error{};
+    return validate(schemas::guest, doc.first_node(), &error) ? std::nullopt : std::optional{error.problem};
+}
+
+std::string with_devices(const char* devices) {
+    return std::string{"<guest type='qemu'><name>g</name><devices>"} + devices + "</devices></guest>";
+}
+
+// Hand-written tables: <r> holds any number of <a>, then exactly one element of any other name, which may hold anything
+namespace wildcard_tables {
+constexpr char strings[] = "raw*";
+constexpr schema::Definition definitions[] = {
+    {{0, 1}, 0, 0, 0, 1, 0, schema::ValueKind::any, 0, 0},
+    {{1, 1}, 0, 0, 0, 3, 0, schema::ValueKind::any, 0, 0},
+    {{3, 1}, 0, 0, 0, 3, schema::any_content | schema::any_attributes, schema::ValueKind::any, 0, 0},
+};
+constexpr schema::Attribute attributes[] = {{}};
+constexpr schema::StrRef values[] = {{}};
+constexpr schema::State states[] = {
+    {0, 1, false}, // document: <r>
+    {1, 2, false}, // in <r>: <a>, or the wildcard
+    {0, 0, true},  // after the wildcard
+    {0, 0, true},  // inside <a> or the wildcard element
+};
+constexpr schema::Transition transitions[] = {
+    {{0, 1}, 3, 0},
+    {{1, 1}, 1, 1},
+    {{3, 1}, 2, 2},
+};
+constexpr schema::Schema schema{strings, definitions, attributes, values, states, transitions, 0};
+} // namespace wildcard_tables
+} // namespace
+
+TEST(Rng2Tables, AcceptsValidDocuments) {
+    EXPECT_EQ(check(valid_guest), std::nullopt);
+    EXPECT_EQ(check(with_devices("<interface type='user'/>")), std::nullopt);
+}
+
+TEST(Rng2Tables, EnforcesContentModels) {
+    EXPECT_EQ(check("<domain type='kvm'/>"), Problem::unexpected_element);
+    EXPECT_EQ(check("<guest type='kvm'><devices><disk device='disk'><target dev='vda'/></disk></devices></guest>"), Problem::unexpected_element);
+    EXPECT_EQ(check("<guest type='kvm'><name>g</name></guest>"), Problem::incomplete_content);
+    EXPECT_EQ(check(with_devices("")), Problem::incomplete_content);
+    EXPECT_EQ(check(with_devices("<disk device='disk'/>")), Problem::incomplete_content);
+    EXPECT_EQ(check(with_devices("<disk device='disk'><target dev='vda'/><target dev='vdb'/></disk>")), Problem::unexpected_element);
+    EXPECT_EQ(check(with_devices("<disk device='disk'><target dev='vda'/><readonly>yes</readonly></disk>")), Problem::unexpected_text);
+}
+
+TEST(Rng2Tables, EnforcesAttributesAndDatatypes) {
+    EXPECT_EQ(check("<guest type='xen'><name>g</name><devices><interface type='user'/></devices></guest>"), Problem::bad_value);
+    EXPECT_EQ(check("<guest type='kvm' id='-1'><name>g</name><devices><interface type='user'/></devices></guest>"), Problem::bad_value);
+    EXPECT_EQ(check("<guest type='kvm' uuid='x'><name>g</name><devices><interface type='user'/></devices></guest>"), Problem::unknown_attribute);
+    EXPECT_EQ(check("<guest><name>g</name><devices><interface type='user'/></devices></guest>"), Problem::missing_attribute);
+    EXPECT_EQ(check("<guest type='kvm'><name>g</name><vcpu>four</vcpu><devices><interface type='user'/></devices></guest>"), Problem::bad_value);
+    EXPECT_EQ(check(with_devices("<interface type='user'><mtu size='1500x'/></interface>")), Problem::bad_value);
+    EXPECT_EQ(check(with_devices("<disk device='floppy'><target dev='fda'/></disk>")), Problem::bad_value);
+}
+
+TEST(SchemaValidator, FallsBackToTheWildcardTransition) {
+    const auto run = [](std::string xml) {
+        xml_document<> doc;
+        doc.parse<0>(xml.data());
+        SchemaError error{};
+        return validate(wildcard_tables::schema, doc.first_node(), &error) ? std::nullopt : std::optional{error.problem};
+    };
+    EXPECT_EQ(run("<r><a/><a/><z k='v'><deep><er/></deep></z></r>"), std::nullopt);
+    EXPECT_EQ(run("<r><b/></r>"), std::nullopt);
+    EXPECT_EQ(run("<r><a/></r>"), Problem::incomplete_content);
+    EXPECT_EQ(run("<r><b/><a/></r>"), Problem::unexpected_element);
+    EXPECT_EQ(run("<r><a x='1'/><b/></r>"), Problem::unknown_attribute);
+}
+
+TEST(SchemaValidator, RejectsDocumentsDeeperThanItsStack) {
+    std::string xml = "<r><z>";
+    for (std::size_t i = 0; i < 2 * SchemaValidator::max_depth; ++i)
+        xml += "<n>";
+    for (std::size_t i = 0; i < 2 * SchemaValidator::max_depth; ++i)
+        xml += "</n>";
+    xml += "</z></r>";
+    xml_document<> doc;
+    doc.parse<0>(xml.data());
+    // Below an element whose content is not checked, depth is only counted
+    EXPECT_TRUE(validate(wildcard_tables::schema, doc.first_node()));
+}
+
+TEST(SchemaValidator, StopsThePushParserAtTheOffendingTag) {
+    SchemaValidator validator{schemas::guest};
+    PushParser parser;
+    parser.validate_with(&validator);
+    EXPECT_EQ(parser.feed(valid_guest), PushParser::Status::complete) << parser.error();
+
+    parser.reset();
+    const std::string_view invalid = "<guest type='kvm'><name>g</name><devices><disk device='tape'>";
+    EXPECT_EQ(parser.feed(invalid), PushParser::Status::error);
+    EXPECT_EQ(validator.error().problem, Problem::bad_value);
+    EXPECT_EQ(validator.error().item, "device");
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <virtxml/catalog.hpp>
+#include <virtxml/secret_index.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+using Failure = SecretIndex::Failure;
+using Origin = SecretIndex::Origin;
+
+std::string secret_xml(unsigned id, std::string_view usage = {}) {
+    std::string ret = "<secret ephemeral='no' private='yes'>";
+    if (id != 0)
+        ret += "<uuid>" + test::uuid(id) + "</uuid>";
+    return ret + std::string{usage} + "</secret>";
+}
+
+/// A disk whose image is encrypted with the secret `ref`, optionally backed by `backing`
+std::string encrypted_disk(std::string_view target, std::string_view ref, std::string_view backing = {}) {
+    return "<disk type='file' device='disk'><source file='/" + std::string{target} + ".img'><encryption format='luks'>" + std::string{ref} +
+           "</encryption></source>" + std::string{backing} + "<target dev='" + std::string{target} + "'/></disk>";
+}
+/// A network disk authenticating with the secret `ref`
+std::string auth_disk(std::string_view target, std::string_view ref) {
+    return "<disk type='network' device='disk'><source protocol='rbd' name='pool/" + std::string{target} + "'><host name='mon'/>" +
+           "<auth username='admin'>" + std::string{ref} + "</auth></source><target dev='" + std::string{target} + "'/></disk>";
+}
+
+bool same(Secret lhs, Secret rhs) { return NodeAccess::of(lhs) == NodeAccess::of(rhs); }
+
+std::string_view target_of(Domain::Devices::Disk disk) {
+    const auto attr = NodeAccess::of(disk)->first_node("target")->first_attribute("dev");
+    return {attr->value(), attr->value_size()};
+}
+} // namespace
+
+class SecretIndexTest : public ::testing::Test {
+  protected:
+    std::vector<std::unique_ptr<const SecretDocument>> docs;
+    SecretIndex index;
+
+    void add(std::string xml) {
+        docs.push_back(std::make_unique<const SecretDocument>(std::move(xml)));
+        index.add(docs.back()->secret());
+    }
+
+    void SetUp() override {
+        add(secret_xml(1, "<usage type='volume'><volume>/vda.img</volume></usage>"));
+        add(secret_xml(2, "<usage type='ceph'><name>client.admin</name></usage>"));
+        add(secret_xml(3, "<usage type='iscsi'><target>iqn.2013-07.com.example:target</target></usage>"));
+        add(secret_xml(4));
+        add(secret_xml(5, "<usage type='volume'><volume>/base.img</volume></usage>"));
+        add(secret_xml(1, "<usage type='tls'><name>dup</name></usage>"));
+        add(secret_xml(6, "<usage type='ceph'><name>client.admin</name></usage>"));
+        add(secret_xml(0, "<usage type='tls'><name>no-uuid</name></usage>"));
+    }
+};
+
+TEST_F(SecretIndexTest, RecordsDuplicatesAndKeepsTheFirst) {
+    EXPECT_EQ(index.size(), 6u);
+    const auto& problems = index.problems();
+    ASSERT_EQ(problems.missing_uuids.size(), 1u);
+    EXPECT_TRUE(same(problems.missing_uuids.front(), docs[7]->secret()));
+    EXPECT_EQ(problems.duplicate_uuids, (std::vector<SecretIndex::Key>{1}));
+    ASSERT_EQ(problems.duplicate_usages.size(), 1u);
+    EXPECT_EQ(problems.duplicate_usages.front(), std::pair(SecretIndex::UsageType::ceph, std::string_view{"client.admin"}));
+
+    EXPECT_TRUE(same(index.find(1), docs[0]->secret()));
+    EXPECT_FALSE(index.find(SecretIndex::UsageType::tls, "dup"));
+    EXPECT_TRUE(same(index.find(SecretIndex::UsageType::ceph, "client.admin"), docs[1]->secret()));
+    EXPECT_TRUE(same(index.find(6), docs[6]->secret())); // still found by UUID
+    EXPECT_TRUE(same(index.find(SecretIndex::UsageType::volume, "/base.img"), docs[4]->secret()));
+    EXPECT_FALSE(index.find(SecretIndex::UsageType::iscsi, "/base.img"));
+    EXPECT_FALSE(index.find(7));
+}
+
+TEST_F(SecretIndexTest, ResolvesDiskReferencesThroughBackingChains) {
+    const auto backing = "<backingStore type='file' index='1'><format type='qcow2'/><source file='/base.img'><encryption format='luks'>"
+                         "<secret type='passphrase' usage='/base.img'/></encryption></source><backingStore/></backingStore>";
+    const DomainDocument a{test::DomainXml{"a"}
+                               .uuid(1)
+                               .devices(encrypted_disk("vda", "<secret type='passphrase' uuid='" + test::uuid(1) + "'/>", backing))
+                               .devices(auth_disk("vdb", "<secret type='ceph' usage='client.admin'/>"))
+                               .devices(auth_disk("vdc", "<secret type='ceph' uuid='" + test::uuid(3) + "'/>"))
+                               .devices(auth_disk("vdd", "<secret type='iscsi' uuid='" + test::uuid(3) + "' usage='iqn.other'/>"))
+                               .devices(auth_disk("vde", "<secret type='bogus' usage='client.admin'/>"))
+                               .str()};
+    const DomainDocument b{test::DomainXml{"b"}
+                               .uuid(2)
+                               .devices(encrypted_disk("vda", "<secret type='passphrase'/>"))
+                               .devices(encrypted_disk("vdb", "<secret type='passphrase' uuid='" + test::uuid(99) + "'/>"))
+                               .devices(encrypted_disk("vdc", "<secret type='passphrase' usage='/nope.img'/>"))
+                               .devices(auth_disk("vdd", "<secret type='ceph' uuid='" + test::uuid(2) + "' usage='client.other'/>"))
+                               .str()};
+    const std::vector<std::pair<int, Domain>> domains{{1, a.domain()}, {2, b.domain()}};
+    const auto resolution = index.resolve(domains);
+    EXPECT_EQ(resolution.references, 10u);
+
+    struct Expected {
+        int domain;
+        std::string_view target;
+        std::uint32_t layer;
+        Origin origin;
+        Failure failure;
+    };
+    const std::vector<Expected> expected{
+        {1, "vdc", 0, Origin::auth, Failure::wrong_usage_type},
+        {1, "vdd", 0, Origin::auth, Failure::conflicting},
+        {1, "vde", 0, Origin::auth, Failure::wrong_usage_type},
+        {2, "vda", 0, Origin::encryption, Failure::unspecified},
+        {2, "vdb", 0, Origin::encryption, Failure::unknown_uuid},
+        {2, "vdc", 0, Origin::encryption, Failure::unknown_usage},
+        {2, "vdd", 0, Origin::auth, Failure::conflicting},
+    };
+    ASSERT_EQ(resolution.unresolved.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        const auto& got = resolution.unresolved[i];
+        EXPECT_EQ(got.domain, expected[i].domain) << i;
+        EXPECT_EQ(target_of(got.disk), expected[i].target) << i;
+        EXPECT_EQ(got.layer, expected[i].layer) << i;
+        EXPECT_EQ(got.origin, expected[i].origin) << i;
+        EXPECT_EQ(got.failure, expected[i].failure) << i;
+    }
+
+    // The base image's secret was found by its usage, one layer down
+    ASSERT_EQ(resolution.unused.size(), 2u);
+    EXPECT_TRUE(same(resolution.unused[0], docs[3]->secret()));
+    EXPECT_TRUE(same(resolution.unused[1], docs[6]->secret()));
+}
+
+TEST_F(SecretIndexTest, ReportsTheLayerOfBackingReferences) {
+    const auto backing = "<backingStore type='file' index='3'><format type='qcow2'/><source file='/base.img'><encryption format='luks'>"
+                         "<secret type='passphrase' usage='/gone.img'/></encryption></source></backingStore>";
+    const DomainDocument doc{test::DomainXml{}.uuid(1).devices(encrypted_disk("vda", "<secret type='passphrase' usage='/vda.img'/>", backing)).str()};
+    const std::vector<std::pair<int, Domain>> domains{{1, doc.domain()}};
+    const auto resolution = index.resolve(domains);
+    EXPECT_EQ(resolution.references, 2u);
+    ASSERT_EQ(resolution.unresolved.size(), 1u);
+    EXPECT_EQ(resolution.unresolved.front().layer, 1u);
+    EXPECT_EQ(resolution.unresolved.front().failure, Failure::unknown_usage);
+    EXPECT_EQ(resolution.unused.size(), 5u);
+}
@@ -0,0 +1,188 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <virtxml/catalog.hpp>
+#include <virtxml/shared_snapshot.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+std::string domain_xml(const char* name) {
+    return test::DomainXml{name}.devices("<emulator>/usr/bin/qemu-system-x86_64</emulator>").disk("/var/lib/" + std::string{name} + ".qcow2").str();
+}
+
+std::string_view name_of(Domain dom) { return static_cast<std::string_view>(dom.name()); }
+
+/// A shared memory name of its own for each test, removed afterwards
+struct SharedName {
+    std::string name;
+    explicit SharedName(const char* test) : name(std::string{"/virtxml-test-"} + test + "-" + std::to_string(::getpid())) {}
+    ~SharedName() { SharedSnapshotWriter::remove(name); }
+};
+
+/// Permission bits of the shared memory object `name`, or -1
+int mode_of(const std::string& name) {
+    const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    struct stat st {};
+    const auto ret = fd >= 0 && ::fstat(fd, &st) == 0 ? static_cast<int>(st.st_mode & 0777) : -1;
+    if (fd >= 0)
+        ::close(fd);
+    return ret;
+}
+
+/// Publishes one document as the first generation of `name`, then hands its segment to `tamper` and reports whether a reader takes it
+template <class F> bool reader_accepts_tampered(const std::string& name, F&& tamper) {
+    const DomainDocument doc{domain_xml("tampered")};
+    SharedSnapshotWriter writer{name};
+    writer.add("vm", doc.domain());
+    if (writer.publish() != 1u)
+        return true;
+    const int fd = ::shm_open(shared_snapshot::segment_name(name, 1).c_str(), O_RDWR, 0);
+    struct stat st {};
+    if (fd < 0 || ::fstat(fd, &st) != 0)
+        return true;
+    const auto size = static_cast<std::size_t>(st.st_size);
+    const auto data = static_cast<char*>(::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    tamper(fd, data, size);
+    ::munmap(data, size);
+    ::close(fd);
+    SharedSnapshotReader reader{name};
+    return reader.refresh() || errno != EINVAL;
+}
+} // namespace
+
+TEST(SharedSnapshot, ReadersWalkTheSegmentInPlace) {
+    const SharedName shm{"in-place"};
+    const DomainDocument first{domain_xml("first")};
+    const DomainDocument second{domain_xml("second")};
+    {
+        SharedSnapshotWriter writer{shm.name};
+        writer.add("first", first.domain());
+        writer.add("second", second.domain());
+        ASSERT_EQ(writer.publish(), 1u);
+    }
+
+    SharedSnapshotReader reader{shm.name};
+    ASSERT_TRUE(reader.refresh());
+    EXPECT_EQ(reader.generation(), 1u);
+    EXPECT_EQ(reader.size(), 2u);
+    const auto a = reader.find("first");
+    const auto b = reader.find("second");
+    ASSERT_TRUE(a);
+    ASSERT_TRUE(b);
+    EXPECT_FALSE(reader.find("third"));
+    EXPECT_EQ(a.xml(), nullptr);
+    // Both documents are part of one tree, and share their strings
+    EXPECT_EQ(a.owner(), b.owner());
+    EXPECT_EQ(a->first_node("devices")->first_node("emulator")->value(), b->first_node("devices")->first_node("emulator")->value());
+
+    EXPECT_EQ(name_of(Domain{a}), "first");
+    EXPECT_EQ(name_of(Domain{b}), "second");
+    EXPECT_EQ(static_cast<std::string_view>((*Domain{b}.devices().disks().begin()).source().file()), "/var/lib/second.qcow2");
+
+    std::vector<std::string_view> names;
+    reader.for_each([&](std::string_view key, NodeRef root) {
+        EXPECT_EQ(name_of(Domain{root}), key);
+        names.push_back(key);
+    });
+    EXPECT_EQ(names.size(), 2u);
+    EXPECT_FALSE(reader.refresh());
+}
+
+TEST(SharedSnapshot, ReadersMoveToNewGenerations) {
+    const SharedName shm{"generations"};
+    SharedSnapshotReader reader{shm.name};
+    EXPECT_FALSE(reader.refresh());
+
+    SharedSnapshotWriter writer{shm.name};
+    const DomainDocument first{domain_xml("first")};
+    writer.add("vm", first.domain());
+    ASSERT_EQ(writer.publish(), 1u);
+    ASSERT_TRUE(reader.refresh());
+    EXPECT_EQ(name_of(Domain{reader.find("vm")}), "first");
+
+    writer.clear();
+    const DomainDocument second{domain_xml("second")};
+    writer.add("vm", second.domain());
+    writer.add("empty", NodeRef{});
+    ASSERT_EQ(writer.publish(), 2u);
+    ASSERT_TRUE(reader.refresh());
+    EXPECT_EQ(reader.generation(), 2u);
+    EXPECT_EQ(reader.size(), 2u);
+    EXPECT_EQ(name_of(Domain{reader.find("vm")}), "second");
+    EXPECT_FALSE(reader.find("empty"));
+}
+
+TEST(SharedSnapshot, PublishesSnapshotImages) {
+    const SharedName shm{"images"};
+    const DomainDocument doc{domain_xml("imaged")};
+    SharedSnapshotWriter writer{shm.name};
+    auto image = write_snapshot(doc.domain());
+    ASSERT_TRUE(writer.add_image("vm", image));
+    image[0] = 'X';
+    EXPECT_FALSE(writer.add_image("broken", image));
+    EXPECT_EQ(writer.size(), 1u);
+    ASSERT_TRUE(writer.publish());
+
+    SharedSnapshotReader reader{shm.name};
+    ASSERT_TRUE(reader.refresh());
+    EXPECT_EQ(name_of(Domain{reader.find("vm")}), "imaged");
+}
+
+TEST(SharedSnapshot, SegmentsAreOnlyReadableByTheirOwnerByDefault) {
+    const SharedName shm{"mode"};
+    const DomainDocument doc{domain_xml("private")};
+    const auto umask = ::umask(022);
+    {
+        SharedSnapshotWriter writer{shm.name};
+        writer.add("vm", doc.domain());
+        ASSERT_EQ(writer.publish(), 1u);
+    }
+    EXPECT_EQ(mode_of(shm.name), 0600);
+    EXPECT_EQ(mode_of(shared_snapshot::segment_name(shm.name, 1)), 0600);
+
+    SharedSnapshotWriter shared{shm.name, 0644};
+    shared.add("vm", doc.domain());
+    ASSERT_EQ(shared.publish(), 2u);
+    EXPECT_EQ(mode_of(shared_snapshot::segment_name(shm.name, 2)), 0644);
+    ::umask(umask);
+}
+
+TEST(SharedSnapshot, ReadersRejectDamagedSegments) {
+    using shared_snapshot::Header;
+    const SharedName truncated{"truncated"};
+    EXPECT_FALSE(reader_accepts_tampered(truncated.name, [](int fd, char*, std::size_t size) { ASSERT_EQ(::ftruncate(fd, size - 8), 0); }));
+    const SharedName foreign{"foreign"};
+    EXPECT_FALSE(reader_accepts_tampered(foreign.name, [](int, char* data, std::size_t) { std::memcpy(data, "XXXXXXXX", 8); }));
+    const SharedName cycle{"cycle"};
+    EXPECT_FALSE(reader_accepts_tampered(cycle.name, [](int, char* data, std::size_t) {
+        Header header;
+        std::memcpy(&header, data, sizeof(header));
+        ASSERT_GE(header.element_count, 2u);
+        // The first child of the root links back to it
+        records::Element child;
+        std::memcpy(&child, data + header.elements_offset + sizeof(child), sizeof(child));
+        child.first_child = 0;
+        std::memcpy(data + header.elements_offset + sizeof(child), &child, sizeof(child));
+    }));
+    const SharedName dangling{"dangling"};
+    EXPECT_FALSE(reader_accepts_tampered(dangling.name, [](int, char* data, std::size_t) {
+        Header header;
+        std::memcpy(&header, data, sizeof(header));
+        records::Element root;
+        std::memcpy(&root, data + header.elements_offset, sizeof(root));
+        root.first_child = header.element_count; // past the last record
+        std::memcpy(data + header.elements_offset, &root, sizeof(root));
+    }));
+    // Untouched, the same steps are accepted
+    const SharedName intact{"intact"};
+    EXPECT_TRUE(reader_accepts_tampered(intact.name, [](int, char*, std::size_t) {}));
+}
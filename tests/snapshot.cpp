@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include <virtxml/catalog.hpp>
+#include <virtxml/snapshot.hpp>
+
+using namespace virtxml;
+
+namespace {
+const char* const domain_xml = R"(<domain type='kvm' id='7'>
+  <name>guest</name>
+  <uuid>00000000-0000-0000-0000-00000000002a</uuid>
+  <!-- comments are not kept -->
+  <devices>
+    <disk type='file' device='disk'><source file='/var/lib/a.qcow2'/><target dev='vda' bus='virtio'/></disk>
+    <interface type='network'><source network='default'/></interface>
+    <disk type='file' device='cdrom'><source file='/var/lib/b.iso'/><target dev='sda' bus='sata'/></disk>
+  </devices>
+</domain>)";
+
+std::string_view text(const char* str, std::size_t size) { return {str, size}; }
+
+/// Walks both trees through NodeRef, element by element, as the views do
+void expect_same(NodeRef expected, NodeRef actual) {
+    ASSERT_EQ(static_cast<bool>(expected), static_cast<bool>(actual));
+    if (!expected)
+        return;
+    EXPECT_EQ(text(expected->name(), expected->name_size()), text(actual->name(), actual->name_size()));
+    EXPECT_EQ(text(expected->value(), expected->value_size()), text(actual->value(), actual->value_size()));
+    auto attr = actual->first_attribute();
+    for (auto want = expected->first_attribute(); want; want = want->next_attribute(), attr = attr->next_attribute()) {
+        ASSERT_TRUE(attr);
+        EXPECT_EQ(text(want->name(), want->name_size()), text(attr->name(), attr->name_size()));
+        EXPECT_EQ(text(want->value(), want->value_size()), text(attr->value(), attr->value_size()));
+    }
+    EXPECT_FALSE(attr);
+    auto child = actual->first_node();
+    for (auto want = expected->first_node(); want; want = want->next_sibling()) {
+        if (want->type() != node_element)
+            continue;
+        ASSERT_TRUE(child);
+        EXPECT_EQ(child->parent(), actual);
+        expect_same(want, child);
+        child = child->next_sibling();
+    }
+    EXPECT_FALSE(child);
+}
+
+snapshot::Header header_of(const std::string& image) {
+    snapshot::Header header;
+    std::memcpy(&header, image.data(), sizeof(header));
+    return header;
+}
+records::Element* element_of(std::string& image, std::uint32_t index) {
+    return reinterpret_cast<records::Element*>(image.data() + sizeof(snapshot::Header)) + index;
+}
+} // namespace
+
+TEST(Snapshot, ReadsTheImageInPlace) {
+    const DomainDocument doc{domain_xml};
+    const auto image = write_snapshot(doc.domain());
+    Snapshot snap;
+    ASSERT_TRUE(snap.load(image.data(), image.size()));
+    EXPECT_EQ(snap.size(), 12u);
+
+    const auto root = NodeAccess::of(snap.domain());
+    ASSERT_TRUE(root);
+    EXPECT_EQ(root.xml(), nullptr);
+    EXPECT_EQ(static_cast<const void*>(root.owner()->elements), image.data() + sizeof(snapshot::Header));
+    expect_same(NodeAccess::of(doc.domain()), root);
+
+    const auto dom = snap.domain();
+    EXPECT_EQ(static_cast<std::string_view>(dom.name()), "guest");
+    EXPECT_EQ(static_cast<int>(dom.id()), 7);
+    EXPECT_EQ(static_cast<__uint128_t>(dom.uuid()), 0x2a);
+    std::vector<std::string_view> files;
+    for (const auto disk : dom.devices().disks())
+        files.push_back(static_cast<std::string_view>(disk.source().file()));
+    EXPECT_EQ(files, (std::vector<std::string_view>{"/var/lib/a.qcow2", "/var/lib/b.iso"}));
+    EXPECT_FALSE(snap.device());
+}
+
+TEST(Snapshot, WalksBackwardThroughForwardLinks) {
+    const DomainDocument doc{domain_xml};
+    const auto image = write_snapshot(doc.domain());
+    Snapshot snap;
+    ASSERT_TRUE(snap.load(image.data(), image.size()));
+    const auto devices = NodeAccess::of(snap.domain().devices());
+    const auto last = devices->last_node("disk");
+    ASSERT_TRUE(last);
+    const auto dev = last->first_node("target")->first_attribute("dev");
+    EXPECT_EQ(text(dev->value(), dev->value_size()), "sda");
+    EXPECT_EQ(last->previous_sibling("disk"), devices->first_node("disk"));
+    EXPECT_EQ(last->previous_sibling(), devices->first_node("interface"));
+    EXPECT_FALSE(devices->first_node()->previous_sibling());
+    EXPECT_FALSE(NodeAccess::of(snap.domain())->parent());
+}
+
+TEST(Snapshot, RewritesItsOwnViewsIdentically) {
+    const DomainDocument doc{domain_xml};
+    const auto image = write_snapshot(doc.domain());
+    Snapshot snap;
+    ASSERT_TRUE(snap.load(image.data(), image.size()));
+    EXPECT_EQ(write_snapshot(snap.domain()), image);
+}
+
+TEST(Snapshot, StoresEachStringOnce) {
+    const DomainDocument doc{domain_xml};
+    const auto image = write_snapshot(doc.domain());
+    const auto header = header_of(image);
+    const std::string_view strings{image.data() + image.size() - header.strings_size, header.strings_size};
+    EXPECT_EQ(strings.find("file"), strings.rfind("file"));
+    EXPECT_EQ(strings.find("disk"), strings.rfind("disk"));
+}
+
+TEST(Snapshot, RejectsMalformedImages) {
+    const DomainDocument doc{domain_xml};
+    const auto image = write_snapshot(doc.domain());
+    Snapshot snap;
+
+    EXPECT_FALSE(snap.load(image.data(), image.size() - 1));
+    auto foreign = image;
+    foreign[0] = 'X';
+    EXPECT_FALSE(snap.load(foreign.data(), foreign.size()));
+
+    // A child link pointing back to an ancestor would make the views loop forever
+    auto cycle = image;
+    element_of(cycle, 1)->first_child = 0;
+    EXPECT_FALSE(snap.load(cycle.data(), cycle.size()));
+    auto sibling = image;
+    element_of(sibling, 2)->next_sibling = 1;
+    EXPECT_FALSE(snap.load(sibling.data(), sibling.size()));
+    auto adopted = image;
+    element_of(adopted, 0)->first_child = 4;
+    EXPECT_FALSE(snap.load(adopted.data(), adopted.size()));
+
+    auto string = image;
+    element_of(string, 1)->name.offset = header_of(image).strings_size;
+    EXPECT_FALSE(snap.load(string.data(), string.size()));
+    auto unterminated = image;
+    element_of(unterminated, 1)->name.size += 1;
+    EXPECT_FALSE(snap.load(unterminated.data(), unterminated.size()));
+
+    EXPECT_FALSE(snap.domain());
+    EXPECT_TRUE(snap.load(image.data(), image.size()));
+    EXPECT_TRUE(snap.domain());
+}
+
+TEST(Snapshot, MapsSavedFiles) {
+    const DomainDocument doc{domain_xml};
+    const auto image = write_snapshot(doc.domain());
+    char path[] = "/tmp/virtxml-snapshot-XXXXXX";
+    const int fd = ::mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ::close(fd);
+    ASSERT_TRUE(save_snapshot(path, image));
+    {
+        Snapshot snap;
+        ASSERT_TRUE(snap.open(path));
+        expect_same(NodeAccess::of(doc.domain()), NodeAccess::of(snap.domain()));
+    }
+    std::remove(path);
+}
+
+TEST(Snapshot, SavesByReplacingTheWholeFile) {
+    const DomainDocument doc{domain_xml};
+    const DomainDocument other{"<domain type='kvm'><name>other</name></domain>"};
+    char dir[] = "/tmp/virtxml-snapshot-XXXXXX";
+    ASSERT_NE(::mkdtemp(dir), nullptr);
+    const auto path = std::string{dir} + "/domain.snap";
+    ASSERT_TRUE(save_snapshot(path.c_str(), write_snapshot(doc.domain())));
+
+    // A snapshot mapping the previous file keeps reading it whole
+    Snapshot before;
+    ASSERT_TRUE(before.open(path.c_str()));
+    ASSERT_TRUE(save_snapshot(path.c_str(), write_snapshot(other.domain())));
+    expect_same(NodeAccess::of(doc.domain()), NodeAccess::of(before.domain()));
+    Snapshot after;
+    ASSERT_TRUE(after.open(path.c_str()));
+    EXPECT_EQ(static_cast<std::string_view>(after.domain().name()), "other");
+
+    EXPECT_FALSE(save_snapshot((std::string{dir} + "/missing/domain.snap").c_str(), write_snapshot(doc.domain())));
+    std::vector<std::string> files;
+    if (const auto stream = opendir(dir)) {
+        while (const auto entry = readdir(stream))
+            if (entry->d_name[0] != '.')
+                files.emplace_back(entry->d_name);
+        closedir(stream);
+    }
+    EXPECT_EQ(files, std::vector<std::string>{"domain.snap"}); // no temporary file left behind
+    std::remove(path.c_str());
+    ::rmdir(dir);
+}
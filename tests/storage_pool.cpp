@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <virtxml/storage_pool.hpp>
+
+using namespace virtxml;
+
+namespace {
+constexpr auto pool_xml = R"(<pool type='dir'>
+  <name>default</name>
+  <uuid>00000000-0000-0000-0000-000000000001</uuid>
+  <capacity unit='bytes'>107374182400</capacity>
+  <target><path>/var/lib/libvirt/images</path></target>
+</pool>)";
+
+std::string volume_xml(std::string_view name, std::string_view sizes) {
+    return "<volume type='file'><name>" + std::string{name} + "</name><key>/var/lib/libvirt/images/" + std::string{name} + "</key>" +
+           std::string{sizes} + "</volume>";
+}
+
+std::string_view name_of(storage::Volume volume) { return static_cast<std::string_view>(volume.name()); }
+} // namespace
+
+TEST(StoragePool, KeepsEarlierVolumesAcrossRejectedDocuments) {
+    StoragePool pool{pool_xml};
+    ASSERT_TRUE(pool.pool());
+    EXPECT_EQ(static_cast<std::string_view>(pool.pool().name()), "default");
+
+    ASSERT_TRUE(pool.add_volume(volume_xml("a.img", "<capacity unit='b'>1000</capacity>")));
+    const auto a = pool.find_volume("/var/lib/libvirt/images/a.img");
+    ASSERT_TRUE(a);
+    const std::vector<std::string> rejected{"<volume><name>broken", "<pool type='dir'><name>other</name></pool>", "", "<volume"};
+    EXPECT_EQ(pool.add_volumes(rejected), rejected.size());
+    EXPECT_TRUE(pool.add_volume(volume_xml("b.img", "")));
+
+    EXPECT_EQ(pool.volume_count(), 2u);
+    EXPECT_EQ(name_of(a), "a.img");
+    EXPECT_EQ(a.capacity().bytes(), 1000u);
+    EXPECT_EQ(static_cast<std::string_view>(pool.pool().name()), "default");
+    std::vector<std::string_view> names;
+    for (const auto volume : pool.volume_list())
+        names.push_back(name_of(volume));
+    EXPECT_EQ(names, (std::vector<std::string_view>{"a.img", "b.img"}));
+}
+
+TEST(StoragePool, FindsVolumesByKey) {
+    StoragePool pool{pool_xml};
+    pool.add_volume(volume_xml("a.img", ""));
+    pool.add_volume(volume_xml("b.img", ""));
+    pool.add_volume("<volume type='file'><name>keyless.img</name></volume>");
+    EXPECT_EQ(name_of(pool.find_volume("/var/lib/libvirt/images/b.img")), "b.img");
+    EXPECT_FALSE(pool.find_volume("/var/lib/libvirt/images/keyless.img"));
+    EXPECT_FALSE(pool.find_volume("b.img"));
+
+    // A key added again names the volume added last
+    pool.add_volume("<volume type='block'><name>a-again.img</name><key>/var/lib/libvirt/images/a.img</key></volume>");
+    EXPECT_EQ(name_of(pool.find_volume("/var/lib/libvirt/images/a.img")), "a-again.img");
+    EXPECT_EQ(pool.volume_count(), 4u);
+}
+
+TEST(StoragePool, ScalesSizesByTheirUnit) {
+    StoragePool pool{pool_xml};
+    ASSERT_TRUE(pool.add_volume(volume_xml("a.img", "<capacity unit='b'>512</capacity><allocation unit='KB'>2</allocation>"
+                                                    "<physical unit='KiB'>2</physical>")));
+    ASSERT_TRUE(pool.add_volume(volume_xml("b.img", "<capacity unit='blocks'>1</capacity><allocation>7</allocation>")));
+    const auto a = pool.find_volume("/var/lib/libvirt/images/a.img");
+    EXPECT_EQ(a.capacity().bytes(), 512u);
+    EXPECT_EQ(a.allocation().bytes(), 2000u);
+    EXPECT_EQ(a.physical().bytes(), 2048u);
+    const auto b = pool.find_volume("/var/lib/libvirt/images/b.img");
+    EXPECT_FALSE(b.capacity().bytes());
+    EXPECT_EQ(b.allocation().bytes(), 7u);
+    EXPECT_EQ(pool.pool().capacity().bytes(), 107374182400u);
+
+    EXPECT_EQ(unit_scale("B"), 1u);
+    EXPECT_EQ(unit_scale("KB"), 1000u);
+    EXPECT_EQ(unit_scale("KiB"), 1024u);
+    EXPECT_EQ(unit_scale("k"), 1024u);
+    EXPECT_FALSE(unit_scale("blocks"));
+    EXPECT_FALSE(unit_scale("KiBB"));
+    EXPECT_FALSE(unit_scale(""));
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <virtxml/catalog.hpp>
+#include <virtxml/validated_domain.hpp>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+
+namespace {
+using Problem = ValidationError::Problem;
+
+constexpr auto os = "<type arch='x86_64' machine='q35'>hvm</type><boot dev='hd' order='first'/><bootmenu enable='yes'/>";
+
+std::string_view name_of(NodeRef element) { return {element->name(), element->name_size()}; }
+} // namespace
+
+TEST(ValidatedDomain, AcceptsWellFormedDomains) {
+    const DomainDocument doc{test::DomainXml{"vm"}
+                                 .uuid(1)
+                                 .os(os) // boot@order is only checked outside <os>
+                                 .devices("<disk type='file' device='disk'><source file='/a.img'/><target dev='vda'/><boot order='1'/>"
+                                          "<address type='pci' domain='0x0000' bus='0x00' slot='0x04' function='0x0'/></disk>"
+                                          "<interface type='network'><source network='default'/><boot order='2'/></interface>"
+                                          "<hostdev mode='subsystem' type='pci' managed='yes'><source>"
+                                          "<address domain='0x0000' bus='0x05' slot='0x00' function='0x0'/></source></hostdev>"
+                                          "<rng model='virtio'><backend model='random'>/dev/urandom</backend></rng>")
+                                 .str()};
+    std::vector<ValidationError> errors;
+    const auto validated = validate(doc.domain(), &errors);
+    ASSERT_TRUE(validated);
+    EXPECT_TRUE(errors.empty());
+    EXPECT_EQ(static_cast<std::string_view>(validated->name()), "vm");
+}
+
+TEST(ValidatedDomain, RejectsWhatUncheckedAccessorsWouldDereference) {
+    const DomainDocument doc{test::DomainXml{"vm"}
+                                 .uuid(1)
+                                 .os("<type>hvm</type><boot dev='floppyy'/>")
+                                 .devices("<disk type='file' device='disk'><source file='/a.img'/><boot order='first'/></disk>"
+                                          "<interface><source network='default'/></interface>"
+                                          "<rng model='virtio'/>"
+                                          "<controller type='usb'><address type='pcie'/></controller>")
+                                 .str()};
+    EXPECT_FALSE(validate(doc.domain()));
+
+    std::vector<ValidationError> errors;
+    EXPECT_FALSE(ValidatedDomain::validate(doc.domain(), &errors));
+    struct Expected {
+        std::string_view element;
+        std::string_view item;
+        Problem problem;
+    };
+    const std::vector<Expected> expected{
+        {"boot", "@dev", Problem::bad_value},
+        {"boot", "@order", Problem::bad_value},
+        {"interface", "@type", Problem::missing_attribute},
+        {"rng", "backend", Problem::missing_element},
+        {"address", "@type", Problem::bad_value},
+    };
+    ASSERT_EQ(errors.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(name_of(errors[i].element), expected[i].element) << i;
+        EXPECT_EQ(errors[i].item, expected[i].item) << i;
+        EXPECT_EQ(errors[i].problem, expected[i].problem) << i;
+    }
+}
+
+TEST(ValidatedDomain, ChecksOptionalAttributesOnlyWhenPresent) {
+    const DomainDocument bad{test::DomainXml{}.uuid(1).os("<type arch='pdp11'>hvm</type>").str()};
+    std::vector<ValidationError> errors;
+    EXPECT_FALSE(validate(bad.domain(), &errors));
+    ASSERT_EQ(errors.size(), 1u);
+    EXPECT_EQ(errors.front().item, "@arch");
+    EXPECT_EQ(errors.front().problem, Problem::bad_value);
+
+    const DomainDocument good{test::DomainXml{}.uuid(1).os("<type>hvm</type>").str()};
+    EXPECT_TRUE(validate(good.domain()));
+    EXPECT_FALSE(validate(Domain{nullptr}));
+}
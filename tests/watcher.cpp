@@ -0,0 +1,145 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <virtxml/watcher.hpp>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "domain_xml.hpp"
+
+using namespace virtxml;
+using namespace std::chrono_literals;
+
+namespace {
+/// A directory of its own for each test, removed with its files afterwards
+struct TempDir {
+    std::string path;
+    TempDir() {
+        char name[] = "/tmp/virtxml-watcher-XXXXXX";
+        path = ::mkdtemp(name);
+    }
+    ~TempDir() {
+        if (const auto stream = opendir(path.c_str())) {
+            while (const auto entry = readdir(stream))
+                if (entry->d_name[0] != '.')
+                    std::remove((path + '/' + entry->d_name).c_str());
+            closedir(stream);
+        }
+        ::rmdir(path.c_str());
+    }
+
+    [[nodiscard]] std::string file(std::string_view name) const { return path + '/' + std::string{name}; }
+    void write(std::string_view name, const std::string& text) const { std::ofstream{file(name), std::ios::binary} << text; }
+};
+
+std::string domain_xml(const char* name, unsigned id) { return test::DomainXml{name}.uuid(id).str(); }
+
+std::string_view name_of(const DomainCatalog& catalog, DomainCatalog::Key key) {
+    const auto doc = catalog.read().find(key);
+    return doc != nullptr ? static_cast<std::string_view>(doc->domain().name()) : std::string_view{};
+}
+
+/// Polls until the backlog is empty, summing what was applied
+DomainDirectoryWatcher::Changes drain(DomainDirectoryWatcher& watcher) {
+    DomainDirectoryWatcher::Changes ret;
+    for (int i = 0; i < 100; ++i) {
+        const auto changes = watcher.poll(100ms);
+        ret.published += changes.published;
+        ret.erased += changes.erased;
+        ret.failed += changes.failed;
+        if (watcher.backlog() == 0 && changes.published + changes.erased + changes.failed == 0)
+            break;
+    }
+    return ret;
+}
+} // namespace
+
+TEST(DomainDirectoryWatcher, FollowsCreationRewriteRenameAndDeletion) {
+    const TempDir dir;
+    dir.write("a.xml", domain_xml("a", 1));
+    DomainCatalog catalog{4};
+    DomainDirectoryWatcher watcher{10ms};
+    ASSERT_TRUE(watcher.valid());
+    ASSERT_TRUE(watcher.watch(dir.path, catalog));
+    EXPECT_EQ(drain(watcher).published, 1u);
+    EXPECT_EQ(name_of(catalog, 1), "a");
+
+    dir.write("b.xml", domain_xml("b", 2));
+    dir.write("a.xml", domain_xml("a-rewritten", 1));
+    auto changes = drain(watcher);
+    EXPECT_EQ(changes.published, 2u);
+    EXPECT_EQ(name_of(catalog, 1), "a-rewritten");
+    EXPECT_EQ(name_of(catalog, 2), "b");
+
+    // Written aside under a name that is not watched, then renamed in, as libvirt saves its files
+    dir.write(".c.xml.new", domain_xml("c", 3));
+    ASSERT_EQ(std::rename(dir.file(".c.xml.new").c_str(), dir.file("c.xml").c_str()), 0);
+    dir.write("broken.xml", "<domain");
+    changes = drain(watcher);
+    EXPECT_EQ(changes.published, 1u);
+    EXPECT_EQ(changes.failed, 1u);
+    EXPECT_EQ(name_of(catalog, 3), "c");
+
+    std::remove(dir.file("b.xml").c_str());
+    changes = drain(watcher);
+    EXPECT_EQ(changes.erased, 1u);
+    EXPECT_EQ(catalog.read().find(2), nullptr);
+    EXPECT_EQ(catalog.read().size(), 2u);
+}
+
+TEST(DomainDirectoryWatcher, KeepsAUuidWhileAnyFileBacksIt) {
+    const TempDir dir;
+    dir.write("first.xml", domain_xml("first", 1));
+    dir.write("second.xml", domain_xml("second", 1));
+    DomainCatalog catalog{4};
+    DomainDirectoryWatcher watcher{10ms};
+    ASSERT_TRUE(watcher.watch(dir.path, catalog));
+    drain(watcher);
+    ASSERT_NE(catalog.read().find(1), nullptr);
+
+    // second.xml was applied last, so the catalog holds its version
+    EXPECT_EQ(name_of(catalog, 1), "second");
+    std::remove(dir.file("second.xml").c_str());
+    auto changes = drain(watcher);
+    EXPECT_EQ(changes.erased, 0u);
+    EXPECT_EQ(name_of(catalog, 1), "first"); // republished from the file left
+
+    // A file moving to another UUID releases the old one
+    dir.write("first.xml", domain_xml("first", 2));
+    changes = drain(watcher);
+    EXPECT_EQ(changes.erased, 1u);
+    EXPECT_EQ(catalog.read().find(1), nullptr);
+    EXPECT_EQ(name_of(catalog, 2), "first");
+
+    std::remove(dir.file("first.xml").c_str());
+    drain(watcher);
+    EXPECT_EQ(catalog.read().size(), 0u);
+}
+
+TEST(DomainDirectoryWatcher, DebouncesAndBatches) {
+    const TempDir dir;
+    DomainCatalog catalog{4};
+    DomainDirectoryWatcher watcher{50ms, 2};
+    ASSERT_TRUE(watcher.watch(dir.path, catalog));
+    EXPECT_EQ(watcher.poll(0ms).published, 0u);
+
+    // Rewrites within the debounce delay cost a single parse
+    for (int i = 0; i < 5; ++i)
+        dir.write("a.xml", domain_xml(("a" + std::to_string(i)).c_str(), 1));
+    for (const auto name : {"b.xml", "c.xml", "d.xml"})
+        dir.write(name, domain_xml(name, 2 + (name[0] - 'b')));
+    const auto quiet = watcher.poll(0ms);
+    EXPECT_EQ(quiet.published, 0u); // nothing has been quiet long enough yet
+    EXPECT_EQ(watcher.backlog(), 4u);
+
+    EXPECT_EQ(watcher.poll(1s).published, 2u);
+    EXPECT_EQ(watcher.backlog(), 2u);
+    EXPECT_EQ(watcher.poll(1s).published, 2u);
+    EXPECT_EQ(watcher.backlog(), 0u);
+    EXPECT_EQ(name_of(catalog, 1), "a4");
+    EXPECT_EQ(catalog.read().size(), 4u);
+}
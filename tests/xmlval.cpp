@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <virtxml/domain.hpp>
+#include <virtxml/xmlval.hpp>
+
+using namespace virtxml;
+
+TEST(EnumCastXml, MatchesKeywordEnumeratorsWithoutTheirTrailingUnderscore) {
+    using Type = Domain::Devices::QemuCharDevType;
+    EXPECT_EQ(enum_cast_xml<Type>("unix"), Type::unix_);
+    EXPECT_EQ(enum_cast_xml<Type>("pty"), Type::pty);
+    EXPECT_FALSE(enum_cast_xml<Type>("socket"));
+    EXPECT_FALSE(enum_cast_xml<Type>(""));
+    EXPECT_EQ(magic_enum::enum_name(Type::unix_), "unix");
+}
+
+TEST(EnumCastXml, MapsDashesOnlyWhenAsked) {
+    using Model = Domain::Devices::Tpm::Model;
+    EXPECT_EQ(enum_cast_xml<Model>("tpm-tis", true), Model::tpm_tis);
+    EXPECT_FALSE(enum_cast_xml<Model>("tpm-tis"));
+}
+
+TEST(EnumCastXml, RejectsSpellingsLongerThanItsBuffer) {
+    using Type = Domain::Devices::QemuCharDevType;
+    const std::string padded = "host-model" + std::string(100, '-');
+    EXPECT_FALSE(enum_cast_xml<Type>(padded, true));
+}
+
+namespace {
+/// Parses `xml`, kept alive in `text`, and returns its root element
+xml_node<>* parse_root(xml_document<>& doc, std::string& text) {
+    doc.parse<0>(text.data());
+    return doc.first_node();
+}
+} // namespace
+
+TEST(Integral, ReadsDecimalUnlessHexPrefixed) {
+    std::string text = "<size a='010' b='0x10' c=' -012' d='-0x1f' e='08'>010</size>";
+    xml_document<> doc;
+    const auto root = parse_root(doc, text);
+    EXPECT_EQ(static_cast<long long>(Integral{root}), 10);
+    EXPECT_EQ(static_cast<long long>(Integral{root->first_attribute("a")}), 10);
+    EXPECT_EQ(static_cast<unsigned long long>(Integral{root->first_attribute("b")}), 16u);
+    EXPECT_EQ(static_cast<long long>(Integral{root->first_attribute("c")}), -12);
+    EXPECT_EQ(static_cast<long long>(Integral{root->first_attribute("d")}), -31);
+    EXPECT_EQ(static_cast<int>(Integral{root->first_attribute("e")}), 8);
+}
+
+TEST(Integral, IsIntegerFollowsTheSameRule) {
+    EXPECT_TRUE(is_integer("010"));
+    EXPECT_TRUE(is_integer("08"));
+    EXPECT_TRUE(is_integer("-0x1F"));
+    EXPECT_TRUE(is_integer("+7"));
+    EXPECT_FALSE(is_integer("0x"));
+    EXPECT_FALSE(is_integer("1f"));
+    EXPECT_FALSE(is_integer(" 1"));
+    EXPECT_FALSE(is_integer("-"));
+    EXPECT_FALSE(is_integer(""));
+}
+
+TEST(ScaledIntegral, RejectsNegativeSizes) {
+    std::string text = "<sizes><a unit='KiB'>010</a><b unit='KiB'>-1</b><c> -1</c><d unit='parsecs'>1</d><e unit='EiB'>16</e></sizes>";
+    xml_document<> doc;
+    const auto root = parse_root(doc, text);
+    EXPECT_EQ(ScaledIntegral{root->first_node("a")}.bytes(), 10u * 1024u);
+    EXPECT_FALSE(ScaledIntegral{root->first_node("b")}.bytes());
+    EXPECT_FALSE(ScaledIntegral{root->first_node("c")}.bytes(1024));
+    EXPECT_FALSE(ScaledIntegral{root->first_node("d")}.bytes());
+    EXPECT_FALSE(ScaledIntegral{root->first_node("e")}.bytes()); // overflows
+}
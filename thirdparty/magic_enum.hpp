@@ -177,7 +177,7 @@ template <typename E, E V>
     // pop an underscore from the back of the string if there is any
     // allows to use keywords as enum values when suffixed by an underscore
     constexpr auto name_fixed = !name.empty() && name.back() == '_' ? name.substr(0, name.size() - 1) : name;
-    return static_string<name.size()>{name_fixed};
+    return static_string<name_fixed.size()>{name_fixed};
 /// END PATCH
 #endif
 }
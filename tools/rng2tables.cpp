@@ -0,0 +1,673 @@
+// Compiles a RelaxNG schema in XML syntax, with the files it includes, into the automata tables of <virtxml/schema.hpp>
+// Usage: rng2tables <schema.rng> <identifier> <output.hpp>
+//
+// Every <element> pattern gets an NFA over its child elements, which is then determinized over element names.
+// The result accepts every valid document; where a pattern cannot be expressed exactly it is widened, never narrowed:
+// - <interleave> becomes any repetition of its members, so required members of an interleave are not enforced
+// - an attribute under <choice>, <optional> or <zeroOrMore> is optional, whichever branch is taken
+// - elements of the same name reachable from one state share a definition merging their attributes and content
+// - <except>, <param> and <list> are not checked; <externalRef> and <parentRef> leave the element's content unchecked
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <rapidxml_ns.hpp>
+
+namespace {
+using Node = rapidxml_ns::xml_node<>;
+
+[[nodiscard]] std::string_view local_name(const Node* node) {
+    const std::string_view name{node->name(), node->name_size()};
+    const auto colon = name.find(':');
+    return colon == std::string_view::npos ? name : name.substr(colon + 1);
+}
+[[nodiscard]] bool is_annotation(const Node* node) {
+    // Foreign elements such as <a:documentation> carry a prefix; RelaxNG ones use the default namespace
+    return std::string_view{node->name(), node->name_size()}.find(':') != std::string_view::npos;
+}
+[[nodiscard]] std::string attribute(const Node* node, const char* name) {
+    const auto attr = node->first_attribute(name);
+    return attr != nullptr ? std::string{attr->value(), attr->value_size()} : std::string{};
+}
+[[nodiscard]] std::string trimmed(std::string_view str) {
+    const auto first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos)
+        return {};
+    return std::string{str.substr(first, str.find_last_not_of(" \t\r\n") - first + 1)};
+}
+[[nodiscard]] const Node* next_pattern(const Node* node) {
+    while (node != nullptr && (node->type() != rapidxml_ns::node_element || is_annotation(node)))
+        node = node->next_sibling();
+    return node;
+}
+[[nodiscard]] const Node* first_pattern(const Node* parent) { return next_pattern(parent->first_node()); }
+
+/// Defines and start patterns of a schema and everything it includes
+class Grammar {
+    std::deque<std::string> texts;
+    std::deque<rapidxml_ns::xml_document<>> documents;
+
+    void overrides_of(const Node* container, std::set<std::string>& names) {
+        for (auto child = first_pattern(container); child != nullptr; child = next_pattern(child->next_sibling())) {
+            const auto kind = local_name(child);
+            if (kind == "define")
+                names.insert(attribute(child, "name"));
+            else if (kind == "start")
+                names.insert("#start");
+            else if (kind == "div")
+                overrides_of(child, names);
+        }
+    }
+
+    bool collect(const Node* container, const std::string& dir, const std::set<std::string>& overridden) {
+        for (auto child = first_pattern(container); child != nullptr; child = next_pattern(child->next_sibling())) {
+            const auto kind = local_name(child);
+            if (kind == "define") {
+                if (const auto name = attribute(child, "name"); overridden.count(name) == 0)
+                    defines[name].push_back(child);
+            } else if (kind == "start") {
+                if (overridden.count("#start") == 0)
+                    starts.push_back(child);
+            } else if (kind == "div") {
+                if (!collect(child, dir, overridden))
+                    return false;
+            } else if (kind == "include") {
+                // Definitions inside <include> replace those of the included grammar
+                auto names = overridden;
+                overrides_of(child, names);
+                if (!load(dir + attribute(child, "href"), names) || !collect(child, dir, overridden))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+  public:
+    std::map<std::string, std::vector<const Node*>> defines; // several when combined, which is treated as a choice
+    std::vector<const Node*> starts;
+
+    bool load(const std::string& path, const std::set<std::string>& overridden = {}) {
+        std::ifstream file{path, std::ios::binary};
+        if (!file) {
+            std::fprintf(stderr, "rng2tables: cannot read %s\n", path.c_str());
+            return false;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        auto& text = texts.emplace_back(contents.str());
+        auto& doc = documents.emplace_back();
+        try {
+            doc.parse<0>(text.data());
+        } catch (const rapidxml_ns::parse_error& e) {
+            std::fprintf(stderr, "rng2tables: %s: %s\n", path.c_str(), e.what());
+            return false;
+        }
+        const auto root = first_pattern(&doc);
+        if (root == nullptr)
+            return false;
+        const auto slash = path.rfind('/');
+        const auto dir = slash == std::string::npos ? std::string{} : path.substr(0, slash + 1);
+        if (local_name(root) == "grammar")
+            return collect(root, dir, overridden);
+        starts.push_back(root); // a bare pattern is its own start
+        return true;
+    }
+};
+
+enum class ValueKind { any, enumeration, integer, unsigned_integer };
+struct ValueSet {
+    ValueKind kind = ValueKind::any;
+    std::set<std::string> values;
+
+    void merge(const ValueSet& other) {
+        if (kind == other.kind) {
+            values.insert(other.values.begin(), other.values.end());
+            return;
+        }
+        const auto numeric = [](ValueKind k) { return k == ValueKind::integer || k == ValueKind::unsigned_integer; };
+        kind = numeric(kind) && numeric(other.kind) ? ValueKind::integer : ValueKind::any;
+        values.clear();
+    }
+};
+
+struct AttributeInfo {
+    bool required;
+    ValueSet value;
+};
+struct ElementPattern {
+    std::vector<std::string> names; // empty for any name
+    int start = -1;
+    std::map<std::string, AttributeInfo> attributes;
+    bool text = false;
+    ValueSet text_value; // when the content is a single datatype or value list
+    bool any_attributes = false;
+    bool any_content = false;
+};
+struct NfaState {
+    std::vector<int> epsilon;
+    std::vector<std::pair<int, int>> edges; // (element pattern, target)
+};
+
+class Compiler {
+    const Grammar& grammar;
+    std::vector<NfaState> nfa;
+    std::vector<ElementPattern> elements;
+    std::map<const Node*, int> element_ids;
+    std::set<int> accepting;
+    int depth = 0;
+    bool failed = false;
+
+    struct Fragment {
+        int in;
+        int out;
+    };
+
+    int state() {
+        nfa.emplace_back();
+        return static_cast<int>(nfa.size() - 1);
+    }
+    void epsilon(int from, int to) { nfa[from].epsilon.push_back(to); }
+
+    const std::vector<const Node*>* resolve(const Node* ref) {
+        const auto it = grammar.defines.find(attribute(ref, "name"));
+        if (it != grammar.defines.end())
+            return &it->second;
+        std::fprintf(stderr, "rng2tables: undefined reference %s\n", attribute(ref, "name").c_str());
+        failed = true;
+        return nullptr;
+    }
+
+    ValueSet value_of(const Node* pattern) {
+        ValueSet ret;
+        if (pattern == nullptr)
+            return ret;
+        if (++depth > 1000) {
+            --depth;
+            return ret;
+        }
+        const auto kind = local_name(pattern);
+        if (kind == "value") {
+            ret.kind = ValueKind::enumeration;
+            ret.values.insert(trimmed({pattern->value(), pattern->value_size()}));
+        } else if (kind == "data") {
+            static const std::set<std::string_view> unsigned_types = {"unsignedByte", "unsignedShort", "unsignedInt", "unsignedLong",
+                                                                      "positiveInteger", "nonNegativeInteger"};
+            static const std::set<std::string_view> signed_types = {"byte", "short", "int", "long", "integer", "negativeInteger", "nonPositiveInteger"};
+            const auto type = attribute(pattern, "type");
+            ret.kind = unsigned_types.count(type) != 0 ? ValueKind::unsigned_integer : signed_types.count(type) != 0 ? ValueKind::integer : ValueKind::any;
+        } else if (kind == "choice") {
+            bool first = true;
+            for (auto branch = first_pattern(pattern); branch != nullptr; branch = next_pattern(branch->next_sibling())) {
+                auto value = value_of(branch);
+                if (first)
+                    ret = std::move(value);
+                else
+                    ret.merge(value);
+                first = false;
+            }
+        } else if (kind == "ref") {
+            bool first = true;
+            if (const auto defines = resolve(pattern)) {
+                for (const auto define : *defines) {
+                    const auto body = first_pattern(define);
+                    auto value = body != nullptr && next_pattern(body->next_sibling()) == nullptr ? value_of(body) : ValueSet{};
+                    if (first)
+                        ret = std::move(value);
+                    else
+                        ret.merge(value);
+                    first = false;
+                }
+            }
+        }
+        --depth;
+        return ret;
+    }
+
+    void add_attribute(const Node* pattern, int owner, bool optional) {
+        auto& element = elements[owner];
+        std::vector<std::string> names;
+        auto content = first_pattern(pattern);
+        if (pattern->first_attribute("name") != nullptr) {
+            names.push_back(attribute(pattern, "name"));
+        } else if (content != nullptr) {
+            if (!name_class(content, names)) {
+                element.any_attributes = true;
+                return;
+            }
+            content = next_pattern(content->next_sibling());
+        }
+        const auto value = content != nullptr && next_pattern(content->next_sibling()) == nullptr ? value_of(content) : ValueSet{};
+        for (const auto& name : names) {
+            const auto [it, inserted] = element.attributes.try_emplace(name, AttributeInfo{!optional, value});
+            if (!inserted) {
+                it->second.required = it->second.required && !optional;
+                it->second.value.merge(value);
+            }
+        }
+    }
+
+    /// Names listed by a name class; false if it admits any name
+    static bool name_class(const Node* node, std::vector<std::string>& names) {
+        const auto kind = local_name(node);
+        if (kind == "name") {
+            names.push_back(trimmed({node->value(), node->value_size()}));
+            return true;
+        }
+        if (kind == "choice") {
+            for (auto child = first_pattern(node); child != nullptr; child = next_pattern(child->next_sibling()))
+                if (!name_class(child, names))
+                    return false;
+            return true;
+        }
+        return false; // anyName, nsName
+    }
+
+    Fragment sequence(const Node* first, int owner, bool optional) {
+        const auto in = state();
+        auto at = in;
+        for (auto child = first; child != nullptr; child = next_pattern(child->next_sibling())) {
+            const auto frag = pattern(child, owner, optional);
+            epsilon(at, frag.in);
+            at = frag.out;
+        }
+        return Fragment{in, at};
+    }
+
+    Fragment pattern(const Node* node, int owner, bool optional) {
+        if (++depth > 1000) {
+            std::fprintf(stderr, "rng2tables: reference loop through %s\n", std::string{local_name(node)}.c_str());
+            failed = true;
+        }
+        const auto kind = local_name(node);
+        Fragment ret{-1, -1};
+        if (failed) {
+            ret.in = ret.out = state();
+        } else if (kind == "element") {
+            ret = Fragment{state(), state()};
+            const auto id = element(node);
+            nfa[ret.in].edges.emplace_back(id, ret.out);
+        } else if (kind == "attribute") {
+            if (owner >= 0)
+                add_attribute(node, owner, optional);
+            ret.in = ret.out = state();
+        } else if (kind == "text" || kind == "data" || kind == "value" || kind == "list") {
+            if (owner >= 0)
+                elements[owner].text = true;
+            ret.in = ret.out = state();
+        } else if (kind == "notAllowed") {
+            ret = Fragment{state(), state()};
+        } else if (kind == "interleave") {
+            const auto hub = state();
+            for (auto child = first_pattern(node); child != nullptr; child = next_pattern(child->next_sibling())) {
+                const auto frag = pattern(child, owner, optional);
+                epsilon(hub, frag.in);
+                epsilon(frag.out, hub);
+            }
+            ret = Fragment{hub, hub};
+        } else if (kind == "choice") {
+            ret = Fragment{state(), state()};
+            const auto first = first_pattern(node);
+            const bool single = first != nullptr && next_pattern(first->next_sibling()) == nullptr;
+            for (auto child = first; child != nullptr; child = next_pattern(child->next_sibling())) {
+                const auto frag = pattern(child, owner, optional || !single);
+                epsilon(ret.in, frag.in);
+                epsilon(frag.out, ret.out);
+            }
+        } else if (kind == "optional" || kind == "zeroOrMore" || kind == "oneOrMore") {
+            const auto frag = sequence(first_pattern(node), owner, optional || kind != "oneOrMore");
+            ret = Fragment{state(), state()};
+            epsilon(ret.in, frag.in);
+            epsilon(frag.out, ret.out);
+            if (kind != "optional")
+                epsilon(frag.out, frag.in);
+            if (kind != "oneOrMore")
+                epsilon(ret.in, ret.out);
+        } else if (kind == "ref") {
+            ret = Fragment{state(), state()};
+            if (const auto defines = resolve(node)) {
+                for (const auto define : *defines) {
+                    const auto frag = sequence(first_pattern(define), owner, optional || defines->size() > 1);
+                    epsilon(ret.in, frag.in);
+                    epsilon(frag.out, ret.out);
+                }
+            }
+        } else if (kind == "group" || kind == "mixed" || kind == "div") {
+            if (kind == "mixed" && owner >= 0)
+                elements[owner].text = true;
+            ret = sequence(first_pattern(node), owner, optional);
+        } else if (kind == "externalRef" || kind == "parentRef" || kind == "grammar") {
+            if (owner >= 0)
+                elements[owner].any_content = true;
+            ret.in = ret.out = state();
+        } else {
+            ret.in = ret.out = state(); // empty, and annotations
+        }
+        --depth;
+        return ret;
+    }
+
+    /// Whether `node` only ever matches attributes, so it does not constrain the text
+    bool attributes_only(const Node* node) {
+        const auto kind = local_name(node);
+        if (kind == "attribute")
+            return true;
+        if (kind == "ref") {
+            const auto defines = resolve(node);
+            if (defines == nullptr || ++depth > 1000) {
+                depth -= defines != nullptr ? 1 : 0;
+                return false;
+            }
+            bool ret = true;
+            for (const auto define : *defines)
+                for (auto child = first_pattern(define); child != nullptr && ret; child = next_pattern(child->next_sibling()))
+                    ret = attributes_only(child);
+            --depth;
+            return ret;
+        }
+        if (kind != "optional" && kind != "zeroOrMore" && kind != "oneOrMore" && kind != "group" && kind != "choice" && kind != "interleave")
+            return false;
+        for (auto child = first_pattern(node); child != nullptr; child = next_pattern(child->next_sibling()))
+            if (!attributes_only(child))
+                return false;
+        return true;
+    }
+
+    int element(const Node* node) {
+        if (const auto it = element_ids.find(node); it != element_ids.end())
+            return it->second;
+        const auto id = static_cast<int>(elements.size());
+        elements.emplace_back();
+        element_ids.emplace(node, id);
+        auto content = first_pattern(node);
+        if (node->first_attribute("name") != nullptr) {
+            elements[id].names.push_back(attribute(node, "name"));
+        } else if (content != nullptr) {
+            std::vector<std::string> names;
+            if (name_class(content, names))
+                elements[id].names = std::move(names);
+            content = next_pattern(content->next_sibling());
+        }
+        const auto frag = sequence(content, id, false);
+        elements[id].start = frag.in;
+        const Node* value = nullptr;
+        std::size_t others = 0;
+        for (auto child = content; child != nullptr; child = next_pattern(child->next_sibling()))
+            if (!attributes_only(child))
+                value = others++ == 0 ? child : nullptr;
+        if (value != nullptr)
+            elements[id].text_value = value_of(value);
+        accepting.insert(frag.out);
+        return id;
+    }
+
+  public:
+    explicit Compiler(const Grammar& grammar) : grammar(grammar) {}
+
+    // Determinized output
+    struct DfaState {
+        std::vector<int> nfa_states;
+        bool accepting = false;
+        std::vector<std::tuple<std::string, int, int>> transitions; // (name, target, definition)
+    };
+    struct Definition {
+        std::vector<int> patterns;
+        std::string name;
+        int start = -1;
+    };
+    std::vector<DfaState> states;
+    std::vector<Definition> definitions;
+    int start = -1;
+
+    [[nodiscard]] const ElementPattern& pattern(int id) const { return elements[id]; }
+
+    bool compile() {
+        if (grammar.starts.empty()) {
+            std::fprintf(stderr, "rng2tables: no start pattern\n");
+            return false;
+        }
+        const auto doc = Fragment{state(), state()};
+        for (const auto s : grammar.starts) {
+            const auto frag = sequence(first_pattern(s), -1, grammar.starts.size() > 1);
+            epsilon(doc.in, frag.in);
+            epsilon(frag.out, doc.out);
+        }
+        accepting.insert(doc.out);
+        if (failed)
+            return false;
+
+        std::map<std::vector<int>, int> state_ids;
+        std::map<std::vector<int>, int> definition_ids;
+        std::deque<int> pending_states;
+        std::deque<int> pending_definitions;
+        const auto closure = [this](std::vector<int> set) {
+            std::vector<int> stack = set;
+            std::set<int> seen(set.begin(), set.end());
+            while (!stack.empty()) {
+                const auto s = stack.back();
+                stack.pop_back();
+                for (const auto next : nfa[s].epsilon)
+                    if (seen.insert(next).second)
+                        stack.push_back(next);
+            }
+            return std::vector<int>(seen.begin(), seen.end());
+        };
+        const auto dfa_state = [&](std::vector<int> set) {
+            const auto [it, inserted] = state_ids.try_emplace(closure(std::move(set)), static_cast<int>(states.size()));
+            if (inserted) {
+                DfaState st;
+                st.nfa_states = it->first;
+                st.accepting = std::any_of(st.nfa_states.begin(), st.nfa_states.end(), [this](int s) { return accepting.count(s) != 0; });
+                states.push_back(std::move(st));
+                pending_states.push_back(it->second);
+            }
+            return it->second;
+        };
+        const auto definition = [&](std::vector<int> patterns) {
+            const auto [it, inserted] = definition_ids.try_emplace(patterns, static_cast<int>(definitions.size()));
+            if (inserted) {
+                const auto& names = elements[patterns.front()].names;
+                definitions.push_back(Definition{patterns, names.empty() ? "*" : names.front(), -1});
+                pending_definitions.push_back(it->second);
+            }
+            return it->second;
+        };
+
+        start = dfa_state({doc.in});
+        while (!pending_states.empty() || !pending_definitions.empty()) {
+            if (!pending_definitions.empty()) {
+                const auto d = pending_definitions.front();
+                pending_definitions.pop_front();
+                std::vector<int> starts;
+                for (const auto p : definitions[d].patterns)
+                    starts.push_back(elements[p].start);
+                const auto s = dfa_state(std::move(starts));
+                definitions[d].start = s;
+                continue;
+            }
+            const auto s = pending_states.front();
+            pending_states.pop_front();
+            std::map<std::string, std::pair<std::set<int>, std::set<int>>> by_name; // name -> (NFA targets, element patterns)
+            std::pair<std::set<int>, std::set<int>> wildcard;
+            for (const auto n : std::vector<int>{states[s].nfa_states}) {
+                for (const auto& [id, target] : nfa[n].edges) {
+                    if (elements[id].names.empty()) {
+                        wildcard.first.insert(target);
+                        wildcard.second.insert(id);
+                    }
+                    for (const auto& name : elements[id].names) {
+                        by_name[name].first.insert(target);
+                        by_name[name].second.insert(id);
+                    }
+                }
+            }
+            std::vector<std::tuple<std::string, int, int>> transitions;
+            for (auto& [name, edge] : by_name) {
+                edge.first.insert(wildcard.first.begin(), wildcard.first.end());
+                edge.second.insert(wildcard.second.begin(), wildcard.second.end());
+                transitions.emplace_back(name, dfa_state({edge.first.begin(), edge.first.end()}),
+                                         definition({edge.second.begin(), edge.second.end()}));
+            }
+            if (!wildcard.first.empty())
+                transitions.emplace_back("*", dfa_state({wildcard.first.begin(), wildcard.first.end()}),
+                                         definition({wildcard.second.begin(), wildcard.second.end()}));
+            states[s].transitions = std::move(transitions);
+        }
+        return true;
+    }
+};
+
+/// Writes the tables as constexpr arrays in a header
+class Emitter {
+    std::string strings;
+    std::map<std::string, std::pair<std::size_t, std::size_t>> interned;
+
+    std::string ref(const std::string& str) {
+        const auto [it, inserted] = interned.try_emplace(str, strings.size(), str.size());
+        if (inserted)
+            strings.append(str);
+        return "{" + std::to_string(it->second.first) + ", " + std::to_string(it->second.second) + "}";
+    }
+
+    static std::string literal(const std::string& str) {
+        std::string ret = "    \"";
+        std::size_t line = 0;
+        for (const auto c : str) {
+            if (line++ == 100) {
+                ret += "\"\n    \"";
+                line = 0;
+            }
+            if (c == '"' || c == '\\')
+                ret.push_back('\\');
+            if (static_cast<unsigned char>(c) < 0x20 || c == '?') {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\%03o", static_cast<unsigned char>(c));
+                ret += buf;
+            } else {
+                ret.push_back(c);
+            }
+        }
+        return ret + "\"";
+    }
+
+  public:
+    std::string run(const Compiler& compiler, const std::string& source, const std::string& id) {
+        static constexpr const char* kinds[] = {"any", "enumeration", "integer", "unsigned_integer"};
+        std::string definitions;
+        std::string attributes;
+        std::string values;
+        std::size_t attribute_count = 0;
+        std::size_t value_count = 0;
+        for (const auto& def : compiler.definitions) {
+            // Merge the patterns sharing the definition: required only if required by all of them
+            std::map<std::string, AttributeInfo> merged;
+            std::map<std::string, std::size_t> seen;
+            unsigned flags = 0;
+            ValueSet text = compiler.pattern(def.patterns.front()).text_value;
+            for (const auto p : def.patterns) {
+                const auto& pattern = compiler.pattern(p);
+                text.merge(pattern.text_value);
+                flags |= (pattern.text ? 1u : 0u) | (pattern.any_attributes ? 2u : 0u) | (pattern.any_content ? 4u : 0u);
+                for (const auto& [name, info] : pattern.attributes) {
+                    const auto [it, inserted] = merged.try_emplace(name, info);
+                    if (!inserted) {
+                        it->second.required = it->second.required && info.required;
+                        it->second.value.merge(info.value);
+                    }
+                    ++seen[name];
+                }
+            }
+            const auto first_attribute = attribute_count;
+            std::size_t required = 0;
+            for (auto& [name, info] : merged) {
+                info.required = info.required && seen[name] == def.patterns.size();
+                required += info.required ? 1 : 0;
+                const auto first_value = value_count;
+                if (info.value.kind == ValueKind::enumeration) {
+                    for (const auto& value : info.value.values) {
+                        values += "    " + ref(value) + ",\n";
+                        ++value_count;
+                    }
+                }
+                attributes += "    {" + ref(name) + ", schema::ValueKind::" + kinds[static_cast<int>(info.value.kind)] + ", " +
+                              (info.required ? "true" : "false") + ", " + std::to_string(first_value) + ", " +
+                              std::to_string(value_count - first_value) + "},\n";
+                ++attribute_count;
+            }
+            const auto first_value = value_count;
+            if (text.kind == ValueKind::enumeration) {
+                for (const auto& value : text.values) {
+                    values += "    " + ref(value) + ",\n";
+                    ++value_count;
+                }
+            }
+            definitions += "    {" + ref(def.name) + ", " + std::to_string(first_attribute) + ", " + std::to_string(attribute_count - first_attribute) +
+                           ", " + std::to_string(required) + ", " + std::to_string(def.start) + ", " + std::to_string(flags) +
+                           ", schema::ValueKind::" + kinds[static_cast<int>(text.kind)] + ", " + std::to_string(first_value) + ", " +
+                           std::to_string(value_count - first_value) + "},\n";
+        }
+        std::string states;
+        std::string transitions;
+        std::size_t transition_count = 0;
+        for (const auto& st : compiler.states) {
+            states += "    {" + std::to_string(transition_count) + ", " + std::to_string(st.transitions.size()) + ", " +
+                      (st.accepting ? "true" : "false") + "},\n";
+            for (const auto& [name, target, definition] : st.transitions) {
+                transitions += "    {" + ref(name) + ", " + std::to_string(target) + ", " + std::to_string(definition) + "},\n";
+                ++transition_count;
+            }
+        }
+        // Arrays cannot be empty
+        if (definitions.empty())
+            definitions = "    {},\n";
+        if (attributes.empty())
+            attributes = "    {},\n";
+        if (values.empty())
+            values = "    {},\n";
+        if (transitions.empty())
+            transitions = "    {},\n";
+
+        const auto ns = id + "_tables";
+        std::string out;
+        out += "// Generated by rng2tables from " + source + "; do not edit\n";
+        out += "#pragma once\n\n#include <virtxml/schema.hpp>\n\nnamespace virtxml {\ninline namespace {\nnamespace schemas {\nnamespace " + ns + " {\n";
+        out += "constexpr char strings[] =\n" + literal(strings) + ";\n";
+        out += "constexpr schema::Definition definitions[] = {\n" + definitions + "};\n";
+        out += "constexpr schema::Attribute attributes[] = {\n" + attributes + "};\n";
+        out += "constexpr schema::StrRef values[] = {\n" + values + "};\n";
+        out += "constexpr schema::State states[] = {\n" + states + "};\n";
+        out += "constexpr schema::Transition transitions[] = {\n" + transitions + "};\n";
+        out += "} // namespace " + ns + "\n\n";
+        out += "constexpr schema::Schema " + id + "{" + ns + "::strings, " + ns + "::definitions, " + ns + "::attributes, " + ns + "::values, " + ns +
+               "::states, " + ns + "::transitions, " + std::to_string(compiler.start) + "};\n";
+        out += "} // namespace schemas\n} // namespace\n} // namespace virtxml\n";
+        return out;
+    }
+};
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        std::fprintf(stderr, "usage: %s <schema.rng> <identifier> <output.hpp>\n", argv[0]);
+        return 2;
+    }
+    Grammar grammar;
+    if (!grammar.load(argv[1]))
+        return 1;
+    Compiler compiler{grammar};
+    if (!compiler.compile())
+        return 1;
+    const auto source = std::string{argv[1]}.substr(std::string{argv[1]}.rfind('/') + 1);
+    const auto header = Emitter{}.run(compiler, source, argv[2]);
+    std::ofstream out{argv[3], std::ios::binary};
+    out << header;
+    return out ? 0 : 1;
+}